@@ -0,0 +1,785 @@
+#include <arpa/inet.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "lars_dns/route_loader.h"
+#include "lars_dns/route_table.h"
+#include "lars_reactor/buffer_pool.h"
+#include "lars_reactor/lz_codec.h"
+#include "lars_reactor/message.h"
+#include "lars_reactor/numa_topology.h"
+#include "lars_reactor/shm_channel.h"
+#include "lars_reactor/tcp_client.h"
+#include "lars_reactor/tcp_conn.h"
+#include "lars_reactor/tcp_server.h"
+#include "lars_reporter/reporter.h"
+
+#ifdef LARS_WITH_TLS
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/x509.h>
+#endif
+
+/**
+ * 几个关键路径的简单基准，结果打印到标准输出
+ * lars_bench idle [n]      回环上空闲tcp连接的常驻内存
+ * lars_bench tls [mb]      回环上tls与明文的吞吐
+ * lars_bench shm [mb]      共享内存通道与回环tcp的ping-pong延迟和流式吞吐
+ * lars_bench numa [mb]     大消息回显在同一numa节点和跨节点时的带宽
+ * lars_bench compress [n]  压缩每个消息节省的字节和消耗的cpu
+ * lars_bench route [ms]    路由表持续替换快照时查询qps随读线程数的变化
+ * lars_bench snapshot [n] n条路由文本解析和映射二进制快照的启动时间和内存
+ * lars_bench report [n]    多线程提交n条上报记录的落盘速度，fdatasync开和关
+ */
+
+static uint64_t NowNs(clockid_t clock) {
+  struct timespec ts {};
+  clock_gettime(clock, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000000UL + ts.tv_nsec;
+}
+
+// 进程的常驻内存(字节)
+static long RssBytes() {
+  long pages = 0, rss = 0;
+  FILE* fp = fopen("/proc/self/statm", "r");
+  if (fp == nullptr) {
+    return 0;
+  }
+  if (fscanf(fp, "%ld %ld", &pages, &rss) != 2) {
+    rss = 0;
+  }
+  fclose(fp);
+  return rss * sysconf(_SC_PAGESIZE);
+}
+
+// 进程的匿名常驻内存(字节)，不含映射文件的页
+static long AnonRssBytes() {
+  long pages = 0, rss = 0, shared = 0;
+  FILE* fp = fopen("/proc/self/statm", "r");
+  if (fp == nullptr) {
+    return 0;
+  }
+  if (fscanf(fp, "%ld %ld %ld", &pages, &rss, &shared) != 3) {
+    rss = shared = 0;
+  }
+  fclose(fp);
+  return (rss - shared) * sysconf(_SC_PAGESIZE);
+}
+
+// 回环上的n个客户端socket，分批连接，服务端回显一个消息之后连接回到空闲
+struct IdleState {
+  EventLoop* loop_;
+  TcpServer* server_;
+  uint16_t port_;
+  int n_;
+  std::vector<int> clients_;
+  /// 还没有收到回显的客户端
+  std::vector<int> pending_;
+};
+
+// 已经connect但服务端还没有accept的连接上限，
+// 小于listen的backlog，阻塞connect不会等待
+#define IDLE_CONNECT_BACKLOG 256
+// 每个源地址使用的连接数，不超过本地端口范围
+#define IDLE_CONN_PER_ADDR 20000
+
+// 连接客户端并发送消息，再收取已经到达的回显，全部完成后停止事件循环
+static void IdleStep(IdleState* state) {
+  MsgHead head{1, 4};
+  char msg[MESSAGE_HEAD_LEN + 4];
+  memcpy(msg, &head, MESSAGE_HEAD_LEN);
+  memcpy(msg + MESSAGE_HEAD_LEN, "ping", 4);
+  // 服务端每轮事件只accept一个连接，backlog中最多留一批
+  while (static_cast<int>(state->clients_.size()) < state->n_ &&
+         state->clients_.size() - state->server_->GetConnNum() <
+             IDLE_CONNECT_BACKLOG) {
+    int index = static_cast<int>(state->clients_.size());
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    // 源地址轮换127.0.0.2、127.0.0.3...，突破单个源地址的端口数
+    struct sockaddr_in addr {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr =
+        htonl(INADDR_LOOPBACK + 1 + index / IDLE_CONN_PER_ADDR);
+    struct sockaddr_in server {};
+    server.sin_family = AF_INET;
+    server.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    server.sin_port = htons(state->port_);
+    // 端口推迟到connect时按四元组选择
+    int on = 1;
+    if (fd == -1 ||
+        setsockopt(fd, IPPROTO_IP, IP_BIND_ADDRESS_NO_PORT, &on, sizeof(on)) ==
+            -1 ||
+        bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == -1 ||
+        connect(fd, reinterpret_cast<sockaddr*>(&server), sizeof(server)) ==
+            -1 ||
+        write(fd, msg, sizeof(msg)) != sizeof(msg)) {
+      fprintf(stderr, "idle: connect error after %d conns: %s\n", index,
+              strerror(errno));
+      if (fd != -1) {
+        close(fd);
+      }
+      state->n_ = index;
+      break;
+    }
+    state->clients_.push_back(fd);
+    state->pending_.push_back(fd);
+  }
+  char buf[64];
+  size_t keep = 0;
+  for (int fd : state->pending_) {
+    if (recv(fd, buf, sizeof(buf), MSG_DONTWAIT) <= 0) {
+      state->pending_[keep++] = fd;
+    }
+  }
+  state->pending_.resize(keep);
+  if (static_cast<int>(state->clients_.size()) == state->n_ &&
+      state->pending_.empty() &&
+      static_cast<int>(state->server_->GetConnNum()) == state->n_) {
+    state->loop_->Stop();
+    return;
+  }
+  state->loop_->RunAfter(1, [state]() { IdleStep(state); });
+}
+
+// n个空闲tcp连接增加的常驻内存，客户端和服务端在同一进程，
+// 客户端只有socket没有用户态对象，增加的内存都属于服务端
+static void BenchIdle(int n) {
+  // 每个连接占用客户端和服务端两个fd
+  struct rlimit limit {};
+  getrlimit(RLIMIT_NOFILE, &limit);
+  limit.rlim_cur = limit.rlim_max;
+  setrlimit(RLIMIT_NOFILE, &limit);
+  if (2L * n + 64 > static_cast<long>(limit.rlim_cur)) {
+    n = static_cast<int>((limit.rlim_cur - 64) / 2);
+    printf("idle: RLIMIT_NOFILE %ld, capped to %d conns\n",
+           static_cast<long>(limit.rlim_cur), n);
+  }
+  EventLoop loop;
+  TcpServer server(&loop, "127.0.0.1", 0);
+  server.AddMsgRouter(1, [](const char* data, int len, int msg_id, void* args,
+                            NetConnection* conn) {
+    conn->SendMessage(data, len, msg_id);
+  });
+  struct sockaddr_in addr {};
+  socklen_t addr_len = sizeof(addr);
+  getsockname(server.GetListenFd(), reinterpret_cast<sockaddr*>(&addr),
+              &addr_len);
+  IdleState state{&loop, &server, ntohs(addr.sin_port), n, {}, {}};
+  state.clients_.reserve(n);
+  state.pending_.reserve(n);
+  // accept和分发时每个连接的日志会淹没结果
+  std::streambuf* out = std::cout.rdbuf(nullptr);
+  // 空闲连接不持有buffer，内存池预分配的内存不计入连接
+  BufferPool::instance().WarmUp();
+  long before = RssBytes();
+  loop.RunAfter(1, [&state]() { IdleStep(&state); });
+  loop.EventProcess();
+  long after = RssBytes();
+  std::cout.rdbuf(out);
+  n = static_cast<int>(server.GetConnNum());
+  printf("idle: %d tcp conns, sizeof(TcpConn) %zu, rss +%ld bytes, "
+         "%.1f bytes/conn (user space, includes event loop slot)\n",
+         n, sizeof(TcpConn), after - before,
+         n > 0 ? static_cast<double>(after - before) / n : 0.0);
+  // 直接RST，不留下占用端口的TIME_WAIT
+  struct linger reset {1, 0};
+  for (int fd : state.clients_) {
+    setsockopt(fd, SOL_SOCKET, SO_LINGER, &reset, sizeof(reset));
+    close(fd);
+  }
+}
+
+#ifdef LARS_WITH_TLS
+// 生成一张内存中的自签名证书
+static void MakeSelfSigned(std::string* cert_pem, std::string* key_pem) {
+  EVP_PKEY* key = EVP_EC_gen("P-256");
+  X509* cert = X509_new();
+  ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+  X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+  X509_gmtime_adj(X509_getm_notAfter(cert), 3600);
+  X509_set_pubkey(cert, key);
+  X509_NAME* name = X509_get_subject_name(cert);
+  X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC,
+                             reinterpret_cast<const unsigned char*>("lars"),
+                             -1, -1, 0);
+  X509_set_issuer_name(cert, name);
+  X509_sign(cert, key, EVP_sha256());
+
+  BIO* bio = BIO_new(BIO_s_mem());
+  PEM_write_bio_X509(bio, cert);
+  char* data;
+  long len = BIO_get_mem_data(bio, &data);
+  cert_pem->assign(data, len);
+  BIO_free(bio);
+  bio = BIO_new(BIO_s_mem());
+  PEM_write_bio_PrivateKey(bio, key, nullptr, nullptr, 0, nullptr, nullptr);
+  len = BIO_get_mem_data(bio, &data);
+  key_pem->assign(data, len);
+  BIO_free(bio);
+  X509_free(cert);
+  EVP_PKEY_free(key);
+}
+#endif
+
+// 同一事件循环中的客户端和服务端
+struct ThroughputState {
+  EventLoop* loop_;
+  std::string payload_;
+  long remain_;
+  long acked_;
+};
+
+// 回环上发送total字节，服务端每收到一个消息回复一个确认，客户端保持固定窗口
+static void RunThroughput(const char* name, long total, TlsContext* server_ctx,
+                          TlsContext* client_ctx) {
+  EventLoop loop;
+  TcpServer server(&loop, "127.0.0.1", 0);
+  server.SetTls(server_ctx);
+  server.AddMsgRouter(1, [](const char* data, int len, int msg_id, void* args,
+                            NetConnection* conn) {
+    conn->SendMessage("", 0, 2);
+  });
+  struct sockaddr_in addr {};
+  socklen_t addr_len = sizeof(addr);
+  getsockname(server.GetListenFd(), reinterpret_cast<sockaddr*>(&addr),
+              &addr_len);
+  TcpClient client(&loop, "127.0.0.1", ntohs(addr.sin_port));
+  client.SetTls(client_ctx);
+
+  ThroughputState state{&loop, std::string(16 * 1024, 'x'), 0, 0};
+  state.remain_ = total / static_cast<long>(state.payload_.size());
+  long messages = state.remain_;
+  client.AddMsgRouter(2, [&state, messages](const char* data, int len,
+                                            int msg_id, void* args,
+                                            NetConnection* conn) {
+    if (++state.acked_ >= messages) {
+      state.loop_->Stop();
+    } else if (state.remain_ > 0) {
+      --state.remain_;
+      conn->SendMessage(state.payload_.data(),
+                        static_cast<int>(state.payload_.size()), 1);
+    }
+  });
+  client.Connect();
+  const int window = 64;
+  // 连接建立之前的缓存有上限，只计入缓存成功的消息
+  for (int i = 0; i < window && state.remain_ > 0; ++i) {
+    if (client.SendMessage(state.payload_.data(),
+                           static_cast<int>(state.payload_.size()), 1) == 0) {
+      --state.remain_;
+    }
+  }
+  // 防止连接失败时一直等待
+  loop.RunAfter(60000, [&loop]() { loop.Stop(); });
+  uint64_t wall = NowNs(CLOCK_MONOTONIC);
+  uint64_t cpu = NowNs(CLOCK_PROCESS_CPUTIME_ID);
+  loop.EventProcess();
+  wall = NowNs(CLOCK_MONOTONIC) - wall;
+  cpu = NowNs(CLOCK_PROCESS_CPUTIME_ID) - cpu;
+  double mb = static_cast<double>(state.acked_) * state.payload_.size() /
+              (1024.0 * 1024.0);
+  const char* mode = "plaintext";
+  if (client.GetConn() != nullptr && client.GetConn()->GetTls() != nullptr) {
+    mode = client.GetConn()->GetTls()->KernelSend() ? "ktls" : "user tls";
+  }
+  printf("%s (%s): %.0f MB in %.3f s, %.1f MB/s, %.2f cpu ms/MB\n", name,
+         mode, mb, wall / 1e9, mb / (wall / 1e9), cpu / 1e6 / mb);
+}
+
+static void BenchTls(int mb) {
+  long total = static_cast<long>(mb) * 1024 * 1024;
+  RunThroughput("plaintext", total, nullptr, nullptr);
+#ifdef LARS_WITH_TLS
+  std::string cert_pem, key_pem;
+  MakeSelfSigned(&cert_pem, &key_pem);
+  auto server_ctx = TlsContext::CreateServerFromPem(cert_pem, key_pem);
+  auto client_ctx = TlsContext::CreateInsecureClient();
+  if (server_ctx == nullptr || client_ctx == nullptr) {
+    printf("tls: create context error\n");
+    return;
+  }
+  RunThroughput("tls", total, server_ctx.get(), client_ctx.get());
+#else
+  printf("tls: not built (LARS_TLS=OFF)\n");
+#endif
+}
+
+// 客户端在主线程，服务端在另一个线程的事件循环中，
+// 服务端每收到一个消息回复一个空确认，客户端保持固定窗口，窗口为1时就是ping-pong
+static void RunTransport(bool shm, int payload_len, int window, long messages) {
+  EventLoop server_loop;
+  std::unique_ptr<TcpServer> tcp_server;
+  std::unique_ptr<ShmServer> shm_server;
+  std::string path = "/tmp/lars_bench_shm." + std::to_string(getpid());
+  auto ack = [](const char* data, int len, int msg_id, void* args,
+                NetConnection* conn) { conn->SendMessage("", 0, 2); };
+  uint16_t port = 0;
+  if (shm) {
+    shm_server.reset(new ShmServer(&server_loop, path));
+    shm_server->AddMsgRouter(1, ack);
+  } else {
+    tcp_server.reset(new TcpServer(&server_loop, "127.0.0.1", 0));
+    tcp_server->AddMsgRouter(1, ack);
+    struct sockaddr_in addr {};
+    socklen_t addr_len = sizeof(addr);
+    getsockname(tcp_server->GetListenFd(), reinterpret_cast<sockaddr*>(&addr),
+                &addr_len);
+    port = ntohs(addr.sin_port);
+  }
+  // Stop不是线程安全的，由服务端自己的定时器检查结束标志
+  std::atomic<bool> done{false};
+  server_loop.RunEvery(10, [&server_loop, &done]() {
+    if (done) {
+      server_loop.Stop();
+    }
+  });
+  std::thread server_thread([&server_loop]() { server_loop.EventProcess(); });
+
+  EventLoop loop;
+  ThroughputState state{&loop, std::string(payload_len, 'x'), messages, 0};
+  msg_callback on_ack = [&state, messages](const char* data, int len,
+                                           int msg_id, void* args,
+                                           NetConnection* conn) {
+    if (++state.acked_ >= messages) {
+      state.loop_->Stop();
+    } else if (state.remain_ > 0) {
+      --state.remain_;
+      conn->SendMessage(state.payload_.data(),
+                        static_cast<int>(state.payload_.size()), 1);
+    }
+  };
+  MsgRouter router;
+  router.Register(2, on_ack);
+  std::unique_ptr<ShmChannel> channel;
+  std::unique_ptr<TcpClient> client;
+  NetConnection* sender = nullptr;
+  if (shm) {
+    channel = ShmChannel::Connect(path, &loop, &router);
+    sender = channel.get();
+  } else {
+    client.reset(new TcpClient(&loop, "127.0.0.1", port));
+    client->AddMsgRouter(2, on_ack);
+    client->Connect();
+  }
+  for (int i = 0; i < window && state.remain_ > 0; ++i) {
+    int ret = sender != nullptr
+                  ? sender->SendMessage(state.payload_.data(), payload_len, 1)
+                  : client->SendMessage(state.payload_.data(), payload_len, 1);
+    if (ret == 0) {
+      --state.remain_;
+    }
+  }
+  // 防止连接失败时一直等待
+  loop.RunAfter(60000, [&loop]() { loop.Stop(); });
+  uint64_t wall = NowNs(CLOCK_MONOTONIC);
+  loop.EventProcess();
+  wall = NowNs(CLOCK_MONOTONIC) - wall;
+  done = true;
+  server_thread.join();
+  unlink(path.c_str());
+
+  const char* name = shm ? "shm" : "tcp";
+  if (window == 1) {
+    printf("%s ping-pong: %ld round trips of %d bytes in %.3f s, "
+           "%.2f us/round trip\n",
+           name, state.acked_, payload_len, wall / 1e9,
+           state.acked_ > 0 ? wall / 1e3 / state.acked_ : 0.0);
+  } else {
+    double mb = static_cast<double>(state.acked_) * payload_len /
+                (1024.0 * 1024.0);
+    printf("%s stream: %.0f MB in %d byte messages, window %d, %.3f s, "
+           "%.1f MB/s\n",
+           name, mb, payload_len, window, wall / 1e9, mb / (wall / 1e9));
+  }
+}
+
+// 共享内存通道和回环tcp的延迟和吞吐，流式发送的窗口能放进默认大小的环
+static void BenchShm(int mb) {
+  const int stream_len = 16 * 1024;
+  long stream_messages = static_cast<long>(mb) * 1024 * 1024 / stream_len;
+  for (bool shm : {true, false}) {
+    RunTransport(shm, 64, 1, 100000);
+  }
+  for (bool shm : {true, false}) {
+    RunTransport(shm, stream_len, 32, stream_messages);
+  }
+}
+
+// 大消息回显的消息长度和窗口
+#define NUMA_MESSAGE_LEN (1024 * 1024)
+#define NUMA_WINDOW 4
+
+// 服务端事件循环绑定在server_node，客户端绑定在client_node，
+// 客户端发送total字节的大消息，服务端组装后原样回显
+static void RunNuma(int server_node, int client_node, long total) {
+  const NumaTopology& topology = NumaTopology::instance();
+  EventLoop server_loop;
+  TcpServer server(&server_loop, "127.0.0.1", 0);
+  server.SetLargeMessage(LARGE_MESSAGE_DEFAULT_LIMIT);
+  std::string echo;
+  server.GetRouter().RegisterChain(
+      1, [&echo](const std::shared_ptr<IoBuffer>& chain, int total,
+                 int msg_id, void* args, NetConnection* conn) {
+        echo.clear();
+        for (auto buffer = chain; buffer != nullptr;
+             buffer = buffer->GetNext()) {
+          echo.append(buffer->GetData() + buffer->GetHead(),
+                      buffer->GetLength());
+        }
+        conn->SendMessage(echo.data(), total, 1);
+      });
+  struct sockaddr_in addr {};
+  socklen_t addr_len = sizeof(addr);
+  getsockname(server.GetListenFd(), reinterpret_cast<sockaddr*>(&addr),
+              &addr_len);
+  std::atomic<bool> done{false};
+  server_loop.RunEvery(10, [&server_loop, &done]() {
+    if (done) {
+      server_loop.Stop();
+    }
+  });
+  std::thread server_thread([&server_loop, &topology, server_node]() {
+    server_loop.BindCpuSet(topology.CpusOfNode(server_node));
+    server_loop.EventProcess();
+  });
+
+  long messages = total / NUMA_MESSAGE_LEN;
+  long acked = 0;
+  uint64_t wall = 0;
+  std::thread client_thread([&]() {
+    EventLoop loop;
+    loop.BindCpuSet(topology.CpusOfNode(client_node));
+    TcpClient client(&loop, "127.0.0.1", ntohs(addr.sin_port));
+    std::string payload(NUMA_MESSAGE_LEN, 'x');
+    long remain = messages;
+    client.GetRouter().RegisterChain(
+        1, [&](const std::shared_ptr<IoBuffer>& chain, int len, int msg_id,
+               void* args, NetConnection* conn) {
+          if (++acked >= messages) {
+            loop.Stop();
+          } else if (remain > 0) {
+            --remain;
+            conn->SendMessage(payload.data(), NUMA_MESSAGE_LEN, 1);
+          }
+        });
+    client.Connect();
+    // 连接建立之前的缓存放不下大消息，连接建立后再开启大消息模式并发送
+    bool started = false;
+    loop.RunEvery(1, [&]() {
+      if (started || !client.IsConnected()) {
+        return;
+      }
+      started = true;
+      client.GetConn()->EnableLargeMessage();
+      wall = NowNs(CLOCK_MONOTONIC);
+      for (int i = 0; i < NUMA_WINDOW && remain > 0; ++i) {
+        if (client.SendMessage(payload.data(), NUMA_MESSAGE_LEN, 1) == 0) {
+          --remain;
+        }
+      }
+    });
+    // 防止连接失败时一直等待
+    loop.RunAfter(60000, [&loop]() { loop.Stop(); });
+    loop.EventProcess();
+    wall = NowNs(CLOCK_MONOTONIC) - wall;
+  });
+  client_thread.join();
+  done = true;
+  server_thread.join();
+  double mb = static_cast<double>(acked) * NUMA_MESSAGE_LEN / (1024.0 * 1024.0);
+  printf("numa: server node %d, client node %d (%s): %.0f MB echoed in %d "
+         "byte messages, %.3f s, %.1f MB/s\n",
+         server_node, client_node,
+         server_node == client_node ? "local" : "remote", mb,
+         NUMA_MESSAGE_LEN, wall / 1e9, mb / (wall / 1e9));
+}
+
+// 大消息回显在同一numa节点和跨节点时的带宽
+static void BenchNuma(int mb) {
+  long total = static_cast<long>(mb) * 1024 * 1024;
+  int nodes = NumaTopology::instance().NodeCount();
+  RunNuma(0, 0, total);
+  if (nodes < 2) {
+    printf("numa: %d node, remote case skipped\n", nodes);
+    return;
+  }
+  RunNuma(0, 1, total);
+  RunNuma(1, 0, total);
+}
+
+// 模拟业务消息：重复字段名和相近取值的文本
+static std::string MakePayload(int len) {
+  std::string payload;
+  char item[128];
+  for (int i = 0; static_cast<int>(payload.size()) < len; ++i) {
+    snprintf(item, sizeof(item),
+             "{\"modid\":%d,\"cmdid\":%d,\"ip\":\"10.0.%d.%d\",\"port\":%d,"
+             "\"succ\":%d,\"err\":%d},",
+             1000 + i % 7, i % 13, i % 4, i % 251, 8000 + i % 3, i * 7 % 1000,
+             i % 5);
+    payload += item;
+  }
+  payload.resize(len);
+  return payload;
+}
+
+static void BenchCompress(int n) {
+  const int sizes[] = {1024, 4096, 16384, 60000};
+  for (int size : sizes) {
+    std::string payload = MakePayload(size);
+    std::vector<char> packed(LzCodec::Bound(size));
+    std::vector<char> plain(size);
+    int packed_len = 0;
+    uint64_t cpu = NowNs(CLOCK_PROCESS_CPUTIME_ID);
+    for (int i = 0; i < n; ++i) {
+      packed_len = LzCodec::Compress(payload.data(), size, packed.data(),
+                                     static_cast<int>(packed.size()));
+    }
+    uint64_t compress_ns = (NowNs(CLOCK_PROCESS_CPUTIME_ID) - cpu) / n;
+    cpu = NowNs(CLOCK_PROCESS_CPUTIME_ID);
+    for (int i = 0; i < n; ++i) {
+      LzCodec::Decompress(packed.data(), packed_len, plain.data(), size);
+    }
+    uint64_t decompress_ns = (NowNs(CLOCK_PROCESS_CPUTIME_ID) - cpu) / n;
+    int wire = MESSAGE_HEAD_LEN + COMPRESS_HEAD_LEN + packed_len;
+    printf("compress %5d bytes: wire %5d bytes (saved %5d), "
+           "compress %6.2f us, decompress %6.2f us, %.1f saved bytes/cpu us\n",
+           size, wire, MESSAGE_HEAD_LEN + size - wire, compress_ns / 1000.0,
+           decompress_ns / 1000.0,
+           (MESSAGE_HEAD_LEN + size - wire) /
+               ((compress_ns + decompress_ns) / 1000.0));
+  }
+}
+
+// 提交上报记录的线程数
+#define REPORT_PRODUCER_NUM 4
+
+// producers个线程共提交n条记录，队列满时让出cpu后重试，
+// 从开始提交到全部落盘计算写入速度
+static void RunReport(int n, bool sync) {
+  char dir[] = "/tmp/lars_bench_report.XXXXXX";
+  if (mkdtemp(dir) == nullptr) {
+    printf("report: mkdtemp error\n");
+    return;
+  }
+  ReporterConfig config;
+  config.log_dir_ = dir;
+  config.sync_ = sync;
+  Reporter reporter(config);
+  if (reporter.Start() == -1) {
+    printf("report: start error\n");
+    return;
+  }
+  std::atomic<uint64_t> retries{0};
+  uint64_t wall = NowNs(CLOCK_MONOTONIC);
+  std::vector<std::thread> producers;
+  for (int t = 0; t < REPORT_PRODUCER_NUM; ++t) {
+    producers.emplace_back([&reporter, &retries, n, t]() {
+      ReportRecord record{};
+      record.modid_ = 1000 + t;
+      record.succ_ = 1;
+      for (int i = t; i < n; i += REPORT_PRODUCER_NUM) {
+        record.ts_ = time(nullptr);
+        record.cmdid_ = i;
+        while (!reporter.Submit(record)) {
+          ++retries;
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+  for (auto& producer : producers) {
+    producer.join();
+  }
+  reporter.Stop();
+  wall = NowNs(CLOCK_MONOTONIC) - wall;
+  const ReporterStats& stats = reporter.GetStats();
+  uint64_t written = stats.written_;
+  uint64_t batches = stats.batches_;
+  printf("report (sync %s, %d producers, %d writers): %lu records in %.3f s, "
+         "%.0f records/s, %lu batches (%.0f records/batch, %.0f batches/s), "
+         "%lu queue-full retries\n",
+         sync ? "on" : "off", REPORT_PRODUCER_NUM, config.writer_num_,
+         written, wall / 1e9, written / (wall / 1e9), batches,
+         batches > 0 ? static_cast<double>(written) / batches : 0.0,
+         batches / (wall / 1e9), static_cast<uint64_t>(retries));
+  for (int i = 0; i < config.writer_num_; ++i) {
+    unlink((std::string(dir) + "/report." + std::to_string(i) + ".log")
+               .c_str());
+  }
+  rmdir(dir);
+}
+
+static void BenchReport(int n) {
+  RunReport(n, true);
+  RunReport(n, false);
+}
+
+// 路由基准的条目数，每条路由两个主机
+#define ROUTE_BENCH_ENTRIES 10000
+
+static std::unique_ptr<RouteSnapshot> MakeRoutes(uint64_t version) {
+  std::unique_ptr<RouteSnapshot> snapshot(new RouteSnapshot);
+  for (int i = 0; i < ROUTE_BENCH_ENTRIES; ++i) {
+    std::vector<HostInfo>& hosts = snapshot->routes_[RouteKey(i, i % 7)];
+    hosts.push_back(HostInfo{htonl(0x0a000000U + i), 8000});
+    hosts.push_back(HostInfo{htonl(0x0a000000U + i), 8001});
+  }
+  snapshot->version_ = version;
+  return snapshot;
+}
+
+// readers个线程查询ms毫秒，同时一个写线程不停替换整份快照
+static void RunRoute(int readers, int ms) {
+  RouteTable table;
+  table.Update(MakeRoutes(1));
+  std::atomic<bool> running{true};
+  std::atomic<uint64_t> queries{0};
+  std::atomic<uint64_t> misses{0};
+  uint64_t updates = 0;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < readers; ++t) {
+    threads.emplace_back([&table, &running, &queries, &misses, t]() {
+      int reader = table.RegisterReader();
+      std::vector<HostInfo> hosts;
+      uint64_t count = 0, miss = 0;
+      for (unsigned i = t; running.load(std::memory_order_relaxed); ++i) {
+        int modid = static_cast<int>(i * 2654435761U % ROUTE_BENCH_ENTRIES);
+        miss += !table.Query(reader, modid, modid % 7, &hosts);
+        ++count;
+      }
+      queries += count;
+      misses += miss;
+    });
+  }
+  std::thread writer([&table, &running, &updates]() {
+    while (running.load(std::memory_order_relaxed)) {
+      table.Update(MakeRoutes(updates + 2));
+      ++updates;
+    }
+  });
+  uint64_t wall = NowNs(CLOCK_MONOTONIC);
+  usleep(ms * 1000);
+  running = false;
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  writer.join();
+  wall = NowNs(CLOCK_MONOTONIC) - wall;
+  printf("route: %2d readers, %.0f queries/s (%.0f per reader), "
+         "%lu updates of %d entries (%.1f/s), %lu misses\n",
+         readers, queries / (wall / 1e9), queries / (wall / 1e9) / readers,
+         updates, ROUTE_BENCH_ENTRIES, updates / (wall / 1e9),
+         static_cast<uint64_t>(misses));
+}
+
+static void BenchRoute(int ms) {
+  for (int readers : {1, 2, 4, 8, 16}) {
+    RunRoute(readers, ms);
+  }
+}
+
+// 在子进程中加载一次路由文件，打印加载时间和增加的常驻内存，
+// 每次加载在独立的进程中，互不影响
+static void RunLoad(const char* name, const std::string& path) {
+  fflush(stdout);
+  pid_t pid = fork();
+  if (pid == 0) {
+    RouteTable table;
+    RouteLoader loader(&table, path);
+    long before = RssBytes();
+    long anon = AnonRssBytes();
+    uint64_t wall = NowNs(CLOCK_MONOTONIC);
+    int ret = loader.Load();
+    wall = NowNs(CLOCK_MONOTONIC) - wall;
+    long after = RssBytes();
+    anon = AnonRssBytes() - anon;
+    int reader = table.RegisterReader();
+    std::vector<HostInfo> hosts;
+    bool found = table.Query(reader, 1, 1, &hosts);
+    printf("snapshot: %s load %s in %.3f s, rss +%.1f MB (anonymous +%.1f MB, "
+           "the rest is shared page cache), query %s\n",
+           name, ret == 0 ? "ok" : "error", wall / 1e9,
+           (after - before) / (1024.0 * 1024.0), anon / (1024.0 * 1024.0),
+           found ? "ok" : "error");
+    fflush(stdout);
+    _exit(0);
+  }
+  waitpid(pid, nullptr, 0);
+}
+
+// n条路由的启动加载：文本解析成内存哈希表，和映射二进制快照
+static void BenchSnapshot(int n) {
+  std::string text = "/tmp/lars_bench_routes." + std::to_string(getpid());
+  std::string binary = text + ".bin";
+  FILE* fp = fopen(text.c_str(), "w");
+  if (fp == nullptr) {
+    printf("snapshot: create %s error\n", text.c_str());
+    return;
+  }
+  for (int i = 0; i < n; ++i) {
+    fprintf(fp, "%d %d 10.%d.%d.%d %d\n", i / 100, i % 100, (i >> 16) & 255,
+            (i >> 8) & 255, i & 255, 8000 + i % 100);
+  }
+  fclose(fp);
+  // 转换也需要整份解析，放在子进程中不占用本进程的内存
+  fflush(stdout);
+  pid_t pid = fork();
+  if (pid == 0) {
+    uint64_t wall = NowNs(CLOCK_MONOTONIC);
+    int ret = RouteLoader::Dump(text, binary, 1);
+    printf("snapshot: dump %d entries %s in %.3f s\n", n,
+           ret == 0 ? "ok" : "error", (NowNs(CLOCK_MONOTONIC) - wall) / 1e9);
+    fflush(stdout);
+    _exit(0);
+  }
+  waitpid(pid, nullptr, 0);
+  RunLoad("text", text);
+  RunLoad("mmap", binary);
+  unlink(text.c_str());
+  unlink(binary.c_str());
+}
+
+int main(int argc, char** argv) {
+  std::string mode = argc > 1 ? argv[1] : "all";
+  int arg = argc > 2 ? atoi(argv[2]) : 0;
+  if (mode == "idle" || mode == "all") {
+    BenchIdle(arg > 0 ? arg : 1000000);
+  }
+  if (mode == "tls" || mode == "all") {
+    BenchTls(arg > 0 ? arg : 256);
+  }
+  if (mode == "shm" || mode == "all") {
+    BenchShm(arg > 0 ? arg : 1024);
+  }
+  if (mode == "numa" || mode == "all") {
+    BenchNuma(arg > 0 ? arg : 1024);
+  }
+  if (mode == "compress" || mode == "all") {
+    BenchCompress(arg > 0 ? arg : 2000);
+  }
+  if (mode == "route" || mode == "all") {
+    BenchRoute(arg > 0 ? arg : 1000);
+  }
+  if (mode == "snapshot" || mode == "all") {
+    BenchSnapshot(arg > 0 ? arg : 10000000);
+  }
+  if (mode == "report" || mode == "all") {
+    BenchReport(arg > 0 ? arg : 2000000);
+  }
+  return 0;
+}
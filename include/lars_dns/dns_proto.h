@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+
+// 查询路由的请求和回复消息id
+#define ID_GET_ROUTE_REQUEST 1
+#define ID_GET_ROUTE_RESPONSE 2
+
+// 一个提供服务的主机
+struct HostInfo {
+  /// ip地址，网络字节序
+  uint32_t ip_;
+  /// 端口
+  int port_;
+};
+
+// 查询modid/cmdid对应主机的请求
+struct GetRouteRequest {
+  int modid_;
+  int cmdid_;
+};
+
+// 查询回复，后面紧跟host_num_个HostInfo
+struct GetRouteResponse {
+  int modid_;
+  int cmdid_;
+  int host_num_;
+};
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <vector>
+
+#include "lars_reactor/tcp_conn.h"
+#include "lars_reactor/tcp_server.h"
+#include "route_table.h"
+
+/**
+ * 路由查询服务，每个事件循环线程一个实例
+ * 多个实例通过SO_REUSEPORT监听同一端口，共享同一个RouteTable
+ */
+class DnsService {
+ public:
+  // 必须在loop所在线程中构造
+  DnsService(RouteTable* table, EventLoop* loop, const char* ip,
+             uint16_t port);
+
+  // 处理一个查询请求
+  void GetRoute(const char* data, int len, NetConnection* conn);
+
+ private:
+  /// 路由表
+  RouteTable* table_;
+  /// 本线程在路由表中的读者编号
+  int reader_;
+  /// 监听服务
+  TcpServer server_;
+  /// 查询结果，复用避免每次分配
+  std::vector<HostInfo> hosts_;
+  /// 回复消息的编码缓冲，复用避免每次分配
+  std::vector<char> reply_;
+};
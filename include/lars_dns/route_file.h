@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "dns_proto.h"
+
+// 二进制路由快照文件的魔数和格式版本
+#define ROUTE_FILE_MAGIC "LARSRTB"
+#define ROUTE_FILE_FORMAT 1
+
+struct RouteSnapshot;
+
+// 快照文件头
+struct RouteFileHeader {
+  char magic_[8];
+  /// 文件格式版本
+  uint32_t format_;
+  uint32_t reserved_;
+  /// 路由数据版本
+  uint64_t version_;
+  /// 路由条目个数
+  uint64_t entry_num_;
+  /// 主机个数
+  uint64_t host_num_;
+  /// 文件头之后全部数据的FNV-1a校验和
+  uint64_t checksum_;
+};
+
+// 按key升序排列的路由条目
+struct RouteFileEntry {
+  uint64_t key_;
+  /// 第一个主机在主机数组中的下标
+  uint32_t host_index_;
+  /// 主机个数
+  uint32_t host_num_;
+};
+
+/**
+ * 内存映射的二进制路由快照
+ * 文件布局: RouteFileHeader | RouteFileEntry[entry_num_] | HostInfo[host_num_]
+ * 打开时只做mmap和校验，查询直接在映射内存上二分查找，不需要重建内存结构
+ */
+class RouteFile {
+ public:
+  ~RouteFile();
+
+  // 映射快照文件，verify为true时校验整个文件的校验和，失败返回nullptr
+  static std::unique_ptr<RouteFile> Open(const std::string& path,
+                                         bool verify = true);
+  // 将路由快照写成二进制快照文件，先写临时文件再rename，失败返回-1
+  static int Write(const std::string& path, const RouteSnapshot& snapshot);
+  // 文件是否为二进制路由快照
+  static bool IsRouteFile(const std::string& path);
+
+  // 查询key对应的主机，没有该路由返回false
+  bool Find(uint64_t key, std::vector<HostInfo>* hosts) const;
+  // 按key顺序遍历全部路由
+  void ForEach(const std::function<void(uint64_t key, const HostInfo* hosts,
+                                        uint32_t num)>& visitor) const;
+  uint64_t GetVersion() const { return header_->version_; }
+  uint64_t GetEntryNum() const { return header_->entry_num_; }
+
+ private:
+  RouteFile() = default;
+  RouteFile(const RouteFile&);
+  const RouteFile& operator=(const RouteFile&);
+
+  /// 映射的起始地址和长度
+  void* addr_ = nullptr;
+  size_t length_ = 0;
+  const RouteFileHeader* header_ = nullptr;
+  const RouteFileEntry* entries_ = nullptr;
+  const HostInfo* hosts_ = nullptr;
+};
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <atomic>
+#include <ctime>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "route_table.h"
+
+/**
+ * 从本地路由文件加载路由表，并在后台线程中定期检查文件变化，
+ * 变化后重建快照并原子替换到RouteTable中
+ *
+ * 文本文件每行一条路由: modid cmdid ip port，#开头为注释
+ * 也可以是RouteFile格式的二进制快照，此时直接映射查询
+ */
+class RouteLoader {
+ public:
+  RouteLoader(RouteTable* table, std::string path, int interval_ms = 1000);
+  ~RouteLoader();
+
+  // 立即加载一次路由文件，失败返回-1
+  int Load();
+  // 启动后台更新线程
+  void Start();
+  // 停止后台更新线程
+  void Stop();
+  // 解析文本路由文件为快照，失败返回nullptr
+  static std::unique_ptr<RouteSnapshot> Parse(const std::string& path);
+  // 将文本路由文件转换为版本号为version的二进制快照文件，失败返回-1；
+  // 加载快照时直接使用该版本号，替换快照时应该递增
+  static int Dump(const std::string& path, const std::string& snapshot_path,
+                  uint64_t version);
+
+ private:
+  // 后台线程主循环
+  void Run();
+  // 文件修改时间是否变化
+  bool Changed();
+
+  /// 要更新的路由表
+  RouteTable* table_;
+  /// 路由文件路径
+  std::string path_;
+  /// 检查文件变化的周期，单位ms
+  int interval_ms_;
+  /// 上次加载时文件的修改时间
+  struct timespec mtime_ {};
+  /// 已加载的版本号
+  uint64_t version_;
+  /// 后台线程是否运行
+  std::atomic<bool> running_;
+  std::thread thread_;
+};
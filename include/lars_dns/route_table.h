@@ -0,0 +1,88 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "dns_proto.h"
+#include "route_file.h"
+
+// 最多支持的读者线程个数
+#define MAX_ROUTE_READERS 64
+
+// modid/cmdid组成的路由key
+inline uint64_t RouteKey(int modid, int cmdid) {
+  return (static_cast<uint64_t>(static_cast<uint32_t>(modid)) << 32) |
+         static_cast<uint32_t>(cmdid);
+}
+
+using route_map = std::unordered_map<uint64_t, std::vector<HostInfo>>;
+
+// 遍历路由时的回调
+using route_visitor =
+    std::function<void(uint64_t key, const HostInfo* hosts, uint32_t num)>;
+
+// 一份不可变的路由快照，数据在内存哈希表中，或者在映射的二进制快照文件中
+struct RouteSnapshot {
+  // 查询key对应的主机，没有该路由返回false
+  bool Find(uint64_t key, std::vector<HostInfo>* hosts) const;
+  // 路由条目个数
+  size_t Size() const;
+  // 遍历全部路由
+  void ForEach(const route_visitor& visitor) const;
+
+  route_map routes_;
+  /// 不为空时数据来自映射的快照文件，routes_不再使用
+  std::unique_ptr<RouteFile> file_;
+  uint64_t version_ = 0;
+};
+
+/**
+ * RCU风格的路由表
+ * 读者通过原子指针访问当前快照，全程不加锁；
+ * 写者原子替换整份快照，等所有读者离开旧快照之后再释放它
+ */
+class RouteTable {
+ public:
+  RouteTable();
+  ~RouteTable();
+
+  // 注册一个读者，每个读线程调用一次，返回读者编号，超出上限返回-1
+  int RegisterReader();
+  // 查询modid/cmdid对应的主机，没有该路由返回false
+  bool Query(int reader, int modid, int cmdid,
+             std::vector<HostInfo>* hosts) const;
+  // 用新快照替换当前快照，返回后旧快照已经释放
+  void Update(std::unique_ptr<RouteSnapshot> snapshot);
+  // 当前快照的版本
+  uint64_t GetVersion(int reader) const;
+
+ private:
+  RouteTable(const RouteTable&);
+  const RouteTable& operator=(const RouteTable&);
+
+  // 进入读临界区，返回当前快照
+  const RouteSnapshot* ReadLock(int reader) const;
+  // 离开读临界区
+  void ReadUnlock(int reader) const;
+
+  // 每个读者一个缓存行，记录进入临界区时的epoch，0表示不在临界区
+  struct alignas(64) ReaderSlot {
+    std::atomic<uint64_t> epoch_{0};
+  };
+  /// 读者的epoch记录
+  mutable std::array<ReaderSlot, MAX_ROUTE_READERS> readers_;
+  /// 已注册的读者个数
+  std::atomic<int> reader_num_;
+  /// 全局epoch，每次替换快照加1
+  std::atomic<uint64_t> epoch_;
+  /// 当前快照
+  std::atomic<const RouteSnapshot*> current_;
+  /// 写者之间互斥
+  std::mutex update_mutex_;
+};
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "lars_dns/dns_proto.h"
+
+// 本地调用方获取主机和上报调用结果的消息id
+#define ID_GET_HOST_REQUEST 3
+#define ID_GET_HOST_RESPONSE 4
+#define ID_REPORT_REQUEST 5
+
+// 返回码
+enum LbRetCode {
+  /// 成功
+  RET_SUCC = 0,
+  /// 所有主机都过载，返回的是过载主机
+  RET_OVERLOAD = 1,
+  /// 没有该路由(或者正在从路由服务拉取)
+  RET_NOEXIST = 2,
+};
+
+// 获取modid/cmdid的一个主机
+struct GetHostRequest {
+  int modid_;
+  int cmdid_;
+};
+
+struct GetHostResponse {
+  int modid_;
+  int cmdid_;
+  int retcode_;
+  HostInfo host_;
+};
+
+// 上报一次调用结果，retcode_为0表示成功
+struct ReportRequest {
+  int modid_;
+  int cmdid_;
+  HostInfo host_;
+  int retcode_;
+};
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "lars_reactor/tcp_client.h"
+#include "lars_reactor/tcp_conn.h"
+#include "lars_reactor/tcp_server.h"
+#include "load_balance.h"
+
+// 默认向路由服务刷新路由的周期，单位ms
+#define AGENT_REFRESH_MS 1000
+
+/**
+ * 负载均衡agent，每个事件循环线程一个实例，实例之间不共享状态
+ * 缓存调用方用到的路由，定期从路由服务刷新，按调用结果在主机间做负载均衡
+ */
+class LbAgent {
+ public:
+  // 必须在loop所在线程中构造和使用
+  LbAgent(EventLoop* loop, const char* dns_ip, uint16_t dns_port,
+          const LbConfig& config = LbConfig(),
+          int refresh_ms = AGENT_REFRESH_MS);
+  ~LbAgent();
+
+  // 获取modid/cmdid的一个主机，返回LbRetCode
+  // 第一次获取的路由会立即向路由服务拉取，拉取到之前返回RET_NOEXIST
+  int GetHost(int modid, int cmdid, HostInfo* host);
+  // 上报一次调用结果，retcode为0表示成功
+  void Report(int modid, int cmdid, const HostInfo& host, int retcode);
+  // 在ip:port上为本地进程提供GetHost/Report服务
+  void Serve(const char* ip, uint16_t port);
+  // 向路由服务刷新全部缓存的路由
+  void Refresh();
+
+  // 消息回调
+  void OnRouteResponse(const char* data, int len);
+  void OnGetHost(const char* data, int len, NetConnection* conn);
+  void OnReport(const char* data, int len);
+
+  size_t GetRouteNum() const { return routes_.size(); }
+
+ private:
+  // 向路由服务拉取一个路由
+  void Fetch(int modid, int cmdid);
+
+  /// 所属的event_loop
+  EventLoop* loop_;
+  /// 负载均衡配置
+  LbConfig config_;
+  /// 路由服务的客户端
+  TcpClient dns_client_;
+  /// 对本地进程的服务
+  std::unique_ptr<TcpServer> server_;
+  /// 刷新路由的定时器
+  int refresh_timer_;
+  /// modid/cmdid和负载均衡的关系
+  std::unordered_map<uint64_t, std::unique_ptr<LoadBalance>> routes_;
+  /// 拉取路由时复用的主机列表
+  std::vector<HostInfo> hosts_;
+};
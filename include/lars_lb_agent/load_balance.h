@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "agent_proto.h"
+
+// 负载均衡的配置
+struct LbConfig {
+  /// 每隔多少次GetHost从overload列表中取一个主机探测，不大于0表示不主动探测
+  /// (idle列表为空时仍然从overload列表中选)
+  int probe_num_ = 10;
+  /// 成功/失败计数的统计窗口，单位ms
+  int window_ms_ = 15000;
+  /// 窗口内失败次数达到该值才判断失败率
+  int min_err_ = 5;
+  /// 失败率达到该值判定为过载
+  double err_rate_ = 0.1;
+  /// 过载主机连续成功这么多次恢复为idle
+  int recover_succ_ = 3;
+  /// 过载主机最长保持时间，超时后恢复为idle，单位ms
+  int overload_timeout_ms_ = 15000;
+};
+
+// 一个主机的调用统计
+struct HostStat {
+  HostInfo host_{};
+  /// 当前窗口的成功/失败次数
+  uint32_t succ_ = 0;
+  uint32_t err_ = 0;
+  /// 上一个窗口的成功/失败次数，和当前窗口合起来近似为滑动窗口
+  uint32_t prev_succ_ = 0;
+  uint32_t prev_err_ = 0;
+  /// 当前窗口开始时间
+  uint64_t window_start_ns_ = 0;
+  /// 进入过载的时间
+  uint64_t overload_ns_ = 0;
+  /// 连续成功次数
+  uint32_t cont_succ_ = 0;
+  /// 是否过载
+  bool overload_ = false;
+  /// 所在的idle/overload链表
+  HostStat* prev_ = nullptr;
+  HostStat* next_ = nullptr;
+};
+
+// 主机的侵入式双向链表，头部取出尾部放回实现轮询
+class HostList {
+ public:
+  bool Empty() const { return head_ == nullptr; }
+  size_t Size() const { return size_; }
+  HostStat* Front() const { return head_; }
+  void PushBack(HostStat* stat);
+  void Remove(HostStat* stat);
+
+ private:
+  HostStat* head_ = nullptr;
+  HostStat* tail_ = nullptr;
+  size_t size_ = 0;
+};
+
+/**
+ * 一个modid/cmdid的负载均衡
+ * 主机分为idle和overload两个链表，按调用结果在两者之间迁移；
+ * GetHost和Report都是O(1)，只能在所属的event_loop线程中使用
+ */
+class LoadBalance {
+ public:
+  explicit LoadBalance(const LbConfig* config) : config_(config) {}
+
+  // 选择一个主机，返回LbRetCode
+  int GetHost(uint64_t now_ns, HostInfo* host);
+  // 上报调用结果
+  void Report(const HostInfo& host, bool succ, uint64_t now_ns);
+  // 用路由服务返回的主机列表更新，保留已有主机的统计
+  void Update(const std::vector<HostInfo>& hosts, uint64_t now_ns);
+
+  size_t IdleNum() const { return idle_.Size(); }
+  size_t OverloadNum() const { return overload_.Size(); }
+
+ private:
+  // 统计窗口到期则滚动
+  void RollWindow(HostStat* stat, uint64_t now_ns) const;
+  // idle和overload之间迁移
+  void SetOverload(HostStat* stat, uint64_t now_ns);
+  void SetIdle(HostStat* stat, uint64_t now_ns);
+
+  static uint64_t HostKey(const HostInfo& host) {
+    return (static_cast<uint64_t>(host.ip_) << 32) |
+           static_cast<uint32_t>(host.port_);
+  }
+
+  /// 配置
+  const LbConfig* config_;
+  /// 全部主机
+  std::unordered_map<uint64_t, std::unique_ptr<HostStat>> hosts_;
+  /// 正常主机
+  HostList idle_;
+  /// 过载主机
+  HostList overload_;
+  /// GetHost调用次数
+  uint64_t get_count_ = 0;
+};
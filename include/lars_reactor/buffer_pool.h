@@ -3,6 +3,7 @@
 #include <mutex>
 #include <unordered_map>
 #include "io_buffer.h"
+#include "numa_topology.h"
 
 using pool_t = std::unordered_map<int, std::shared_ptr<IoBuffer>>;
 
@@ -21,11 +22,13 @@ enum MEM_CAP {
 
 class BufferPool {
  public:
-  //获取单例方法
-  static BufferPool& instance() {
-    static BufferPool instance_;
-    return instance_;
-  }
+  //获取当前线程所属numa节点的内存池
+  static BufferPool& instance() { return instance(current_node_); }
+  //获取指定numa节点的内存池，每个节点一个单例，首次使用时创建
+  static BufferPool& instance(int node);
+  //设置当前线程所属的numa节点，之后instance()都使用该节点的内存池
+  static void SetCurrentNode(int node) { current_node_ = node; }
+  static int GetCurrentNode() { return current_node_; }
   //开辟一个io_buf
   std::shared_ptr<IoBuffer> AllocBuffer(int n);
   std::shared_ptr<IoBuffer> AllocBuffer();
@@ -33,12 +36,18 @@ class BufferPool {
   void revert(const std::shared_ptr<IoBuffer>& buffer);
 
   void PreAllocPool(std::shared_ptr<IoBuffer>& prev, MEM_CAP size, int nums);
+  //预分配每个规格的buffer，空闲链表不为空的规格跳过，只在第一次调用时生效；
+  //多numa节点时应在绑定到本节点cpu的线程里调用，物理页在首次写入时分配在本地内存
+  void WarmUp();
   static MEM_CAP FindNearestIndex(int n);
+  //每个规格预分配的个数
+  static int PreAllocNum(MEM_CAP size);
 
   pool_t GetPool() const { return pool_; }
+  int GetNode() const { return node_; }
 
  private:
-  BufferPool();
+  explicit BufferPool(int node);
   //拷贝构造私有化
   BufferPool(const BufferPool&);
   const BufferPool& operator=(const BufferPool&);
@@ -49,4 +58,12 @@ class BufferPool {
   std::atomic<uint64_t> total_mem_;
   ///用户保护内存池链表修改的互斥锁
   std::mutex mutex_;
+  ///内存池所属的numa节点
+  int node_;
+  ///构造时是否跳过预分配，留给WarmUp(多numa节点或非0节点时)
+  bool lazy_;
+  ///是否已经预分配过
+  bool warmed_ = false;
+  ///当前线程所属的numa节点
+  static thread_local int current_node_;
 };
\ No newline at end of file
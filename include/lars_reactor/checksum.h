@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// FNV-1a校验和的初始值
+#define CHECKSUM_SEED 14695981039346656037UL
+
+// FNV-1a校验和，把上一段的结果作为hash传入可以分段累加
+inline uint64_t Checksum(const char* data, size_t len,
+                         uint64_t hash = CHECKSUM_SEED) {
+  for (size_t i = 0; i < len; ++i) {
+    hash ^= static_cast<unsigned char>(data[i]);
+    hash *= 1099511628211UL;
+  }
+  return hash;
+}
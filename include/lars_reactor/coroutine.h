@@ -0,0 +1,215 @@
+#pragma once
+
+#if __cplusplus < 202002L
+#error "lars_reactor/coroutine.h requires C++20, configure with -DLARS_CXX20=ON"
+#endif
+
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "event_loop.h"
+#include "msg_router.h"
+#include "net_connection.h"
+#include "rpc_client.h"
+
+//协程帧内存池的分级粒度
+#define CORO_FRAME_ALIGN 128
+//协程帧内存池管理的最大帧，更大的帧直接使用operator new
+#define CORO_FRAME_MAX 4096
+
+/**
+ * 协程帧内存池，按CORO_FRAME_ALIGN分级的空闲链表，每个线程一份，
+ * 释放的帧留在池中复用，稳定运行时创建协程不再分配内存
+ */
+class FramePool {
+ public:
+  static void* Alloc(size_t size);
+  static void Free(void* ptr, size_t size);
+};
+
+/**
+ * 事件循环上的协程，创建后立即运行，直到第一次挂起，结束后自动释放帧
+ * 协程参数按值传递，引用参数在第一次挂起之后就可能失效
+ */
+struct Task {
+  struct promise_type {
+    Task get_return_object() { return {}; }
+    std::suspend_never initial_suspend() noexcept { return {}; }
+    std::suspend_never final_suspend() noexcept { return {}; }
+    void return_void() {}
+    void unhandled_exception() { std::terminate(); }
+
+    static void* operator new(size_t size) { return FramePool::Alloc(size); }
+    static void operator delete(void* ptr, size_t size) {
+      FramePool::Free(ptr, size);
+    }
+  };
+};
+
+/**
+ * 挂起delay_ms毫秒后在事件循环中恢复
+ */
+class SleepAwaiter {
+ public:
+  SleepAwaiter(EventLoop* loop, int delay_ms) : loop_(loop), delay_ms_(delay_ms) {}
+
+  bool await_ready() const { return delay_ms_ <= 0; }
+  void await_suspend(std::coroutine_handle<> handle) {
+    loop_->RunAfter(delay_ms_, [handle]() { handle.resume(); });
+  }
+  void await_resume() const {}
+
+ private:
+  EventLoop* loop_;
+  int delay_ms_;
+};
+
+inline SleepAwaiter SleepFor(EventLoop* loop, int delay_ms) {
+  return SleepAwaiter(loop, delay_ms);
+}
+
+/**
+ * 发送消息，连接自带输出缓冲，不需要挂起，返回SendMessage的结果
+ * 通过连接的弱引用发送，协程挂起期间连接已经关闭时返回-1
+ */
+class SendAwaiter {
+ public:
+  SendAwaiter(std::shared_ptr<ConnHandle> handle, const char* data, int len,
+              int msg_id)
+      : handle_(std::move(handle)), data_(data), len_(len), msg_id_(msg_id) {}
+
+  bool await_ready() const { return true; }
+  void await_suspend(std::coroutine_handle<>) {}
+  int await_resume() const {
+    NetConnection* conn = handle_ != nullptr ? handle_->Get() : nullptr;
+    if (conn == nullptr) {
+      return -1;
+    }
+    return conn->SendMessage(data_, len_, msg_id_);
+  }
+
+ private:
+  std::shared_ptr<ConnHandle> handle_;
+  const char* data_;
+  int len_;
+  int msg_id_;
+};
+
+inline SendAwaiter AsyncSend(std::shared_ptr<ConnHandle> handle,
+                             const char* data, int len, int msg_id) {
+  return SendAwaiter(std::move(handle), data, len, msg_id);
+}
+
+// 协程收到的一条消息
+struct CoMessage {
+  int msg_id_;
+  std::string data_;
+  /// 收到消息的连接的弱引用，协程恢复时连接可能已经关闭，Get()返回nullptr
+  std::shared_ptr<ConnHandle> conn_;
+};
+
+/**
+ * 协程的消息信箱，在MsgRouter上接管一个msg_id，
+ * 消息到达时如果有协程在等待就直接恢复它，否则排队
+ * 信箱析构时取消注册并销毁仍在等待的协程
+ */
+class CoMailbox {
+ public:
+  // msg_id已经注册了其他回调时打印错误并退出进程
+  CoMailbox(MsgRouter* router, int msg_id);
+  ~CoMailbox();
+
+  class ReadAwaiter {
+   public:
+    explicit ReadAwaiter(CoMailbox* mailbox) : mailbox_(mailbox) {}
+
+    bool await_ready() const { return !mailbox_->messages_.empty(); }
+    void await_suspend(std::coroutine_handle<> handle) {
+      waiter_ = handle;
+      mailbox_->waiters_.push_back(this);
+    }
+    CoMessage await_resume();
+
+   private:
+    friend class CoMailbox;
+    CoMailbox* mailbox_;
+    std::coroutine_handle<> waiter_;
+    /// 直接交给等待者的消息
+    CoMessage message_{};
+    bool delivered_ = false;
+  };
+
+  // 等待下一条消息
+  ReadAwaiter Read() { return ReadAwaiter(this); }
+  size_t GetQueuedNum() const { return messages_.size(); }
+
+ private:
+  void OnMessage(const char* data, int len, int msg_id, NetConnection* conn);
+
+  /// 接管的路由和msg_id
+  MsgRouter* router_;
+  int msg_id_;
+  /// 还没有协程读取的消息
+  std::deque<CoMessage> messages_;
+  /// 等待消息的协程，先到先得
+  std::deque<ReadAwaiter*> waiters_;
+};
+
+inline CoMailbox::ReadAwaiter AsyncReadMessage(CoMailbox* mailbox) {
+  return mailbox->Read();
+}
+
+// rpc调用的结果
+struct RpcResult {
+  int status_;
+  std::string data_;
+};
+
+/**
+ * 发起rpc调用并挂起，响应到达或者超时后恢复
+ */
+class CallAwaiter {
+ public:
+  CallAwaiter(RpcClient* client, int msg_id, const char* data, int len,
+              uint32_t timeout_ms)
+      : client_(client), msg_id_(msg_id), data_(data), len_(len),
+        timeout_ms_(timeout_ms) {}
+
+  bool await_ready() const { return false; }
+  bool await_suspend(std::coroutine_handle<> handle) {
+    uint64_t request_id = client_->Call(
+        msg_id_, data_, len_, timeout_ms_,
+        [this, handle](int status, const char* data, int len) {
+          result_.status_ = status;
+          if (data != nullptr) {
+            result_.data_.assign(data, len);
+          }
+          handle.resume();
+        });
+    if (request_id == 0) {
+      // 发送失败，不挂起
+      result_.status_ = RPC_CLOSED;
+      return false;
+    }
+    return true;
+  }
+  RpcResult await_resume() { return std::move(result_); }
+
+ private:
+  RpcClient* client_;
+  int msg_id_;
+  const char* data_;
+  int len_;
+  uint32_t timeout_ms_;
+  RpcResult result_{};
+};
+
+inline CallAwaiter AsyncCall(RpcClient* client, int msg_id, const char* data,
+                             int len, uint32_t timeout_ms) {
+  return CallAwaiter(client, msg_id, data, len, timeout_ms);
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+#include "event_loop.h"
+
+//优先级类别数，0最高
+#define PRIORITY_CLASSES 4
+//控制面消息(心跳、路由推送)的类别
+#define PRIORITY_CONTROL 0
+//没有指定时连接的类别
+#define PRIORITY_DEFAULT 1
+//大块数据的类别
+#define PRIORITY_BULK 3
+//每个连接每轮最多解析的帧数
+#define DISPATCH_CONN_BUDGET 64
+
+class TcpConn;
+
+/**
+ * 一个事件循环内按优先级分发消息
+ * 连接解析出的帧不直接分发，先按msg_id(没有指定时按连接)的类别进入队列，
+ * 本轮就绪事件都处理完之后按权重轮流从各个队列取帧分发，
+ * 再统一从各连接的ibuf中移除，排队期间帧数据留在ibuf中不拷贝
+ * 每个连接每轮最多解析budget帧，剩余的帧进入下一轮，避免一个连接占满一轮
+ */
+class DispatchScheduler {
+ public:
+  explicit DispatchScheduler(EventLoop* loop);
+
+  // 指定msg_id的类别，cls为-1表示取消，按连接的类别
+  void SetMsgClass(int msg_id, int cls);
+  // 每一轮调度中cls类别连续分发的帧数，至少为1
+  void SetWeight(int cls, int weight);
+  // 每个连接每轮最多解析的帧数
+  void SetConnBudget(int budget) { budget_ = budget; }
+  int GetConnBudget() const { return budget_; }
+  // 消息所属的类别
+  int ClassOf(int msg_id, int conn_class) const {
+    if (msg_classes_.empty()) {
+      return conn_class;
+    }
+    auto itr = msg_classes_.find(msg_id);
+    return itr == msg_classes_.end() ? conn_class : itr->second;
+  }
+
+  // 连接本轮第一次有帧排队
+  void AddConn(TcpConn* conn);
+  // 加入一帧，第一次加入时安排本轮事件处理完之后分发
+  void Push(int cls, TcpConn* conn, const char* data, int len, int msg_id,
+            bool compressed);
+  // 按权重分发所有排队的帧，然后通知连接移除已分发的数据
+  void Drain();
+
+ private:
+  // 排队的帧，数据指向连接的ibuf
+  struct Frame {
+    TcpConn* conn_;
+    const char* data_;
+    int len_;
+    int msg_id_;
+    ///消息体经过压缩，分发时解压
+    bool compressed_;
+  };
+
+  /// 所属的事件循环
+  EventLoop* loop_;
+  /// 每个类别的帧队列
+  std::vector<Frame> queues_[PRIORITY_CLASSES];
+  /// 每个类别的权重
+  int weights_[PRIORITY_CLASSES] = {8, 4, 2, 1};
+  /// msg_id的类别
+  std::unordered_map<int, int> msg_classes_;
+  /// 本轮有帧排队的连接
+  std::vector<TcpConn*> conns_;
+  /// 每个连接每轮最多解析的帧数
+  int budget_ = DISPATCH_CONN_BUDGET;
+  /// 是否已经安排了分发任务
+  bool scheduled_ = false;
+};
@@ -1,15 +1,14 @@
 #pragma once
 
-#include <functional>
 /**
  * 定义一些IO复用机制或者其他异常触发机制的事件封装
  *
  */
 class EventLoop;
-// IO事件触发的回调函数
-using io_callback = std::function<void(EventLoop*, int, void*)>;
+// IO事件触发的回调函数，状态通过args传递，不使用std::function以减小每个fd的开销
+using io_callback = void (*)(EventLoop*, int, void*);
 /**
- * 封装一次IO触发实现
+ * 封装一次IO触发实现，按fd下标存放在EventLoop中，mask_为0表示未注册
  */
 struct IoEvent {
   IoEvent()
@@ -2,19 +2,43 @@
 #include <sys/epoll.h>
 
 #include <array>
-#include <unordered_map>
-#include <unordered_set>
+#include <cstdint>
+#include <memory>
+#include <functional>
+#include <vector>
 
 #include "event_base.h"
+#include "timer_queue.h"
 
 #define MAXEVENTS 10
+// epoll_wait阻塞等待的超时时间，单位ms
+#define EPOLL_WAIT_TIMEOUT 10
+
+/**
+ * 事件循环的耗时统计，单位ns
+ * 用于调节busy-poll的自旋预算
+ */
+struct LoopStats {
+  /// 自旋轮询(timeout=0)所花费的时间
+  uint64_t spin_ns_ = 0;
+  /// 阻塞在epoll_wait上的时间
+  uint64_t block_ns_ = 0;
+  /// 处理就绪事件(回调)的时间
+  uint64_t busy_ns_ = 0;
+  /// 在自旋阶段就拿到事件的次数
+  uint64_t spin_hits_ = 0;
+  /// 自旋预算耗尽转入阻塞等待的次数
+  uint64_t spin_misses_ = 0;
+};
 
 class EventLoop {
  public:
   // 构造，初始化epoll堆
   EventLoop();
-  // 阻塞循环处理事件
+  // 阻塞循环处理事件，直到调用Stop
   void EventProcess();
+  // 处理完本轮事件后退出EventProcess，只能在loop线程中调用
+  void Stop() { quit_ = true; }
   // 添加一个io事件到loop中
   void AddIoEvent(int fd, io_callback proc, int mask, void* args = nullptr);
   // 删除一个io事件从loop中
@@ -23,14 +47,59 @@ class EventLoop {
   void DelIoEvent(int fd, int mask);
   // 从事件循环中获取与给定文件描述符相关联的数据
   IoEvent* GetData(int fd);
+  // 添加一个在本轮就绪事件处理完之后执行的任务，只能在loop线程中调用
+  void AddTask(std::function<void()> task) { tasks_.push_back(std::move(task)); }
+  // 添加一个delay_ms毫秒后执行一次的定时器，返回定时器id
+  int RunAfter(int delay_ms, timer_callback callback);
+  // 添加一个每隔interval_ms毫秒执行一次的定时器，返回定时器id
+  int RunEvery(int interval_ms, timer_callback callback);
+  // 取消定时器
+  void CancelTimer(int timer_id);
+  // 本轮事件循环开始处理时的时间(CLOCK_MONOTONIC)，单位ns，避免频繁取时间
+  uint64_t GetNowNs() const { return now_ns_; }
+  // 单调时钟的当前时间，单位ns
+  static uint64_t ClockNs();
+  // 开启busy-poll模式，先自旋spin_us微秒再阻塞等待，0表示关闭
+  void SetBusyPoll(int spin_us) { busy_poll_us_ = spin_us; }
+  int GetBusyPoll() const { return busy_poll_us_; }
+  // 将当前(运行事件循环的)线程绑定到指定的cpu核上
+  bool BindCpu(int cpu) { return BindCpuSet({cpu}); }
+  // 将当前线程绑定到一组cpu上，并使用第一个cpu所在numa节点的内存池
+  bool BindCpuSet(const std::vector<int>& cpus);
+  int GetCpu() const { return cpu_; }
+  int GetNumaNode() const { return numa_node_; }
+  // 获取/重置循环耗时统计
+  const LoopStats& GetStats() const { return stats_; }
+  void ResetStats() { stats_ = LoopStats(); }
 
  private:
+  // 先自旋再阻塞的等待就绪事件
+  int WaitEvents();
+  // 处理一批就绪事件
+  void ProcessEvents(int nfds);
+  // 执行本轮积累的任务
+  void RunTasks();
+
   /// epoll fd
   int epoll_fd_;
-  /// 当前event_loop 监控的fd和对应事件的关系
-  std::unordered_map<int, IoEvent> io_evs_;
-  /// 当前event_loop 一共哪些fd在监听
-  std::unordered_set<int> listen_fds;
+  /// 当前event_loop 监控的fd和对应事件的关系，下标为fd
+  std::vector<IoEvent> io_evs_;
   /// 一次性最大处理的事件
   std::array<struct epoll_event, MAXEVENTS> fired_evs_{};
+  /// 本轮事件处理完之后要执行的任务
+  std::vector<std::function<void()>> tasks_;
+  /// 定时器队列，第一次添加定时器时创建
+  std::unique_ptr<TimerQueue> timers_;
+  /// 本轮事件循环开始处理时的时间
+  uint64_t now_ns_ = 0;
+  /// busy-poll自旋预算，单位us，0表示不自旋
+  int busy_poll_us_ = 0;
+  /// 事件循环绑定的(第一个)cpu，-1表示未绑定
+  int cpu_ = -1;
+  /// 事件循环所在的numa节点
+  int numa_node_ = 0;
+  /// 循环耗时统计
+  LoopStats stats_;
+  /// 是否退出事件循环
+  bool quit_ = false;
 };
\ No newline at end of file
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "event_loop.h"
+#include "tcp_server.h"
+
+//旧进程排空连接的默认最长时间(毫秒)
+#define HOT_RESTART_DRAIN_TIMEOUT 30000
+//检查连接是否排空的间隔(毫秒)
+#define HOT_RESTART_DRAIN_INTERVAL 100
+
+/**
+ * 热重启：新进程通过unix socket(SCM_RIGHTS)从旧进程继承监听fd，
+ * 监听socket和它的accept backlog始终存在，重启期间不会拒绝连接
+ *
+ * 新进程启动顺序：预热BufferPool -> Inherit继承监听fd(没有旧进程则自己监听)
+ * -> 创建TcpServer -> Listen等待下一次重启
+ * 旧进程交出fd后停止accept，已建立的连接继续服务直到全部关闭或超时，然后退出事件循环
+ */
+class HotRestart {
+ public:
+  HotRestart(EventLoop* loop, const std::string& path);
+  ~HotRestart();
+
+  // 新进程连接旧进程并接收监听fd，顺序与旧进程AddServer的顺序一致
+  // 没有旧进程返回-1，可以冷启动；有旧进程但交接失败返回-2，
+  // 旧进程可能已经停止accept，调用方不应再自己监听
+  static int Inherit(const std::string& path, std::vector<int>* fds);
+
+  // 添加重启时要交出监听fd的TcpServer
+  void AddServer(TcpServer* server) { servers_.push_back(server); }
+  // 在path上等待新进程，失败返回-1
+  int Listen();
+  // 新进程连接，交出监听fd并开始排空
+  void DoHandoff();
+  // 设置排空连接的最长时间
+  void SetDrainTimeout(int timeout_ms) { drain_timeout_ms_ = timeout_ms; }
+  bool IsDraining() const { return draining_; }
+
+ private:
+  // 定时检查连接是否已经排空
+  void CheckDrained();
+
+  /// event_loop epoll事件机制
+  EventLoop* loop_;
+  /// unix socket路径
+  std::string path_;
+  /// unix socket
+  int sockfd_ = -1;
+  /// 要交接的TcpServer
+  std::vector<TcpServer*> servers_;
+  /// 排空连接的最长时间
+  int drain_timeout_ms_ = HOT_RESTART_DRAIN_TIMEOUT;
+  /// 排空的截止时间
+  uint64_t drain_deadline_ns_ = 0;
+  /// 检查排空的定时器
+  int drain_timer_ = -1;
+  /// 是否已经交出监听fd
+  bool draining_ = false;
+};
@@ -22,6 +22,8 @@ class IoBuffer : public std::enable_shared_from_this<IoBuffer> {
   void SetLength(int length) { length_ = length; }
   char* GetData() const { return data_; }
   int GetHead() const { return head_; }
+  int GetNode() const { return node_; }
+  void SetNode(int node) { node_ = node; }
 
  private:
   /// 当前io_buf所保存的数据地址
@@ -32,5 +34,7 @@ class IoBuffer : public std::enable_shared_from_this<IoBuffer> {
   int length_;
   /// 未处理数据的头部位置索引
   int head_;
+  /// 内存所属的numa节点，归还时回到对应节点的内存池
+  int node_;
   std::shared_ptr<IoBuffer> next_;
 };
\ No newline at end of file
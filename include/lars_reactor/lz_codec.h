@@ -0,0 +1,15 @@
+#pragma once
+
+/**
+ * LZ4块格式的压缩/解压，不依赖外部库
+ * 单遍贪心匹配，4K项哈希表放在栈上，适合消息级别(<=64K)的快速压缩
+ */
+class LzCodec {
+ public:
+  // 长度为n的数据压缩后的最大长度
+  static int Bound(int n) { return n + n / 255 + 16; }
+  // 压缩到dst，返回压缩后的长度，cap不够时返回0
+  static int Compress(const char* src, int n, char* dst, int cap);
+  // 解压到dst，返回解压后的长度，数据损坏或cap不够时返回-1
+  static int Decompress(const char* src, int n, char* dst, int cap);
+};
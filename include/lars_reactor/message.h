@@ -8,4 +8,25 @@ struct MsgHead {
 //消息头的二进制长度，固定数
 #define MESSAGE_HEAD_LEN 8
 //消息头+消息体的最大长度限制
-#define MESSAGE_LENGTH_LIMIT (65535 - MESSAGE_HEAD_LEN)
\ No newline at end of file
+#define MESSAGE_LENGTH_LIMIT (65535 - MESSAGE_HEAD_LEN)
+//大消息模式下，组装消息时每个IoBuffer分片的最大长度
+#define LARGE_MESSAGE_CHUNK (1024 * 1024)
+//大消息模式下，每个连接组装消息默认最多占用的内存
+#define LARGE_MESSAGE_DEFAULT_LIMIT (64 * 1024 * 1024)
+//所有连接正在组装的大消息合计最多占用的内存
+#define LARGE_MESSAGE_GLOBAL_LIMIT (1024LL * 1024 * 1024)
+
+//msg_len_的标志位，消息体经过压缩，前4字节(小端)为原始长度
+#define MSG_FLAG_COMPRESSED 0x40000000
+//大消息(包括分片模式)消息体的最大长度，必须小于MSG_FLAG_COMPRESSED，
+//开启压缩的连接上带该标志位的长度总是按压缩消息解析
+#define LARGE_MESSAGE_MAX_LEN (MSG_FLAG_COMPRESSED - 1)
+//压缩消息体中原始长度的字节数
+#define COMPRESS_HEAD_LEN 4
+//协商压缩使用的msg_id，消息体为8字节的随机数
+#define COMPRESS_NEGOTIATE_ID 0x7ffffffc
+//默认的压缩阈值，消息体小于该长度不压缩
+#define COMPRESS_DEFAULT_THRESHOLD 1024
+
+//rpc响应统一使用的msg_id
+#define RPC_RESPONSE_ID 0x7fffffff
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <unordered_map>
+
+#include "io_buffer.h"
+#include "net_connection.h"
+#include "profiler.h"
+
+// 消息处理的回调函数
+using msg_callback = std::function<void(const char* data, int len, int msg_id,
+                                        void* args, NetConnection* conn)>;
+// 大消息分片到达时的回调，offset为该分片在整个消息中的偏移
+using chunk_callback =
+    std::function<void(const char* data, int len, int offset, int total,
+                       int msg_id, void* args, NetConnection* conn)>;
+// 大消息组装完成后的回调，消息体保存在IoBuffer链表中，回调返回后归还内存池
+using chain_callback =
+    std::function<void(const std::shared_ptr<IoBuffer>& chain, int total,
+                       int msg_id, void* args, NetConnection* conn)>;
+
+/**
+ * 消息路由分发，根据msg_id找到对应的业务回调
+ */
+class MsgRouter {
+ public:
+  // 注册普通消息的回调，msg_id已经注册过返回-1
+  int Register(int msg_id, msg_callback callback, void* args = nullptr);
+  // 注册大消息逐片处理的回调
+  int RegisterChunk(int msg_id, chunk_callback callback, void* args = nullptr);
+  // 注册大消息组装完成后处理的回调
+  int RegisterChain(int msg_id, chain_callback callback, void* args = nullptr);
+  // 取消普通消息的回调，回调中持有外部对象时在对象销毁前取消
+  void Unregister(int msg_id) { routers_.erase(msg_id); }
+
+  // 调用普通消息的回调，没有注册返回false
+  bool Call(int msg_id, int len, const char* data, NetConnection* conn);
+  // 调用大消息分片回调，没有注册返回false
+  bool CallChunk(int msg_id, const char* data, int len, int offset, int total,
+                 NetConnection* conn);
+  // 调用大消息组装回调，没有注册返回false
+  bool CallChain(int msg_id, const std::shared_ptr<IoBuffer>& chain, int total,
+                 NetConnection* conn);
+
+  // 按采样统计回调的开销，profiler由调用方持有，nullptr表示关闭
+  void SetProfiler(HandlerProfiler* profiler) { profiler_ = profiler; }
+  HandlerProfiler* GetProfiler() const { return profiler_; }
+
+  bool HasChunk(int msg_id) const { return chunks_.count(msg_id) != 0; }
+  bool HasChain(int msg_id) const { return chains_.count(msg_id) != 0; }
+
+ private:
+  template <typename T>
+  struct Entry {
+    T callback_;
+    void* args_;
+  };
+  /// msg_id和普通消息回调的关系
+  std::unordered_map<int, Entry<msg_callback>> routers_;
+  /// msg_id和大消息分片回调的关系
+  std::unordered_map<int, Entry<chunk_callback>> chunks_;
+  /// msg_id和大消息组装回调的关系
+  std::unordered_map<int, Entry<chain_callback>> chains_;
+  /// 回调开销采样，nullptr表示不采样
+  HandlerProfiler* profiler_ = nullptr;
+};
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+class NetConnection;
+
+/**
+ * 连接的弱引用，连接关闭后Get返回nullptr
+ * 需要在回调返回之后继续使用连接(延迟回复、感知连接关闭)时持有它，
+ * 而不是保存NetConnection指针
+ */
+class ConnHandle {
+ public:
+  explicit ConnHandle(NetConnection* conn) : conn_(conn) {}
+
+  NetConnection* Get() const { return conn_; }
+  // 注册连接关闭时的回调，返回id用于取消
+  int AddCloseCallback(std::function<void()> callback) {
+    callbacks_.emplace_back(++next_id_, std::move(callback));
+    return next_id_;
+  }
+  void RemoveCloseCallback(int id) {
+    for (auto itr = callbacks_.begin(); itr != callbacks_.end(); ++itr) {
+      if (itr->first == id) {
+        callbacks_.erase(itr);
+        return;
+      }
+    }
+  }
+  // 连接关闭时由连接调用，执行并清空关闭回调
+  void Close() {
+    conn_ = nullptr;
+    std::vector<std::pair<int, std::function<void()>>> callbacks;
+    callbacks.swap(callbacks_);
+    for (auto& callback : callbacks) {
+      callback.second();
+    }
+  }
+
+ private:
+  /// 连接，关闭后为nullptr
+  NetConnection* conn_;
+  /// 关闭回调和它的id
+  std::vector<std::pair<int, std::function<void()>>> callbacks_;
+  int next_id_ = 0;
+};
+
+/**
+ * 网络连接的抽象，消息回调通过它回复消息，
+ * 不关心底层是tcp连接还是共享内存通道
+ */
+class NetConnection {
+ public:
+  virtual ~NetConnection() = default;
+  //发送消息的方法
+  virtual int SendMessage(const char* data, int msg_len, int msg_id) = 0;
+  //在输出缓冲区中追加一个消息头，返回msg_len字节消息体的写入位置，
+  //调用方在返回事件循环之前写完消息体；不支持就地写入返回nullptr
+  virtual char* AppendMessage(int msg_len, int msg_id) { return nullptr; }
+  //连接的弱引用，连接已经关闭时返回的引用Get为nullptr；不支持返回nullptr
+  virtual std::shared_ptr<ConnHandle> GetHandle() { return nullptr; }
+};
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <vector>
+
+//支持的最大numa节点个数
+#define MAX_NUMA_NODES 8
+
+/**
+ * 从/sys/devices/system/node读取的numa拓扑
+ * 不支持numa的机器上视为只有一个node 0
+ */
+class NumaTopology {
+ public:
+  //获取单例方法
+  static const NumaTopology& instance() {
+    static NumaTopology instance_;
+    return instance_;
+  }
+  // numa节点个数
+  int NodeCount() const { return static_cast<int>(node_cpus_.size()); }
+  // cpu所在的numa节点，未知cpu返回0
+  int NodeOfCpu(int cpu) const;
+  // numa节点上的全部cpu
+  const std::vector<int>& CpusOfNode(int node) const;
+  // 解析"0-3,8,10-11"格式的cpu列表
+  static std::vector<int> ParseCpuList(const char* list);
+
+ private:
+  NumaTopology();
+
+  /// 每个numa节点上的cpu列表
+  std::vector<std::vector<int>> node_cpus_;
+  /// cpu到numa节点的映射
+  std::vector<int> cpu_node_;
+};
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+//默认每PROFILE_DEFAULT_RATE次回调采样一次
+#define PROFILE_DEFAULT_RATE 100
+//BufferPool的内存块规格数，4K到8M
+#define PROFILE_SIZE_CLASSES 7
+//请求profile报告的msg_id，回复为按cpu时间排序的文本报告
+#define PROFILE_DUMP_ID 0x7ffffffb
+
+class MsgRouter;
+
+// 报告的排序方式
+enum ProfileSort { PROFILE_SORT_CPU, PROFILE_SORT_WALL, PROFILE_SORT_ALLOCS };
+
+// 一个msg_id被采样的回调的累计开销
+struct HandlerStats {
+  /// 采样次数
+  uint64_t samples_ = 0;
+  /// 墙上时间和线程cpu时间(ns)
+  uint64_t wall_ns_ = 0;
+  uint64_t cpu_ns_ = 0;
+  /// 单次最长墙上时间(ns)
+  uint64_t max_wall_ns_ = 0;
+  /// 回调期间各规格BufferPool内存块的分配次数
+  uint64_t allocs_[PROFILE_SIZE_CLASSES] = {0};
+
+  uint64_t TotalAllocs() const {
+    uint64_t total = 0;
+    for (uint64_t n : allocs_) {
+      total += n;
+    }
+    return total;
+  }
+};
+
+// 一次采样中正在进行的计数，由HandlerProfiler::Begin初始化
+struct ProfileSample {
+  uint64_t allocs_[PROFILE_SIZE_CLASSES];
+  /// 嵌套采样时外层的采样
+  ProfileSample* prev_;
+};
+
+/**
+ * 按msg_id统计消息回调的采样开销
+ * 每rate次回调采样一次，记录墙上时间、线程cpu时间(CLOCK_THREAD_CPUTIME_ID)
+ * 和回调期间按规格统计的BufferPool分配次数；未采样的回调只增加一个线程局部计数，
+ * 可以在线上一直开启
+ * 由MsgRouter::SetProfiler挂到路由上，多个线程共享一个路由时也可以使用
+ */
+class HandlerProfiler {
+ public:
+  explicit HandlerProfiler(int rate = PROFILE_DEFAULT_RATE) : rate_(rate) {}
+
+  // 每rate次回调采样一次，0表示关闭
+  void SetRate(int rate) { rate_.store(rate, std::memory_order_relaxed); }
+  int GetRate() const { return rate_.load(std::memory_order_relaxed); }
+  // 本次回调是否采样
+  bool Sample() {
+    int rate = rate_.load(std::memory_order_relaxed);
+    return rate > 0 && ++t_calls_ % static_cast<uint32_t>(rate) == 0;
+  }
+
+  // 开始一次采样，返回开始时间，回调结束后调用End
+  void Begin(ProfileSample* sample, uint64_t* wall_ns, uint64_t* cpu_ns);
+  // 结束一次采样，累加到msg_id的统计
+  void End(int msg_id, ProfileSample* sample, uint64_t wall_ns,
+           uint64_t cpu_ns);
+
+  // 一个msg_id的统计，没有采样过返回false
+  bool GetStats(int msg_id, HandlerStats* stats);
+  // 所有msg_id的统计，按sort从大到小排序
+  std::vector<std::pair<int, HandlerStats>> Report(
+      ProfileSort sort = PROFILE_SORT_CPU);
+  // 文本报告，每个msg_id一行
+  std::string Dump(ProfileSort sort = PROFILE_SORT_CPU);
+  void Reset();
+
+  // 收到msg_id消息时回复文本报告，超过MESSAGE_LENGTH_LIMIT时只回复开销最大的若干行
+  // 报告暴露内部的msg_id和开销，只注册在只监听本机的管理端口上
+  int AddDumpRouter(MsgRouter* router, int msg_id = PROFILE_DUMP_ID);
+
+  // BufferPool分配内存块时调用，只在采样的回调期间计数
+  static void CountAlloc(int size) {
+    if (t_sample_ != nullptr) {
+      t_sample_->allocs_[SizeClass(size)]++;
+    }
+  }
+  // 内存块容量对应的规格
+  static int SizeClass(int size);
+
+ private:
+  HandlerProfiler(const HandlerProfiler&);
+  const HandlerProfiler& operator=(const HandlerProfiler&);
+
+  /// 采样间隔
+  std::atomic<int> rate_;
+  /// 保护stats_
+  std::mutex mutex_;
+  /// msg_id的统计
+  std::unordered_map<int, HandlerStats> stats_;
+  /// 当前线程的回调次数
+  static thread_local uint32_t t_calls_;
+  /// 当前线程正在进行的采样，没有为nullptr
+  static thread_local ProfileSample* t_sample_;
+};
+
+// 作用域内的一次回调，profiler为空或本次不采样时没有额外开销
+class ProfileScope {
+ public:
+  ProfileScope(HandlerProfiler* profiler, int msg_id)
+      : profiler_(profiler != nullptr && profiler->Sample() ? profiler
+                                                            : nullptr),
+        msg_id_(msg_id) {
+    if (profiler_ != nullptr) {
+      profiler_->Begin(&sample_, &wall_ns_, &cpu_ns_);
+    }
+  }
+  ~ProfileScope() {
+    if (profiler_ != nullptr) {
+      profiler_->End(msg_id_, &sample_, wall_ns_, cpu_ns_);
+    }
+  }
+
+ private:
+  ProfileScope(const ProfileScope&);
+  const ProfileScope& operator=(const ProfileScope&);
+
+  HandlerProfiler* profiler_;
+  int msg_id_;
+  uint64_t wall_ns_ = 0;
+  uint64_t cpu_ns_ = 0;
+  ProfileSample sample_;
+};
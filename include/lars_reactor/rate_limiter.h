@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+//超过限流时，拒绝应答使用的msg_id，消息体为被拒绝消息的msg_id(4字节小端)
+#define RATE_REJECT_ID 0x7ffffffd
+//拒绝模式下obuf中待发送的数据达到该长度时改为暂停读，拒绝应答不再堆积
+#define RATE_REJECT_BACKLOG (16 * 1024)
+//超过在途上限时，暂停读的重试间隔(ns)
+#define RATE_INFLIGHT_RETRY_NS (1000 * 1000UL)
+
+//超过限流时的处理方式
+enum RateAction {
+  ///丢弃消息并回复RATE_REJECT_ID，对端不读应答时退化为暂停读
+  RATE_REJECT = 0,
+  ///消息留在ibuf中，暂停该连接的EPOLLIN直到令牌足够，由tcp窗口反压客户端
+  RATE_PAUSE = 1,
+};
+
+/**
+ * 准入控制：每个连接、每个msg_id的令牌桶，以及全局在途消息数上限
+ * 令牌桶用GCRA实现，每个桶只记录下一个令牌的理论到达时间(tat)，
+ * 按调用方传入的事件循环缓存时间惰性补充，检查时没有系统调用
+ * 不加锁，一个事件循环(TcpServer)一个
+ */
+class RateLimiter {
+ public:
+  explicit RateLimiter(RateAction action = RATE_PAUSE) : action_(action) {}
+
+  // 每个连接每秒最多rate个消息，最多积累burst个令牌，rate为0表示不限制
+  void SetConnLimit(int rate, int burst);
+  // msg_id每秒最多rate个消息(所有连接共享)，rate为0表示取消限制
+  void SetMsgLimit(int msg_id, int rate, int burst);
+  // 同时在处理中的消息数上限，0表示不限制
+  void SetMaxInflight(int max_inflight) { max_inflight_ = max_inflight; }
+  RateAction GetAction() const { return action_; }
+
+  // 新连接使用fd，重置该fd的令牌桶
+  void ResetConn(int fd);
+  // 检查并消耗令牌，now_ns为事件循环的缓存时间
+  // 允许返回0，否则返回还需要等待的时间(ns)，此时不消耗任何令牌
+  uint64_t Admit(int fd, int msg_id, uint64_t now_ns);
+
+  // 消息准入/处理结束(排队的消息分发完才结束)，
+  // 异步回复的业务可以多调用一次Hold，回复后再Release
+  void Hold() { ++inflight_; }
+  void Release() { --inflight_; }
+  int GetInflight() const { return inflight_; }
+
+  // 被拒绝和被暂停的次数
+  uint64_t GetRejected() const { return rejected_; }
+  uint64_t GetPaused() const { return paused_; }
+  void CountShed(RateAction action) {
+    ++(action == RATE_REJECT ? rejected_ : paused_);
+  }
+
+ private:
+  // 令牌桶配置
+  struct Bucket {
+    ///每个令牌的间隔，0表示不限制
+    uint64_t interval_ns_ = 0;
+    ///允许提前的时间，(burst-1)*interval
+    uint64_t tolerance_ns_ = 0;
+  };
+  struct MsgBucket {
+    Bucket limit_;
+    uint64_t tat_ = 0;
+  };
+
+  static Bucket MakeBucket(int rate, int burst);
+  // 检查一个桶，返回需要等待的时间
+  static uint64_t Wait(const Bucket& bucket, uint64_t tat, uint64_t now_ns) {
+    uint64_t allow_at = tat > bucket.tolerance_ns_ ? tat - bucket.tolerance_ns_ : 0;
+    return allow_at > now_ns ? allow_at - now_ns : 0;
+  }
+  // 消耗一个令牌之后的tat
+  static uint64_t Next(const Bucket& bucket, uint64_t tat, uint64_t now_ns) {
+    return (tat > now_ns ? tat : now_ns) + bucket.interval_ns_;
+  }
+
+  ///超过限流时的处理方式
+  RateAction action_;
+  ///每个连接的限流配置
+  Bucket conn_limit_;
+  ///每个连接的tat，下标为fd
+  std::vector<uint64_t> conn_tat_;
+  ///每个msg_id的限流配置和tat
+  std::unordered_map<int, MsgBucket> msg_buckets_;
+  ///在途消息数上限
+  int max_inflight_ = 0;
+  ///当前在途消息数
+  int inflight_ = 0;
+  uint64_t rejected_ = 0;
+  uint64_t paused_ = 0;
+};
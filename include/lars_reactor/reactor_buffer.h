@@ -2,6 +2,8 @@
 
 #include "io_buffer.h"
 #include "buffer_pool.h"
+#include "ring_buffer.h"
+#include "tls_session.h"
 
 class ReactorBuffer {
  public:
@@ -11,25 +13,54 @@ class ReactorBuffer {
   int Length() const;
   void Pop(int len);
   void Clear();
+  //改用环形缓冲区，之后Pop只移动head，不再需要Adjust的memmove
+  //只能在缓冲区为空时切换
+  bool EnableRing(int size = RING_BUFFER_DEFAULT_SIZE);
+  //退回普通缓冲区，只能在缓冲区为空时切换
+  bool DisableRing();
+  bool IsRing() const { return ring_ != nullptr; }
+  //是否持有内存池的buffer，空闲时应当为false
+  bool HasBuffer() const { return buffer_ != nullptr; }
 
  protected:
   std::shared_ptr<IoBuffer> buffer_;
+  std::unique_ptr<RingBuffer> ring_;
 };
 
 class InputBuffer : public ReactorBuffer {
  public:
   //从一个fd中读取数据到reactor_buf中
   int ReadData(int fd);
+  //通过用户态tls读取全部可读的数据，暂无数据返回TLS_AGAIN
+  int ReadTls(TlsSession* tls);
   //取出读到的数据
   char *Data() const;
   //重置缓冲区
   void Adjust();
+
+ private:
+  //环形缓冲区模式下的读取
+  int ReadRing(int fd, int need_read);
+  //保证buffer末尾至少有len字节的空闲空间
+  bool Reserve(int len);
 };
 
 class OutputBuffer : public ReactorBuffer {
  public:
   //将一段数据 写到一个reactor_buf中
   int SentData(const char* data,int len);
+  //在reactor_buf末尾预留len字节并返回写入位置，失败返回nullptr
+  char* Append(int len);
+  //撤销最后Append的len字节中未使用的部分
+  void Trim(int len);
   //将reactor_buf中的数据写到一个fd中
   int WriteFd(int fd);
+  //最多将reactor_buf中的前len字节数据写到一个fd中
+  int WriteFd(int fd, int len);
+  //最多将前len字节数据通过用户态tls写出
+  int WriteTls(TlsSession* tls, int len);
+
+ private:
+  //写出了len字节，从缓冲区中移除
+  void Consume(int len);
 };
\ No newline at end of file
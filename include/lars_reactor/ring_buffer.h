@@ -0,0 +1,48 @@
+#pragma once
+
+//环形缓冲区默认大小，至少能容纳两个最大长度的消息
+#define RING_BUFFER_DEFAULT_SIZE (128 * 1024)
+
+/**
+ * 基于memfd双重映射的环形缓冲区
+ * 同一段物理内存被连续映射两次，任意位置开始的数据在虚拟地址上
+ * 都是连续的，因此跨越环尾的数据也不需要拼接或memmove
+ */
+class RingBuffer {
+ public:
+  // size会向上取整到页大小
+  explicit RingBuffer(int size);
+  ~RingBuffer();
+
+  // 映射是否成功
+  bool Valid() const { return base_ != nullptr; }
+  // 未处理数据的起始地址，Length()个字节连续可读
+  char* Data() const { return base_ + head_; }
+  // 可写入位置的起始地址，Free()个字节连续可写
+  char* Tail() const { return base_ + (head_ + length_) % capacity_; }
+  // 处理长度为len的数据，只移动head
+  void Pop(int len);
+  // 提交已经写入Tail()的len字节数据
+  void Push(int len);
+  // 撤销最后提交的len字节
+  void Unpush(int len) { length_ -= len; }
+  // 清空数据
+  void Clear() { head_ = length_ = 0; }
+
+  int GetCapacity() const { return capacity_; }
+  int GetLength() const { return length_; }
+  int GetFree() const { return capacity_ - length_; }
+
+ private:
+  RingBuffer(const RingBuffer&);
+  const RingBuffer& operator=(const RingBuffer&);
+
+  /// 双重映射区域的起始地址，大小为2*capacity_
+  char* base_;
+  /// 缓冲区容量
+  int capacity_;
+  /// 未处理数据的头部位置索引，始终小于capacity_
+  int head_;
+  /// 有效数据长度
+  int length_;
+};
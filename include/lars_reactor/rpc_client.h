@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "event_loop.h"
+#include "msg_router.h"
+#include "net_connection.h"
+#include "rpc_server.h"
+
+// rpc调用完成的回调，status为RpcStatus，非RPC_OK时data为空
+using rpc_callback = std::function<void(int status, const char* data, int len)>;
+
+//超时时间轮每格的时长(毫秒)，与事件循环的最长等待时间一致
+#define RPC_WHEEL_TICK_MS 10
+//超时时间轮的格数，必须是2的幂
+#define RPC_WHEEL_SIZE 512
+
+/**
+ * 单个连接上的rpc客户端，支持同一连接上大量并发请求乱序返回
+ * 请求id = 代数<<32 | 槽位下标，响应直接按下标找到待完成的调用，
+ * 超时由哈希时间轮处理，插入、删除、匹配都是O(1)
+ */
+class RpcClient {
+ public:
+  // 在router上注册RPC_RESPONSE_ID，析构时取消注册
+  // 连接关闭时以RPC_CLOSED结束全部未完成的调用，之后的调用失败
+  RpcClient(EventLoop* loop, NetConnection* conn, MsgRouter* router);
+  ~RpcClient();
+
+  // 发起调用，timeout_ms为0表示不限制，返回请求id，发送失败返回0
+  // RPC_RESPONSE_ID注册失败或连接已经关闭时也返回0
+  uint64_t Call(int msg_id, const char* data, int len, uint32_t timeout_ms,
+                rpc_callback callback);
+  // 连接断开时以RPC_CLOSED结束全部未完成的调用
+  void FailAll();
+  // 未完成的调用数
+  size_t GetPendingNum() const { return pending_num_; }
+
+  // 收到响应，由RPC_RESPONSE_ID的路由回调调用
+  void OnResponse(const char* data, int len);
+  // 时间轮前进，处理到期的调用
+  void OnTick();
+
+ private:
+  struct PendingCall {
+    /// 槽位当前的代数，每次复用加1，用于识别过期的响应
+    uint32_t generation_ = 0;
+    /// 是否在使用
+    bool used_ = false;
+    /// 超时时间，0表示不限制
+    uint64_t deadline_ns_ = 0;
+    /// 完成回调
+    rpc_callback callback_;
+    /// 时间轮同一格中的前后槽位，-1表示没有
+    int prev_ = -1;
+    int next_ = -1;
+    /// 所在的时间轮格，-1表示不在时间轮中
+    int bucket_ = -1;
+  };
+
+  // 分配一个空闲槽位
+  int Alloc();
+  // 从时间轮中摘除并释放槽位，返回槽位中的回调
+  rpc_callback Release(int slot);
+  void Link(int slot, int bucket);
+  void Unlink(int slot);
+
+  /// 所属的event_loop
+  EventLoop* loop_;
+  /// 请求所在的连接，关闭后为nullptr
+  NetConnection* conn_;
+  /// 连接的弱引用和关闭回调的id，连接不支持时为空
+  std::shared_ptr<ConnHandle> handle_;
+  int close_id_ = -1;
+  /// 注册了RPC_RESPONSE_ID的路由，注册失败为nullptr
+  MsgRouter* router_;
+  /// 全部槽位
+  std::vector<PendingCall> calls_;
+  /// 空闲槽位
+  std::vector<int> free_slots_;
+  /// 时间轮每格的第一个槽位
+  std::vector<int> wheel_;
+  /// 时间轮当前处理到的tick
+  uint64_t tick_ = 0;
+  /// 时间轮定时器，没有带超时的调用时不运行
+  int timer_id_ = -1;
+  /// 未完成的调用数
+  size_t pending_num_ = 0;
+  /// 带超时的调用数
+  size_t timed_num_ = 0;
+};
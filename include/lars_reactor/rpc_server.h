@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "event_loop.h"
+#include "msg_router.h"
+#include "net_connection.h"
+#include "schema.h"
+
+//rpc消息的扩展头，放在消息体最前面，MsgHead本身不变
+//request_id: 请求id，响应原样带回用于匹配
+//timeout_ms: 请求剩余的超时时间(毫秒)，0表示不限制
+//status: 响应状态，见RpcStatus
+using RpcHeadSchema = Schema<Field<uint64_t>, Field<uint32_t>, Field<uint32_t>>;
+enum { kRpcRequestId, kRpcTimeout, kRpcStatus };
+//rpc扩展头的二进制长度
+#define RPC_HEAD_LEN static_cast<int>(RpcHeadSchema::kSize)
+
+// rpc响应状态
+enum RpcStatus {
+  RPC_OK = 0,
+  // 超过deadline
+  RPC_TIMEOUT = 1,
+  // 连接断开，请求没有响应
+  RPC_CLOSED = 2,
+};
+
+/**
+ * 一次rpc请求的上下文，处理回调可以拷贝保存，稍后再回复
+ * 拷贝出的上下文只持有连接的弱引用，连接关闭之后回复返回-1
+ */
+class RpcContext {
+ public:
+  RpcContext(NetConnection* conn, uint64_t request_id, uint64_t deadline_ns)
+      : conn_(conn), request_id_(request_id), deadline_ns_(deadline_ns) {}
+  RpcContext(const RpcContext& other);
+  RpcContext& operator=(const RpcContext& other);
+
+  // 回复请求，连接已经关闭或发送失败返回-1
+  int Reply(const char* data, int len) const;
+  uint64_t GetRequestId() const { return request_id_; }
+  // 请求的deadline(CLOCK_MONOTONIC)，0表示不限制，可用于向下游传递剩余时间
+  uint64_t GetDeadlineNs() const { return deadline_ns_; }
+  // 请求所在的连接，已经关闭返回nullptr
+  NetConnection* GetConn() const {
+    return handle_ != nullptr ? handle_->Get() : conn_;
+  }
+
+ private:
+  /// 请求所在的连接，只在处理回调期间使用，拷贝出的上下文为nullptr
+  NetConnection* conn_;
+  /// 拷贝出的上下文持有的连接弱引用
+  std::shared_ptr<ConnHandle> handle_;
+  /// 请求id
+  uint64_t request_id_;
+  /// 请求的deadline
+  uint64_t deadline_ns_;
+};
+
+// rpc请求的处理回调
+using rpc_handler =
+    std::function<void(const char* data, int len, const RpcContext& ctx)>;
+
+/**
+ * rpc服务端，把带RpcHead的请求注册到MsgRouter
+ * deadline从读到请求的那一轮事件循环开始计算，处理回调执行前已经超时的请求直接丢弃
+ */
+class RpcServer {
+ public:
+  RpcServer(EventLoop* loop, MsgRouter* router);
+
+  // 注册一个rpc请求的处理回调，msg_id已经注册过返回-1
+  int Register(int msg_id, rpc_handler handler);
+  // 执行前已经超时被丢弃的请求数
+  uint64_t GetExpiredNum() const { return expired_; }
+
+  // 回复请求，RpcContext::Reply调用
+  static int SendResponse(NetConnection* conn, uint64_t request_id,
+                          uint32_t status, const char* data, int len);
+
+ private:
+  void OnRequest(const char* data, int len, NetConnection* conn,
+                 const rpc_handler& handler);
+
+  /// 所属的event_loop
+  EventLoop* loop_;
+  /// 消息路由
+  MsgRouter* router_;
+  /// 超时丢弃的请求数
+  uint64_t expired_ = 0;
+};
@@ -0,0 +1,229 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <tuple>
+#include <type_traits>
+
+#include "message.h"
+#include "msg_router.h"
+#include "net_connection.h"
+
+/**
+ * 编译期声明的消息格式
+ * 字段按声明顺序紧密排列，整数在网络上统一为小端序，与主机字节序无关
+ * 大小和偏移在编译期计算，视图直接读输入缓冲区中的数据，构造器直接写输出缓冲区
+ *
+ * 用法:
+ *   using RouteRequest = Schema<Field<int32_t>, Field<int32_t>>;
+ *   enum { kModid, kCmdid };
+ *   view.Get<kModid>(); builder.Set<kCmdid>(2);
+ */
+
+// 按小端序读写整数，小端主机上就是一次memcpy
+template <typename T>
+inline T LoadLE(const char* data) {
+  static_assert(std::is_integral<T>::value, "only integers are supported");
+  using U = typename std::make_unsigned<T>::type;
+  U value;
+  memcpy(&value, data, sizeof(U));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  U swapped = 0;
+  for (size_t i = 0; i < sizeof(U); ++i) {
+    swapped = static_cast<U>((swapped << 8) | ((value >> (8 * i)) & 0xff));
+  }
+  value = swapped;
+#endif
+  return static_cast<T>(value);
+}
+
+template <typename T>
+inline void StoreLE(char* data, T value) {
+  static_assert(std::is_integral<T>::value, "only integers are supported");
+  using U = typename std::make_unsigned<T>::type;
+  U raw = static_cast<U>(value);
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  U swapped = 0;
+  for (size_t i = 0; i < sizeof(U); ++i) {
+    swapped = static_cast<U>((swapped << 8) | ((raw >> (8 * i)) & 0xff));
+  }
+  raw = swapped;
+#endif
+  memcpy(data, &raw, sizeof(U));
+}
+
+// 整数字段
+template <typename T>
+struct Field {
+  using value_type = T;
+  static constexpr size_t kSize = sizeof(T);
+  static T Load(const char* data) { return LoadLE<T>(data); }
+  static void Store(char* data, T value) { StoreLE<T>(data, value); }
+};
+
+// 定长字节字段，读取时返回指向缓冲区的指针，不拷贝
+template <size_t N>
+struct Bytes {
+  using value_type = const char*;
+  static constexpr size_t kSize = N;
+  static const char* Load(const char* data) { return data; }
+  static void Store(char* data, const char* value) { memcpy(data, value, N); }
+};
+
+template <typename... Fs>
+struct SchemaSize;
+template <>
+struct SchemaSize<> {
+  static constexpr size_t value = 0;
+};
+template <typename F, typename... Fs>
+struct SchemaSize<F, Fs...> {
+  static constexpr size_t value = F::kSize + SchemaSize<Fs...>::value;
+};
+
+template <size_t I, typename... Fs>
+struct SchemaOffset;
+template <typename F, typename... Fs>
+struct SchemaOffset<0, F, Fs...> {
+  static constexpr size_t value = 0;
+};
+template <size_t I, typename F, typename... Fs>
+struct SchemaOffset<I, F, Fs...> {
+  static constexpr size_t value = F::kSize + SchemaOffset<I - 1, Fs...>::value;
+};
+
+template <typename... Fs>
+struct Schema {
+  /// 定长部分的字节数
+  static constexpr size_t kSize = SchemaSize<Fs...>::value;
+  /// 字段个数
+  static constexpr size_t kFields = sizeof...(Fs);
+  template <size_t I>
+  using FieldAt = typename std::tuple_element<I, std::tuple<Fs...>>::type;
+  template <size_t I>
+  static constexpr size_t Offset() {
+    return SchemaOffset<I, Fs...>::value;
+  }
+};
+
+// C++14中被ODR使用(如绑定到引用)的constexpr静态成员需要类外定义
+template <typename... Fs>
+constexpr size_t Schema<Fs...>::kSize;
+template <typename... Fs>
+constexpr size_t Schema<Fs...>::kFields;
+
+/**
+ * 消息的只读视图，指向输入缓冲区，只在消息回调内有效
+ * 定长部分之后的数据作为变长尾部(如数组)
+ */
+template <typename S>
+class MsgView {
+ public:
+  MsgView(const char* data, int len) : data_(data), len_(len) {}
+
+  // 数据至少包含定长部分
+  bool Valid() const { return len_ >= 0 && static_cast<size_t>(len_) >= S::kSize; }
+  template <size_t I>
+  typename S::template FieldAt<I>::value_type Get() const {
+    return S::template FieldAt<I>::Load(data_ + S::template Offset<I>());
+  }
+  // 定长部分之后的数据
+  const char* Tail() const { return data_ + S::kSize; }
+  int TailLength() const { return len_ - static_cast<int>(S::kSize); }
+  const char* Data() const { return data_; }
+  int Length() const { return len_; }
+
+ private:
+  const char* data_;
+  int len_;
+};
+
+/**
+ * 定长记录数组的视图，用于消息尾部
+ */
+template <typename S>
+class ArrayView {
+ public:
+  ArrayView(const char* data, int len) : data_(data), len_(len) {}
+
+  int Size() const { return len_ / static_cast<int>(S::kSize); }
+  MsgView<S> operator[](int i) const {
+    return MsgView<S>(data_ + i * S::kSize, static_cast<int>(S::kSize));
+  }
+
+ private:
+  const char* data_;
+  int len_;
+};
+
+/**
+ * 消息构造器，直接在目标缓冲区中编码
+ */
+template <typename S>
+class MsgBuilder {
+ public:
+  explicit MsgBuilder(char* data) : data_(data) {}
+
+  template <size_t I>
+  MsgBuilder& Set(typename S::template FieldAt<I>::value_type value) {
+    S::template FieldAt<I>::Store(data_ + S::template Offset<I>(), value);
+    return *this;
+  }
+  // 定长部分之后的数据
+  char* Tail() const { return data_ + S::kSize; }
+
+ private:
+  char* data_;
+};
+
+// 以typed视图注册消息回调，长度不足定长部分的消息直接丢弃
+template <typename S>
+int RegisterView(MsgRouter* router, int msg_id,
+                 std::function<void(const MsgView<S>& view, NetConnection* conn)>
+                     callback) {
+  return router->Register(
+      msg_id, [callback](const char* data, int len, int msg_id, void* args,
+                         NetConnection* conn) {
+        MsgView<S> view(data, len);
+        if (!view.Valid()) {
+          std::cerr << "message too short for schema, msg_id: " << msg_id
+                    << " len: " << len << std::endl;
+          return;
+        }
+        callback(view, conn);
+      });
+}
+
+// 在连接的输出缓冲区中直接编码并发送消息，tail_len为定长部分之后的长度
+// 连接不支持就地编码时先编码到临时缓冲区再发送，失败返回-1
+template <typename S, typename Fill>
+int SendView(NetConnection* conn, int msg_id, Fill fill, int tail_len = 0) {
+  int msg_len = static_cast<int>(S::kSize) + tail_len;
+  char* body = conn->AppendMessage(msg_len, msg_id);
+  if (body != nullptr) {
+    MsgBuilder<S> builder(body);
+    fill(builder);
+    return 0;
+  }
+  std::string buf(msg_len, '\0');
+  MsgBuilder<S> builder(&buf[0]);
+  fill(builder);
+  return conn->SendMessage(buf.data(), msg_len, msg_id);
+}
+
+// 消息头的线上格式: msg_id, msg_len
+using MsgHeadSchema = Schema<Field<int32_t>, Field<int32_t>>;
+static_assert(MsgHeadSchema::kSize == MESSAGE_HEAD_LEN, "MsgHead wire size");
+
+inline MsgHead DecodeHead(const char* data) {
+  MsgView<MsgHeadSchema> view(data, MESSAGE_HEAD_LEN);
+  return MsgHead{view.Get<0>(), view.Get<1>()};
+}
+
+inline void EncodeHead(char* data, int msg_id, int msg_len) {
+  MsgBuilder<MsgHeadSchema>(data).Set<0>(msg_id).Set<1>(msg_len);
+}
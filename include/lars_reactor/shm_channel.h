@@ -0,0 +1,153 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "event_loop.h"
+#include "message.h"
+#include "msg_router.h"
+#include "net_connection.h"
+
+//共享内存通道每个方向的默认环大小
+#define SHM_RING_DEFAULT_SIZE (1024 * 1024)
+//每个方向环大小的下限，至少能放下一条最长的消息
+#define SHM_RING_MIN_SIZE (MESSAGE_HEAD_LEN + MESSAGE_LENGTH_LIMIT)
+//每个方向环大小的上限，双重映射的2倍大小不会溢出int
+#define SHM_RING_MAX_SIZE (1 << 30)
+
+// 共享内存环的控制头，生产者和消费者的位置放在不同缓存行
+struct ShmRingHeader {
+  /// 消费者位置
+  alignas(64) std::atomic<uint64_t> head_;
+  /// 生产者位置
+  alignas(64) std::atomic<uint64_t> tail_;
+  /// 消费者是否已经(或即将)阻塞在epoll上，为1时生产者需要敲doorbell
+  alignas(64) std::atomic<uint32_t> waiting_;
+};
+
+/**
+ * 同一主机进程间的共享内存通道，单生产者单消费者
+ * 一个memfd中包含两个方向的环(环数据双重映射，消息总是连续的)，
+ * 每个方向一个eventfd作为doorbell，消息格式与tcp相同(MsgHead+消息体)，
+ * 收到的消息交给与TcpConn相同的MsgRouter处理
+ *
+ * doorbell自适应抑制：消费者处理消息期间waiting_为0，
+ * 生产者只有在消费者即将休眠时才写eventfd，唤醒后的连续消息不再触发系统调用
+ */
+class ShmChannel : public NetConnection {
+ public:
+  ~ShmChannel() override;
+
+  // 服务端创建通道，ring_size为每个方向环的大小，向上取整到页大小，
+  // 不在[SHM_RING_MIN_SIZE, SHM_RING_MAX_SIZE]范围内返回nullptr
+  static std::unique_ptr<ShmChannel> Create(EventLoop* loop, MsgRouter* router,
+                                            int ring_size = SHM_RING_DEFAULT_SIZE);
+  // 通过unix socket把通道的fd发给客户端，失败返回-1
+  int SendFds(int unix_fd) const;
+  // 客户端从unix socket接收fd并映射通道，通道接管unix_fd，
+  // 对端给出的环大小和memfd大小不匹配时拒绝，失败返回nullptr
+  static std::unique_ptr<ShmChannel> RecvFds(int unix_fd, EventLoop* loop,
+                                             MsgRouter* router);
+  // 客户端连接本机path上的ShmServer，失败返回nullptr
+  static std::unique_ptr<ShmChannel> Connect(const std::string& path,
+                                             EventLoop* loop,
+                                             MsgRouter* router);
+
+  // 发送消息，环满或通道已关闭返回-1，对端改坏了环的位置时关闭通道
+  int SendMessage(const char* data, int msg_len, int msg_id) override;
+  // 通道的弱引用，通道关闭或销毁后失效
+  std::shared_ptr<ConnHandle> GetHandle() override;
+  // doorbell触发，处理接收环中的全部消息，消息格式错误时关闭通道
+  void DoRead();
+  // 停止收发并关闭unix socket，对端和ShmServer由此感知通道关闭
+  void Close();
+  bool IsClosed() const { return closed_; }
+
+  // 发送了多少次doorbell，用于观察抑制效果
+  uint64_t GetDoorbellNum() const { return doorbells_; }
+  // 没有注册回调被丢弃的消息数
+  uint64_t GetUnroutedNum() const { return unrouted_; }
+
+ private:
+  friend class ShmServer;
+
+  ShmChannel(EventLoop* loop, MsgRouter* router);
+  ShmChannel(const ShmChannel&);
+  const ShmChannel& operator=(const ShmChannel&);
+
+  // 映射memfd，server决定收发环的方向，失败返回-1
+  int Map(int memfd, int ring_size, bool server);
+  // 双重映射一个环的数据区
+  char* MapRing(int memfd, off_t offset);
+  // 注册doorbell读事件
+  void Register();
+
+  /// 所属的event_loop
+  EventLoop* loop_;
+  /// 消息路由
+  MsgRouter* router_;
+  /// 共享内存fd
+  int memfd_ = -1;
+  /// 客户端和服务端之间的unix socket，客户端的由通道持有，
+  /// 服务端的由ShmServer持有
+  int unix_fd_ = -1;
+  bool own_unix_fd_ = false;
+  /// 是否已经关闭
+  bool closed_ = false;
+  /// 通道的弱引用，没有用到时为空
+  std::shared_ptr<ConnHandle> handle_;
+  /// 收到消息的doorbell，发送消息的doorbell
+  int recv_efd_ = -1;
+  int send_efd_ = -1;
+  /// 每个方向环的大小
+  int ring_size_ = 0;
+  /// 控制头页
+  void* header_page_ = nullptr;
+  /// 接收环和发送环
+  ShmRingHeader* recv_header_ = nullptr;
+  ShmRingHeader* send_header_ = nullptr;
+  char* recv_data_ = nullptr;
+  char* send_data_ = nullptr;
+  /// 发送的doorbell次数
+  uint64_t doorbells_ = 0;
+  /// 没有注册回调的消息数
+  uint64_t unrouted_ = 0;
+};
+
+/**
+ * 共享内存通道的服务端，在unix socket上接受本机客户端，
+ * 为每个客户端创建一个ShmChannel，unix socket保持打开用于感知客户端退出
+ */
+class ShmServer {
+ public:
+  ShmServer(EventLoop* loop, const std::string& path,
+            int ring_size = SHM_RING_DEFAULT_SIZE);
+  ~ShmServer();
+
+  void DoAccept();
+  // 客户端关闭了unix socket
+  void DoClose(int fd);
+  // 注册一个消息的处理回调
+  int AddMsgRouter(int msg_id, msg_callback callback, void* args = nullptr) {
+    return router_.Register(msg_id, std::move(callback), args);
+  }
+  MsgRouter& GetRouter() { return router_; }
+  size_t GetChannelNum() const { return channels_.size(); }
+
+ private:
+  /// unix socket
+  int sockfd_;
+  /// unix socket路径
+  std::string path_;
+  /// event_loop epoll事件机制
+  EventLoop* loop_;
+  /// 每个方向环的大小
+  int ring_size_;
+  /// 消息路由
+  MsgRouter router_;
+  /// unix socket fd和通道的关系
+  std::unordered_map<int, std::unique_ptr<ShmChannel>> channels_;
+};
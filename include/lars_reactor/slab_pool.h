@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+
+//slab按SLAB_ALIGN分级，最大管理SLAB_MAX_SIZE字节的对象
+#define SLAB_ALIGN 16
+#define SLAB_MAX_SIZE 512
+//每次向系统申请的slab大小
+#define SLAB_CHUNK_SIZE (64 * 1024)
+
+/**
+ * 小对象的slab分配器，同一分级的对象从整块内存中切分，没有malloc的块头开销，
+ * 释放的对象留在本线程的空闲链表中复用，内存不归还系统
+ * 用于数量巨大的连接对象
+ */
+class SlabPool {
+ public:
+  static void* Alloc(size_t size);
+  static void Free(void* ptr, size_t size);
+};
+
+// 配合std::allocate_shared使用，控制块和对象一起从slab分配
+template <typename T>
+struct SlabAllocator {
+  using value_type = T;
+
+  SlabAllocator() = default;
+  template <typename U>
+  SlabAllocator(const SlabAllocator<U>&) {}
+
+  T* allocate(size_t n) { return static_cast<T*>(SlabPool::Alloc(n * sizeof(T))); }
+  void deallocate(T* ptr, size_t n) { SlabPool::Free(ptr, n * sizeof(T)); }
+
+  template <typename U>
+  bool operator==(const SlabAllocator<U>&) const { return true; }
+  template <typename U>
+  bool operator!=(const SlabAllocator<U>&) const { return false; }
+};
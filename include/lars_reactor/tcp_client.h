@@ -0,0 +1,81 @@
+#pragma once
+#include <netinet/in.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "event_loop.h"
+#include "msg_router.h"
+
+//连接失败后第一次重试的等待时间，之后每次翻倍
+#define CLIENT_RETRY_MIN_MS 100
+//连接失败后重试的最长等待时间
+#define CLIENT_RETRY_MAX_MS 10000
+//连接建立之前最多缓存的消息字节数
+#define CLIENT_PENDING_LIMIT (256 * 1024)
+
+class TcpConn;
+class TlsContext;
+
+class TcpClient {
+ public:
+  TcpClient(EventLoop* loop, const char* ip, uint16_t port);
+  ~TcpClient();
+
+  // 非阻塞连接服务端，已经连接返回0，正在连接返回1，失败返回-1
+  // 连接失败后按指数退避，退避期间直接返回-1，不再发起连接
+  int Connect();
+  // 连接是否可用
+  bool IsConnected() const;
+  // 是否正在等待连接完成
+  bool IsConnecting() const { return connect_fd_ != -1; }
+  // 发送消息，正在连接时缓存到连接建立之后发送，未连接返回-1
+  int SendMessage(const char* data, int msg_len, int msg_id);
+  // 可写事件回调，完成正在进行的连接
+  void DoConnect();
+  // 注册一个消息的处理回调
+  int AddMsgRouter(int msg_id, msg_callback callback, void* args = nullptr) {
+    return router_.Register(msg_id, std::move(callback), args);
+  }
+  MsgRouter& GetRouter() { return router_; }
+  // 之后的连接开启tls，ctx由调用方持有；校验证书时检查服务端的名字是host，
+  // host为空时使用连接的ip
+  void SetTls(TlsContext* ctx, const std::string& host = "") {
+    tls_ctx_ = ctx;
+    tls_host_ = host;
+  }
+  // 之后的连接协商压缩，不小于threshold的消息压缩发送，0表示不开启
+  void SetCompression(int threshold) { compress_threshold_ = threshold; }
+  TcpConn* GetConn() const { return conn_.get(); }
+
+ private:
+  // 连接建立之后创建TcpConn并发送缓存的消息
+  int OnConnected(int sockfd);
+  // 连接失败，丢弃缓存的消息并推迟下一次连接
+  void OnConnectFailed();
+
+  /// 服务端地址
+  struct sockaddr_in server_addr_ {};
+  /// event_loop epoll事件机制
+  EventLoop* loop_;
+  /// 消息路由
+  MsgRouter router_;
+  /// tls配置，nullptr表示不开启
+  TlsContext* tls_ctx_ = nullptr;
+  /// 证书中期望的服务端名字，为空表示使用服务端ip
+  std::string tls_host_;
+  /// 压缩阈值，0表示不开启
+  int compress_threshold_ = 0;
+  /// 当前连接
+  std::shared_ptr<TcpConn> conn_;
+  /// 正在连接的socket，-1表示没有
+  int connect_fd_ = -1;
+  /// 连接建立之前缓存的消息(msg_id, 消息体)
+  std::vector<std::pair<int, std::string>> pending_;
+  int pending_bytes_ = 0;
+  /// 当前的退避时间，0表示上次连接成功
+  int retry_ms_ = 0;
+  /// 退避结束的时间(ns)
+  uint64_t retry_at_ns_ = 0;
+};
@@ -1,12 +1,47 @@
 #pragma once
 
+#include <sys/types.h>
+
+#include <atomic>
+#include <deque>
+
 #include "reactor_buffer.h"
+#include "dispatch_scheduler.h"
 #include "event_loop.h"
-//一个tcp的连接信息
-class TcpConn {
+#include "message.h"
+#include "msg_router.h"
+#include "rate_limiter.h"
+#include "tls_session.h"
+
+class TcpServer;
+
+//空闲连接对象的大小上限
+#define TCP_CONN_MAX_SIZE 128
+
+//待发送的文件片段，由sendfile/splice直接从内核发送，不经过用户态buf
+struct FileSegment {
+  ///发送该片段之前需要先写出的obuf数据长度
+  int prior_bytes_;
+  ///文件描述符(dup得到，发送完毕后关闭)
+  int fd_;
+  ///文件偏移，仅普通文件有效
+  off_t offset_;
+  ///剩余未发送的长度
+  size_t remain_;
+  ///是否为普通文件，普通文件用sendfile，否则通过管道splice
+  bool regular_;
+};
+//本端开启了压缩
+#define COMPRESS_LOCAL 0x1
+//对端开启了压缩
+#define COMPRESS_PEER 0x2
+
+//一个tcp的连接信息，空闲时只占用对象本身(不超过TCP_CONN_MAX_SIZE)，不持有buffer
+class TcpConn : public NetConnection {
  public:
-  //初始化tcp_conn
-  TcpConn(int connfd,EventLoop* loop);
+  //初始化tcp_conn，server为空时不使用消息路由，所有消息回显
+  TcpConn(int connfd, EventLoop* loop, TcpServer* server = nullptr);
+  ~TcpConn() override;
   //处理读业务
   void DoRead();
   //处理写业务
@@ -14,17 +49,193 @@ class TcpConn {
   //销毁tcp_conn
   void CleanConn();
   //发送消息的方法
-  int SendMessage(const char* data,int msg_len,int msg_id);
+  int SendMessage(const char* data, int msg_len, int msg_id) override;
+  //在obuf中直接写消息，返回消息体的写入位置
+  char* AppendMessage(int msg_len, int msg_id) override;
+  //连接的弱引用，保存在ConnExtra中，没有其他持有者时随ConnExtra释放
+  std::shared_ptr<ConnHandle> GetHandle() override;
+  //发送一个消息头，消息体为fd从offset开始的len字节数据
+  //fd会被dup，调用后可以立即关闭；非普通文件忽略offset
+  //len超过MESSAGE_LENGTH_LIMIT时两端都需要开启大消息模式，本端未开启返回-1
+  int SendFile(int fd, off_t offset, int len, int msg_id);
+  //发送文件的数据源可读后恢复发送
+  void ResumeWrite();
+  //该连接的输入输出改用环形缓冲区，解析和发送时不再做Adjust的memmove
+  //缓冲区不为空时失败，两个缓冲区保持原来的模式
+  bool EnableRingBuffer(int size = RING_BUFFER_DEFAULT_SIZE);
+  bool IsRingBuffer() const { return ibuf_.IsRing(); }
+  //开启大消息模式，允许消息体超过MESSAGE_LENGTH_LIMIT
+  //注册了分片回调的消息逐片交给业务，不限长度；
+  //注册了组装回调的消息组装到IoBuffer链表中，最多占用max_len字节
+  void EnableLargeMessage(int max_len = LARGE_MESSAGE_DEFAULT_LIMIT) {
+    large_limit_ = max_len;
+  }
+  //所有连接组装中的大消息合计上限，超过时新的大消息被拒绝并关闭连接
+  static void SetLargeGlobalLimit(int64_t bytes) { large_global_limit_ = bytes; }
+  //所有连接组装中的大消息占用的字节数
+  static int64_t GetLargeInUse() { return large_in_use_; }
+
+  //开启tls，server为false时立即发起握手
+  //握手完成后内核接管的方向继续走原有的零拷贝路径，否则由openssl在用户态加解密
+  //用户态tls不支持环形缓冲区模式
+  //客户端的peer_name不为空时校验服务端证书中的名字(域名或ip)
+  bool EnableTls(TlsContext* ctx, bool server,
+                 const std::string& peer_name = "");
+  //tls会话，未开启tls为空
+  const TlsSession* GetTls() const { return tls_.get(); }
+
+  //开启压缩，并向对端发送协商消息；对端也开启之后，
+  //SendMessage发送的不小于threshold字节的消息体压缩后发送
+  void EnableCompression(int threshold = COMPRESS_DEFAULT_THRESHOLD);
+  //对端是否已经协商开启压缩
+  bool PeerCompression() const { return compress_flags_ & COMPRESS_PEER; }
 
+  //分发前按limiter做准入检查，超过限流时按limiter的RateAction拒绝或暂停读
+  void SetRateLimiter(RateLimiter* limiter);
+
+  //解析出的帧交给scheduler按优先级分发，nullptr表示解析后立即分发
+  void SetScheduler(DispatchScheduler* scheduler) { scheduler_ = scheduler; }
+  //连接的优先级类别，没有指定类别的msg_id按连接的类别排队
+  void SetPriority(int cls) { priority_ = static_cast<uint8_t>(cls); }
+  int GetPriority() const { return priority_; }
+
+  //设置消息路由，用于不属于TcpServer的连接(如客户端)
+  void SetRouter(MsgRouter* router) { router_ = router; }
+
+  int GetFd() const { return connfd_; }
+  //是否持有输入输出buffer和不常用的连接状态，空闲连接都应当为false
+  bool HasBuffer() const { return ibuf_.HasBuffer() || obuf_.HasBuffer(); }
+  bool HasExtra() const { return extra_ != nullptr; }
+  EventLoop* GetLoop() const { return loop_; }
 
  private:
+  friend class DispatchScheduler;
+
+  //发送文件片段，返回>0表示有进展，0表示暂不可写，-1表示出错
+  int WriteFile(FileSegment& seg);
+  //解析并分发ibuf中的完整消息
+  void ParseMessages();
+  //分发一个完整的普通消息
+  void Dispatch(const char* data, int len, int msg_id);
+  //分发一帧，压缩的消息体先解压到内存池的buffer中
+  void DispatchFrame(const char* data, int len, int msg_id, bool compressed);
+  //一帧分发完或者被跳过，归还准入时占用的在途名额
+  void ReleaseFrame();
+  //跳过ibuf中当前的一帧
+  void SkipFrame(int len);
+  //压缩后发送一个消息，没有压缩收益时原样发送，按最大长度预留obuf失败返回-1
+  int SendCompressed(const char* data, int msg_len, int msg_id);
+  //收到对端的压缩协商消息
+  void OnCompressNegotiate(const char* data, int len);
+  //本连接协商消息中的随机数，用于识别被对端回显的协商消息
+  uint64_t CompressNonce() const;
+  //排队的帧分发完之后从ibuf中移除，继续解析剩余的帧
+  void FinishQueued();
+  //准入检查，允许返回0，拒绝返回1(调用方跳过该帧)，暂停读返回-1(帧留在ibuf中)
+  int Admit(const MsgHead& head);
+  //暂停读wait_ns之后恢复，期间消息留在ibuf和socket缓冲区中
+  void PauseRead(uint64_t wait_ns);
+  void ResumeRead();
+  //开始接收一个大消息，返回false表示不接受该消息
+  bool BeginLarge(const MsgHead& head);
+  //处理ibuf中属于当前大消息的数据，返回true表示大消息接收完成
+  bool ConsumeLarge();
+  //组装模式下直接从socket读数据到IoBuffer链表中
+  int ReadLargeChain();
+  //用户态tls的组装读，读到没有数据或者大消息结束为止
+  int ReadLargeChainTls();
+  //将数据追加到组装链表的末尾
+  bool AppendChain(const char* data, int len);
+  //确保组装链表末尾有可写空间
+  bool ReserveChain();
+  //大消息接收完成，交给业务处理并归还链表
+  void FinishLarge();
+  //归还组装链表，清空大消息状态
+  void ReleaseLarge();
+
+  //正在接收的大消息
+  struct LargeMessage {
+    int msg_id_ = 0;
+    ///消息体总长度，0表示当前没有大消息
+    int total_ = 0;
+    ///已经接收的长度
+    int received_ = 0;
+    ///是否组装模式，否则为分片模式
+    bool chain_ = false;
+    ///被限流拒绝，消息体读出后直接丢弃
+    bool discard_ = false;
+    ///准入时占用了限流的在途名额，消息结束或丢弃时归还
+    bool held_ = false;
+    ///组装链表的头和尾
+    std::shared_ptr<IoBuffer> head_;
+    std::shared_ptr<IoBuffer> tail_;
+  };
+  //不常用的连接状态(文件发送、大消息)，用到时才创建，空闲后释放
+  struct ConnExtra {
+    ///待发送的文件片段队列
+    std::deque<FileSegment> files_;
+    ///splice使用的中转管道
+    int pipe_fds_[2] = {-1, -1};
+    ///中转管道中尚未写到socket的数据长度
+    size_t pipe_pending_ = 0;
+    ///正在接收的大消息
+    LargeMessage large_;
+    ///限流暂停读时恢复读的定时器，-1表示没有暂停
+    int pause_timer_ = -1;
+    ///发送文件时正在等待可读的数据源，-1表示没有等待
+    int wait_fd_ = -1;
+    ///连接的弱引用，没有用到时为空
+    std::shared_ptr<ConnHandle> handle_;
+  };
+
+  //推进tls握手，返回1表示完成，0表示需要等待，-1表示失败(连接已关闭)
+  int DoHandshake();
+  bool UserTlsRecv() const { return tls_ != nullptr && !tls_->KernelRecv(); }
+  bool UserTlsSend() const { return tls_ != nullptr && !tls_->KernelSend(); }
+
+  //数据源暂时没有数据时，停止关注可写，等数据源可读
+  void WaitSource(int fd);
+  //获取(没有则创建)不常用的连接状态
+  ConnExtra& Extra();
+  //文件发送和大消息都结束后释放不常用的连接状态
+  void ShrinkExtra();
+  bool InLarge() const { return extra_ != nullptr && extra_->large_.total_ > 0; }
+  bool HasFiles() const { return extra_ != nullptr && !extra_->files_.empty(); }
+
+  ///所有连接组装中的大消息合计上限
+  static std::atomic<int64_t> large_global_limit_;
+  ///所有连接组装中的大消息占用的字节数
+  static std::atomic<int64_t> large_in_use_;
+
   ///当前链接的fd
   int connfd_;
+  ///大消息组装的内存上限，0表示未开启大消息模式
+  int large_limit_ = 0;
   ///该连接归属的event_poll
   EventLoop* loop_;
-  ///输出buf
+  ///该连接归属的tcp_server
+  TcpServer* server_;
+  ///消息路由
+  MsgRouter* router_;
+  ///输出buf，只在有待发送数据时持有内存池的buffer
   OutputBuffer obuf_;
-  ///输入buf
+  ///输入buf，只在有未处理完的数据时持有内存池的buffer
   InputBuffer ibuf_;
+  ///不常用的连接状态，空闲连接为空
+  std::unique_ptr<ConnExtra> extra_;
+  ///tls会话，未开启tls为空
+  std::unique_ptr<TlsSession> tls_;
+  ///准入控制，nullptr表示不限流
+  RateLimiter* limiter_ = nullptr;
+  ///优先级分发，nullptr表示解析后立即分发
+  DispatchScheduler* scheduler_ = nullptr;
+  ///ibuf开头已经解析并排队、尚未分发的字节数，期间ibuf的数据不能移动
+  int queued_ = 0;
+  ///连接的优先级类别
+  uint8_t priority_ = PRIORITY_DEFAULT;
+  ///压缩状态，COMPRESS_LOCAL/COMPRESS_PEER
+  uint8_t compress_flags_ = 0;
+  ///压缩阈值
+  uint16_t compress_threshold_ = 0;
 };
 
@@ -3,17 +3,62 @@
 
 #include <iostream>
 #include <memory>
+#include <vector>
+#include <utility>
 
 #include "event_loop.h"
+#include "msg_router.h"
+
+class TcpConn;
+class TlsContext;
+class RateLimiter;
+class DispatchScheduler;
 
 class TcpServer {
  public:
-  TcpServer(EventLoop* loop, const char *ip, uint16_t port);
+  // reuse_port为true时多个TcpServer(每个事件循环一个)可以监听同一端口，
+  // 并优先接收与事件循环同一cpu上收到的连接
+  TcpServer(EventLoop* loop, const char *ip, uint16_t port,
+            bool reuse_port = false);
+  // 使用已经在监听的socket(热重启时从旧进程继承)
+  TcpServer(EventLoop* loop, int listen_fd);
   ~TcpServer();
 
   void DoAccept();
+  // 新建立的连接使用size大小的环形缓冲区，0表示使用普通io_buf
+  void SetRingBuffer(int size) { ring_size_ = size; }
+  // 新建立的连接开启大消息模式，max_len为组装时每个连接的内存上限
+  void SetLargeMessage(int max_len) { large_limit_ = max_len; }
+  // 新建立的连接开启tls，ctx由调用方持有；用户态tls不支持环形缓冲区，开启后忽略SetRingBuffer
+  void SetTls(TlsContext* ctx) { tls_ctx_ = ctx; }
+  // 新建立的连接在分发前做准入检查，limiter由调用方持有
+  void SetRateLimiter(RateLimiter* limiter) { limiter_ = limiter; }
+  // 新建立的连接按优先级分发消息，scheduler由调用方持有
+  void SetScheduler(DispatchScheduler* scheduler) { scheduler_ = scheduler; }
+  // 新建立的连接协商压缩，不小于threshold的消息压缩发送，0表示不开启
+  void SetCompression(int threshold) { compress_threshold_ = threshold; }
+  // 设置连接的优先级类别，连接不存在返回-1
+  int SetConnPriority(int connfd, int cls);
+  // 注册一个消息的处理回调
+  int AddMsgRouter(int msg_id, msg_callback callback, void* args = nullptr) {
+    return router_.Register(msg_id, std::move(callback), args);
+  }
+  MsgRouter& GetRouter() { return router_; }
+  // 连接关闭时从连接表中摘除，连接对象在本轮事件处理完之后释放
+  void RemoveConn(int connfd);
+  size_t GetConnNum() const { return conn_num_; }
+  // 监听socket，已经停止accept返回-1
+  int GetListenFd() const { return sockfd_; }
+  // 停止accept并关闭本进程的监听fd，已建立的连接不受影响
+  void StopAccept();
+  // 新连接是否还需要设置SO_BUSY_POLL，设置失败过一次后返回false
+  bool BusyPollUsable() const { return busy_poll_usable_; }
+  void DisableBusyPoll() { busy_poll_usable_ = false; }
 
  private:
+  // 忽略SIGHUP/SIGPIPE
+  static void IgnoreSignals();
+
   /// 套接字
   int sockfd_;
   /// 客户端链接地址
@@ -22,4 +67,24 @@ class TcpServer {
   socklen_t addrlen_{};
   /// event_loop epoll事件机制
   EventLoop* loop_;
+  /// 新连接的环形缓冲区大小，0表示不使用
+  int ring_size_ = 0;
+  /// 新连接大消息组装的内存上限，0表示不开启
+  int large_limit_ = 0;
+  /// 新连接的tls配置，nullptr表示不开启
+  TlsContext* tls_ctx_ = nullptr;
+  /// 新连接的准入控制，nullptr表示不限流
+  RateLimiter* limiter_ = nullptr;
+  /// 新连接的优先级分发，nullptr表示不开启
+  DispatchScheduler* scheduler_ = nullptr;
+  /// 新连接的压缩阈值，0表示不开启
+  int compress_threshold_ = 0;
+  /// 新连接的SO_BUSY_POLL是否可用，第一次设置失败后置为false
+  bool busy_poll_usable_ = true;
+  /// 消息路由
+  MsgRouter router_;
+  /// 当前在线的连接，下标为fd
+  std::vector<std::shared_ptr<TcpConn>> conns_;
+  /// 当前在线的连接数
+  size_t conn_num_ = 0;
 };
\ No newline at end of file
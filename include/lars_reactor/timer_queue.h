@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <unordered_map>
+
+class EventLoop;
+
+// 定时器触发的回调函数
+using timer_callback = std::function<void()>;
+
+/**
+ * 基于timerfd的定时器队列，所有定时器共用一个timerfd，
+ * 按到期时间排序，timerfd始终设置为最早的到期时间
+ */
+class TimerQueue {
+ public:
+  explicit TimerQueue(EventLoop* loop);
+  ~TimerQueue();
+
+  // 添加一个在expire_ns(CLOCK_MONOTONIC)到期的定时器，
+  // interval_ns非0时为周期定时器，返回定时器id
+  int AddTimer(uint64_t expire_ns, uint64_t interval_ns,
+               timer_callback callback);
+  // 取消定时器
+  void CancelTimer(int timer_id);
+  // timerfd可读时处理到期的定时器
+  void OnTimeout();
+
+ private:
+  // 重新设置timerfd为最早的到期时间
+  void Reset();
+
+  struct Timer {
+    uint64_t expire_ns_;
+    uint64_t interval_ns_;
+    timer_callback callback_;
+  };
+  /// 所属的event_loop
+  EventLoop* loop_;
+  /// timerfd
+  int timer_fd_;
+  /// 下一个定时器id
+  int next_id_;
+  /// 到期时间和定时器id，按到期时间排序
+  std::multimap<uint64_t, int> expires_;
+  /// 定时器id和定时器的关系
+  std::unordered_map<int, Timer> timers_;
+};
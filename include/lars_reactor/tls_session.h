@@ -0,0 +1,90 @@
+#pragma once
+
+#include <memory>
+#include <string>
+
+// 不在头文件中引入openssl
+typedef struct ssl_st SSL;
+typedef struct ssl_ctx_st SSL_CTX;
+
+//用户态tls读写暂时没有数据(需要等待socket可读/可写)
+#define TLS_AGAIN (-2)
+//一个tls记录最多携带的明文长度
+#define TLS_RECORD_SIZE (16 * 1024)
+
+/**
+ * tls配置，对应一个SSL_CTX，由多个连接共享
+ * 开启了SSL_OP_ENABLE_KTLS，握手完成后由openssl把会话密钥通过TCP_ULP "tls"交给内核
+ * 没有编译openssl(LARS_TLS=OFF)时Create返回nullptr
+ */
+class TlsContext {
+ public:
+  ~TlsContext();
+
+  // 服务端配置，证书和私钥为PEM文件
+  static std::unique_ptr<TlsContext> CreateServer(const std::string& cert_file,
+                                                  const std::string& key_file);
+  // 服务端配置，证书和私钥为内存中的PEM
+  static std::unique_ptr<TlsContext> CreateServerFromPem(
+      const std::string& cert_pem, const std::string& key_pem);
+  // 客户端配置，校验服务端证书，ca_file为空时使用系统默认的ca
+  static std::unique_ptr<TlsContext> CreateClient(const std::string& ca_file);
+  // 不校验服务端证书的客户端配置，只用于测试和压测，不能防御中间人
+  static std::unique_ptr<TlsContext> CreateInsecureClient();
+  // 只使用TLS1.2，openssl 3.0只支持TLS1.2的内核接收方向
+  void LimitTls12();
+
+  SSL_CTX* GetCtx() const { return ctx_; }
+
+ private:
+  explicit TlsContext(SSL_CTX* ctx) : ctx_(ctx) {}
+  TlsContext(const TlsContext&);
+  const TlsContext& operator=(const TlsContext&);
+
+  SSL_CTX* ctx_;
+};
+
+/**
+ * 一个连接上的tls会话，握手在事件循环中非阻塞进行
+ * 握手完成后内核接管的方向(KernelSend/KernelRecv)直接读写socket，
+ * 原有的read/write/sendfile路径不变；内核不支持时退回openssl用户态读写
+ */
+class TlsSession {
+ public:
+  TlsSession(TlsContext* ctx, int fd, bool server);
+  ~TlsSession();
+
+  // 客户端设置期望的服务端名字(域名或ip)，校验证书时一并检查，失败返回false
+  bool SetPeerName(const std::string& name);
+  // 推进握手，返回1表示完成，0表示需要等待，-1表示失败
+  int Handshake();
+  // 握手需要等待socket可写
+  bool WantWrite() const { return want_write_; }
+  bool Established() const { return established_; }
+  // 发送方向是否由内核加密
+  bool KernelSend() const { return kernel_send_; }
+  // 接收方向是否由内核解密
+  bool KernelRecv() const { return kernel_recv_; }
+
+  // 用户态读，返回读到的字节数，0表示对端关闭，TLS_AGAIN表示暂无数据，-1表示出错
+  int Read(char* buf, int len);
+  // openssl中是否还有已经解密但没有读走的数据，这些数据不会再触发EPOLLIN
+  bool Pending() const;
+  // 用户态写，返回写出的字节数，0表示暂不可写，-1表示出错
+  int Write(const char* buf, int len);
+
+ private:
+  TlsSession(const TlsSession&);
+  const TlsSession& operator=(const TlsSession&);
+
+  /// openssl会话
+  SSL* ssl_ = nullptr;
+  /// 握手需要等待socket可写
+  bool want_write_ = false;
+  /// 握手是否完成
+  bool established_ = false;
+  /// 内核是否接管发送方向
+  bool kernel_send_ = false;
+  /// 内核是否接管接收方向
+  bool kernel_recv_ = false;
+};
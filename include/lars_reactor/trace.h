@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+#include <ctime>
+#include <mutex>
+#include <string>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+//每个线程的span环形缓冲区长度，必须是2的幂，写满后覆盖最旧的记录
+#define TRACE_BUFFER_SIZE (64 * 1024)
+//请求导出trace的msg_id，回复为导出的文件路径，失败回复空消息
+#define TRACE_DUMP_ID 0x7ffffffe
+
+class EventLoop;
+class MsgRouter;
+
+// span使用的时钟，x86上为tsc，导出时换算成微秒
+inline uint64_t TraceClock() {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  struct timespec ts {};
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000000UL + ts.tv_nsec;
+#endif
+}
+
+/**
+ * 事件追踪，记录带时间戳的span，导出为Chrome/Perfetto的trace json
+ * 每个线程一个环形缓冲区，只有本线程写入，记录时不加锁
+ * 只有定义了LARS_WITH_TRACE(cmake -DLARS_TRACE=ON)时LARS_TRACE_SPAN才会记录，
+ * 否则宏展开为空，不产生任何开销
+ */
+class Tracer {
+ public:
+  // 在当前线程的缓冲区中记录一个span，name必须是静态字符串
+  static void Record(const char* name, int arg, uint64_t begin, uint64_t end);
+  // 把所有线程缓冲区中的span写到path，返回写出的span数，失败返回-1
+  static int Dump(const std::string& path);
+  // 设置信号和管理请求导出的文件路径，默认/tmp/lars_trace.json
+  static void SetDumpPath(const std::string& path);
+  static std::string GetDumpPath();
+  // 收到signo时在loop中导出，通过signalfd处理，需要在创建其它线程之前调用
+  static bool DumpOnSignal(EventLoop* loop, int signo);
+  // 收到msg_id消息时导出，回复导出的文件路径
+  // 每次请求都会写文件，只注册在只监听本机的管理端口上
+  static int AddDumpRouter(MsgRouter* router, int msg_id = TRACE_DUMP_ID);
+};
+
+// 作用域内的span，析构时记录
+class TraceSpan {
+ public:
+  explicit TraceSpan(const char* name, int arg = 0)
+      : name_(name), arg_(arg), begin_(TraceClock()) {}
+  ~TraceSpan() { Tracer::Record(name_, arg_, begin_, TraceClock()); }
+
+ private:
+  TraceSpan(const TraceSpan&);
+  const TraceSpan& operator=(const TraceSpan&);
+
+  const char* name_;
+  int arg_;
+  uint64_t begin_;
+};
+
+#define LARS_TRACE_CONCAT_INNER(a, b) a##b
+#define LARS_TRACE_CONCAT(a, b) LARS_TRACE_CONCAT_INNER(a, b)
+
+#ifdef LARS_WITH_TRACE
+// 记录从当前位置到作用域结束的span
+#define LARS_TRACE_SPAN(name) \
+  TraceSpan LARS_TRACE_CONCAT(trace_span_, __LINE__)(name)
+// 同上，并附带一个整数参数(fd、msg_id等)
+#define LARS_TRACE_SPAN_ARG(name, arg) \
+  TraceSpan LARS_TRACE_CONCAT(trace_span_, __LINE__)(name, arg)
+#else
+#define LARS_TRACE_SPAN(name) ((void)0)
+#define LARS_TRACE_SPAN_ARG(name, arg) ((void)0)
+#endif
+
+// 加锁，开启追踪时把等待锁的时间记录为span
+template <typename Mutex>
+inline std::unique_lock<Mutex> TracedLock(Mutex& mutex, const char* name) {
+  LARS_TRACE_SPAN(name);
+  (void)name;
+  return std::unique_lock<Mutex>(mutex);
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+/**
+ * 有界无锁多生产者多消费者队列
+ * 每个槽位带一个序号，生产者和消费者各自CAS推进位置，
+ * 通过槽位序号判断槽位是否可写/可读，容量向上取整为2的幂
+ */
+template <typename T>
+class BoundedQueue {
+ public:
+  explicit BoundedQueue(size_t capacity) {
+    size_t size = 2;
+    while (size < capacity) {
+      size <<= 1;
+    }
+    slots_.reset(new Slot[size]);
+    mask_ = size - 1;
+    for (size_t i = 0; i < size; ++i) {
+      slots_[i].seq_.store(i, std::memory_order_relaxed);
+    }
+    enqueue_pos_.store(0, std::memory_order_relaxed);
+    dequeue_pos_.store(0, std::memory_order_relaxed);
+  }
+
+  // 入队，队列满返回false
+  bool Push(const T& value) {
+    size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+    Slot* slot;
+    while (true) {
+      slot = &slots_[pos & mask_];
+      size_t seq = slot->seq_.load(std::memory_order_acquire);
+      intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+      if (diff == 0) {
+        if (enqueue_pos_.compare_exchange_weak(pos, pos + 1,
+                                               std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = enqueue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    slot->value_ = value;
+    slot->seq_.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  // 出队，队列空返回false
+  bool Pop(T* value) {
+    size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+    Slot* slot;
+    while (true) {
+      slot = &slots_[pos & mask_];
+      size_t seq = slot->seq_.load(std::memory_order_acquire);
+      intptr_t diff =
+          static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+      if (diff == 0) {
+        if (dequeue_pos_.compare_exchange_weak(pos, pos + 1,
+                                               std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = dequeue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    *value = slot->value_;
+    slot->seq_.store(pos + mask_ + 1, std::memory_order_release);
+    return true;
+  }
+
+  size_t Capacity() const { return mask_ + 1; }
+
+ private:
+  BoundedQueue(const BoundedQueue&);
+  const BoundedQueue& operator=(const BoundedQueue&);
+
+  struct Slot {
+    std::atomic<size_t> seq_;
+    T value_;
+  };
+  /// 槽位数组
+  std::unique_ptr<Slot[]> slots_;
+  /// 容量-1
+  size_t mask_;
+  /// 生产者和消费者位置，分开放在不同缓存行
+  alignas(64) std::atomic<size_t> enqueue_pos_;
+  alignas(64) std::atomic<size_t> dequeue_pos_;
+};
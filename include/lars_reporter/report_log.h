@@ -0,0 +1,65 @@
+#pragma once
+
+#include <sys/types.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// 上报日志中每个批次的魔数
+#define REPORT_BATCH_MAGIC 0x5450524cU
+
+// 一条调用结果记录，定长紧凑存储
+struct ReportRecord {
+  /// 上报时间，单位秒
+  int64_t ts_;
+  int modid_;
+  int cmdid_;
+  int caller_;
+  uint32_t ip_;
+  int port_;
+  uint32_t succ_;
+  uint32_t err_;
+  int overload_;
+};
+
+// 一个批次的头部，后面紧跟count_条ReportRecord
+struct ReportBatchHeader {
+  uint32_t magic_;
+  uint32_t count_;
+  /// 批次内记录的FNV-1a校验和
+  uint64_t checksum_;
+};
+
+/**
+ * 只追加的上报日志
+ * 文件由若干批次组成，每个批次一次write写入，按配置在批次后fdatasync
+ */
+class ReportLog {
+ public:
+  ReportLog() = default;
+  ~ReportLog();
+
+  // 打开(或创建)日志文件，失败返回-1
+  int Open(const std::string& path);
+  // 追加一个批次，sync为true时写入后fdatasync，失败返回-1
+  // 只写入了一部分的批次会被截断，不影响之后追加的批次
+  int Append(const ReportRecord* records, uint32_t count, bool sync);
+  void Close();
+  // 写入失败被丢弃的批次数
+  uint64_t GetDropped() const { return dropped_; }
+
+  // 读取日志中全部完整且校验通过的批次，返回读取的记录数，失败返回-1
+  static int Read(const std::string& path, std::vector<ReportRecord>* records);
+
+ private:
+  ReportLog(const ReportLog&);
+  const ReportLog& operator=(const ReportLog&);
+
+  /// 日志文件fd
+  int fd_ = -1;
+  /// 最后一个完整批次的结束位置
+  off_t offset_ = 0;
+  /// 写入失败被丢弃的批次数
+  uint64_t dropped_ = 0;
+};
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+
+// 上报主机调用结果的消息id
+#define ID_REPORT_STATUS_REQUEST 6
+
+// 一个主机在上报周期内的调用结果
+struct HostCallResult {
+  /// ip地址，网络字节序
+  uint32_t ip_;
+  int port_;
+  uint32_t succ_;
+  uint32_t err_;
+  /// 是否过载
+  int overload_;
+};
+
+// 上报请求，后面紧跟result_num_个HostCallResult
+struct ReportStatusRequest {
+  int modid_;
+  int cmdid_;
+  /// 调用方标识
+  int caller_;
+  int result_num_;
+};
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "lars_reactor/tcp_conn.h"
+#include "lars_reactor/tcp_server.h"
+#include "reporter.h"
+
+/**
+ * 上报服务，每个事件循环线程一个实例
+ * 在event_loop中解析上报请求，记录交给Reporter异步写入
+ */
+class ReportService {
+ public:
+  // 必须在loop所在线程中构造
+  ReportService(Reporter* reporter, EventLoop* loop, const char* ip,
+                uint16_t port);
+
+  // 处理一个上报请求
+  void ReportStatus(const char* data, int len);
+
+ private:
+  /// 异步写入
+  Reporter* reporter_;
+  /// 监听服务
+  TcpServer server_;
+};
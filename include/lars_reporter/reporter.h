@@ -0,0 +1,74 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bounded_queue.h"
+#include "report_log.h"
+
+// 上报写入的配置
+struct ReporterConfig {
+  /// 日志目录，每个写线程写自己的report.<n>.log
+  std::string log_dir_ = ".";
+  /// 写线程个数
+  int writer_num_ = 2;
+  /// 队列容量
+  size_t queue_size_ = 1 << 16;
+  /// 一个批次最多的记录数
+  int batch_size_ = 4096;
+  /// 记录从入队到落盘的最长等待时间，单位ms
+  int max_latency_ms_ = 10;
+  /// 每个批次写入后是否fdatasync
+  bool sync_ = true;
+};
+
+// 上报写入的统计
+struct ReporterStats {
+  std::atomic<uint64_t> submitted_{0};
+  /// 队列满被丢弃的记录数
+  std::atomic<uint64_t> dropped_{0};
+  std::atomic<uint64_t> written_{0};
+  std::atomic<uint64_t> batches_{0};
+  /// 写入失败被丢弃的批次数和记录数
+  std::atomic<uint64_t> failed_batches_{0};
+  std::atomic<uint64_t> failed_{0};
+};
+
+/**
+ * 上报记录的异步批量写入
+ * event_loop线程把记录放进有界无锁队列后立即返回，
+ * 写线程把记录攒成批次，按批次大小或等待时间触发一次写入和fdatasync
+ */
+class Reporter {
+ public:
+  explicit Reporter(const ReporterConfig& config);
+  ~Reporter();
+
+  // 启动写线程，打开日志失败返回-1
+  int Start();
+  // 停止写线程，停止前写完队列中剩余的记录
+  void Stop();
+  // 提交一条记录，队列满返回false
+  bool Submit(const ReportRecord& record);
+
+  const ReporterStats& GetStats() const { return stats_; }
+
+ private:
+  // 写线程主循环
+  void Run(int index);
+  // 写入一个批次
+  void Flush(ReportLog* log, std::vector<ReportRecord>* batch);
+
+  /// 配置
+  ReporterConfig config_;
+  /// 待写入的记录
+  BoundedQueue<ReportRecord> queue_;
+  /// 每个写线程一个日志
+  std::vector<std::unique_ptr<ReportLog>> logs_;
+  std::vector<std::thread> writers_;
+  std::atomic<bool> running_;
+  /// 统计
+  ReporterStats stats_;
+};
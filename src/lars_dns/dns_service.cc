@@ -0,0 +1,48 @@
+#include "lars_dns/dns_service.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#include "lars_reactor/message.h"
+
+// 查询路由请求的回调
+auto get_route_callback = [](const char* data, int len, int msg_id,
+                             void* args, NetConnection* conn) {
+  auto service = static_cast<DnsService*>(args);
+  service->GetRoute(data, len, conn);
+};
+
+DnsService::DnsService(RouteTable* table, EventLoop* loop, const char* ip,
+                       uint16_t port)
+    : table_(table), server_(loop, ip, port, true) {
+  reader_ = table_->RegisterReader();
+  if (reader_ == -1) {
+    std::cerr << "too many route table readers!\n";
+    exit(1);
+  }
+  server_.AddMsgRouter(ID_GET_ROUTE_REQUEST, get_route_callback, this);
+}
+
+void DnsService::GetRoute(const char* data, int len, NetConnection* conn) {
+  if (len != sizeof(GetRouteRequest)) {
+    std::cerr << "get route request format error, len: " << len << std::endl;
+    return;
+  }
+  GetRouteRequest req{};
+  memcpy(&req, data, sizeof(req));
+  hosts_.clear();
+  table_->Query(reader_, req.modid_, req.cmdid_, &hosts_);
+  // 回复不能超过一个消息的长度上限
+  int max_hosts = static_cast<int>(
+      (MESSAGE_LENGTH_LIMIT - sizeof(GetRouteResponse)) / sizeof(HostInfo));
+  GetRouteResponse rsp{req.modid_, req.cmdid_,
+                       std::min(static_cast<int>(hosts_.size()), max_hosts)};
+  size_t reply_len = sizeof(rsp) + rsp.host_num_ * sizeof(HostInfo);
+  reply_.resize(reply_len);
+  memcpy(reply_.data(), &rsp, sizeof(rsp));
+  memcpy(reply_.data() + sizeof(rsp), hosts_.data(),
+         rsp.host_num_ * sizeof(HostInfo));
+  conn->SendMessage(reply_.data(), static_cast<int>(reply_len),
+                    ID_GET_ROUTE_RESPONSE);
+}
@@ -0,0 +1,55 @@
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "lars_dns/dns_service.h"
+#include "lars_dns/route_loader.h"
+
+// lars_dns route_file [ip] [port] [threads]
+// lars_dns -d route_file snapshot_file [version]
+//   将文本路由文件转换为二进制快照，版本号默认为当前时间(秒)，保证新快照的版本更大
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    std::cerr << "usage: " << argv[0] << " route_file [ip] [port] [threads]\n"
+              << "       " << argv[0]
+              << " -d route_file snapshot_file [version]\n";
+    return 1;
+  }
+  if (strcmp(argv[1], "-d") == 0) {
+    if (argc < 4) {
+      std::cerr << "usage: " << argv[0]
+                << " -d route_file snapshot_file [version]\n";
+      return 1;
+    }
+    uint64_t version = argc > 4 ? strtoull(argv[4], nullptr, 10)
+                                : static_cast<uint64_t>(time(nullptr));
+    return RouteLoader::Dump(argv[2], argv[3], version) == 0 ? 0 : 1;
+  }
+  const char* ip = argc > 2 ? argv[2] : "127.0.0.1";
+  uint16_t port = argc > 3 ? static_cast<uint16_t>(atoi(argv[3])) : 7778;
+  int threads = argc > 4 ? atoi(argv[4]) : 4;
+
+  RouteTable table;
+  RouteLoader loader(&table, argv[1]);
+  if (loader.Load() == -1) {
+    return 1;
+  }
+  loader.Start();
+
+  // 每个线程一个事件循环，读者之间互不影响
+  std::vector<std::thread> loops;
+  for (int i = 0; i < threads; ++i) {
+    loops.emplace_back([&table, ip, port]() {
+      EventLoop loop;
+      DnsService service(&table, &loop, ip, port);
+      loop.EventProcess();
+    });
+  }
+  for (auto& t : loops) {
+    t.join();
+  }
+  return 0;
+}
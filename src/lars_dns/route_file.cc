@@ -0,0 +1,194 @@
+#include "lars_dns/route_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include "lars_dns/route_table.h"
+#include "lars_reactor/checksum.h"
+
+// 写入len字节，被信号打断或者部分写入时继续写
+static bool WriteAll(int fd, const char* data, size_t len) {
+  while (len > 0) {
+    ssize_t n = write(fd, data, len);
+    if (n == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    data += n;
+    len -= static_cast<size_t>(n);
+  }
+  return true;
+}
+
+RouteFile::~RouteFile() {
+  if (addr_ != nullptr) {
+    munmap(addr_, length_);
+  }
+}
+
+bool RouteFile::IsRouteFile(const std::string& path) {
+  std::ifstream in(path, std::ios::binary);
+  char magic[sizeof(ROUTE_FILE_MAGIC)] = {0};
+  in.read(magic, sizeof(magic));
+  return in && memcmp(magic, ROUTE_FILE_MAGIC, sizeof(magic)) == 0;
+}
+
+std::unique_ptr<RouteFile> RouteFile::Open(const std::string& path,
+                                           bool verify) {
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd == -1) {
+    std::cerr << "open route file " << path << " error!\n";
+    return nullptr;
+  }
+  struct stat st {};
+  if (fstat(fd, &st) == -1 ||
+      static_cast<size_t>(st.st_size) < sizeof(RouteFileHeader)) {
+    std::cerr << "route file " << path << " too small!\n";
+    close(fd);
+    return nullptr;
+  }
+  void* addr = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  // 映射建立后fd就不再需要了
+  close(fd);
+  if (addr == MAP_FAILED) {
+    std::cerr << "mmap route file " << path << " error!\n";
+    return nullptr;
+  }
+  std::unique_ptr<RouteFile> file(new RouteFile);
+  file->addr_ = addr;
+  file->length_ = st.st_size;
+  file->header_ = static_cast<const RouteFileHeader*>(addr);
+  const RouteFileHeader* header = file->header_;
+  if (memcmp(header->magic_, ROUTE_FILE_MAGIC, sizeof(header->magic_)) != 0 ||
+      header->format_ != ROUTE_FILE_FORMAT) {
+    std::cerr << "route file " << path << " bad magic or format!\n";
+    return nullptr;
+  }
+  // 先用除法比较，文件头中的个数再大也不会溢出
+  size_t body_len = file->length_ - sizeof(RouteFileHeader);
+  size_t host_len = 0;
+  if (header->entry_num_ <= body_len / sizeof(RouteFileEntry)) {
+    host_len = body_len - header->entry_num_ * sizeof(RouteFileEntry);
+  }
+  if (header->entry_num_ > body_len / sizeof(RouteFileEntry) ||
+      host_len % sizeof(HostInfo) != 0 ||
+      header->host_num_ != host_len / sizeof(HostInfo)) {
+    std::cerr << "route file " << path << " length mismatch!\n";
+    return nullptr;
+  }
+  const char* body = static_cast<const char*>(addr) + sizeof(RouteFileHeader);
+  if (verify && Checksum(body, body_len) != header->checksum_) {
+    std::cerr << "route file " << path << " checksum error!\n";
+    return nullptr;
+  }
+  file->entries_ = reinterpret_cast<const RouteFileEntry*>(body);
+  file->hosts_ = reinterpret_cast<const HostInfo*>(
+      body + header->entry_num_ * sizeof(RouteFileEntry));
+  // 不校验校验和时也要保证查询不会越界：key严格升序，主机下标在主机数组内
+  for (uint64_t i = 0; i < header->entry_num_; ++i) {
+    const RouteFileEntry& entry = file->entries_[i];
+    if ((i > 0 && entry.key_ <= file->entries_[i - 1].key_) ||
+        static_cast<uint64_t>(entry.host_index_) + entry.host_num_ >
+            header->host_num_) {
+      std::cerr << "route file " << path << " bad entry " << i << "!\n";
+      return nullptr;
+    }
+  }
+  // 查询是随机访问，不需要预读
+  madvise(addr, file->length_, MADV_RANDOM);
+  return file;
+}
+
+bool RouteFile::Find(uint64_t key, std::vector<HostInfo>* hosts) const {
+  const RouteFileEntry* end = entries_ + header_->entry_num_;
+  const RouteFileEntry* itr = std::lower_bound(
+      entries_, end, key,
+      [](const RouteFileEntry& entry, uint64_t k) { return entry.key_ < k; });
+  if (itr == end || itr->key_ != key) {
+    return false;
+  }
+  hosts->assign(hosts_ + itr->host_index_,
+                hosts_ + itr->host_index_ + itr->host_num_);
+  return true;
+}
+
+void RouteFile::ForEach(const std::function<void(uint64_t, const HostInfo*,
+                                                 uint32_t)>& visitor) const {
+  for (uint64_t i = 0; i < header_->entry_num_; ++i) {
+    visitor(entries_[i].key_, hosts_ + entries_[i].host_index_,
+            entries_[i].host_num_);
+  }
+}
+
+int RouteFile::Write(const std::string& path, const RouteSnapshot& snapshot) {
+  // 条目按key排序，主机按条目顺序连续存放
+  struct Route {
+    uint64_t key_;
+    const HostInfo* hosts_;
+    uint32_t num_;
+  };
+  std::vector<Route> routes;
+  routes.reserve(snapshot.Size());
+  snapshot.ForEach([&routes](uint64_t key, const HostInfo* hosts,
+                             uint32_t num) {
+    routes.push_back({key, hosts, num});
+  });
+  std::sort(routes.begin(), routes.end(), [](const Route& a, const Route& b) {
+    return a.key_ < b.key_;
+  });
+  std::vector<RouteFileEntry> entries;
+  std::vector<HostInfo> hosts;
+  entries.reserve(routes.size());
+  for (const auto& route : routes) {
+    entries.push_back(
+        {route.key_, static_cast<uint32_t>(hosts.size()), route.num_});
+    hosts.insert(hosts.end(), route.hosts_, route.hosts_ + route.num_);
+  }
+
+  RouteFileHeader header{};
+  memcpy(header.magic_, ROUTE_FILE_MAGIC, sizeof(header.magic_));
+  header.format_ = ROUTE_FILE_FORMAT;
+  header.version_ = snapshot.version_;
+  header.entry_num_ = entries.size();
+  header.host_num_ = hosts.size();
+  const char* entry_data = reinterpret_cast<const char*>(entries.data());
+  const char* host_data = reinterpret_cast<const char*>(hosts.data());
+  size_t entry_len = entries.size() * sizeof(RouteFileEntry);
+  size_t host_len = hosts.size() * sizeof(HostInfo);
+  header.checksum_ =
+      Checksum(host_data, host_len, Checksum(entry_data, entry_len));
+
+  std::string tmp = path + ".tmp";
+  int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd == -1) {
+    std::cerr << "open route file " << tmp << " error!\n";
+    return -1;
+  }
+  // rename之前先落盘，掉电后不会留下指向未写完数据的新文件名
+  bool ok = WriteAll(fd, reinterpret_cast<const char*>(&header),
+                     sizeof(header)) &&
+            WriteAll(fd, entry_data, entry_len) &&
+            WriteAll(fd, host_data, host_len) && fsync(fd) == 0;
+  if (close(fd) == -1 || !ok) {
+    std::cerr << "write route file " << tmp << " error!\n";
+    unlink(tmp.c_str());
+    return -1;
+  }
+  // rename是原子的，正在映射旧文件的进程不受影响
+  if (rename(tmp.c_str(), path.c_str()) == -1) {
+    std::cerr << "rename route file " << tmp << " error!\n";
+    return -1;
+  }
+  return 0;
+}
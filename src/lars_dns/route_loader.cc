@@ -0,0 +1,125 @@
+#include "lars_dns/route_loader.h"
+
+#include <arpa/inet.h>
+#include <sys/stat.h>
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <utility>
+
+RouteLoader::RouteLoader(RouteTable* table, std::string path, int interval_ms)
+    : table_(table),
+      path_(std::move(path)),
+      interval_ms_(interval_ms),
+      version_(0),
+      running_(false) {}
+
+RouteLoader::~RouteLoader() { Stop(); }
+
+std::unique_ptr<RouteSnapshot> RouteLoader::Parse(const std::string& path) {
+  std::ifstream in(path);
+  if (!in) {
+    std::cerr << "open route file " << path << " error!\n";
+    return nullptr;
+  }
+  std::unique_ptr<RouteSnapshot> snapshot(new RouteSnapshot);
+  std::string line;
+  int line_no = 0;
+  while (std::getline(in, line)) {
+    ++line_no;
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+    std::istringstream fields(line);
+    int modid, cmdid, port;
+    std::string ip;
+    struct in_addr addr {};
+    if (!(fields >> modid >> cmdid >> ip >> port) ||
+        inet_aton(ip.c_str(), &addr) == 0) {
+      std::cerr << "route file " << path << " line " << line_no
+                << " format error!\n";
+      continue;
+    }
+    snapshot->routes_[RouteKey(modid, cmdid)].push_back({addr.s_addr, port});
+  }
+  return snapshot;
+}
+
+int RouteLoader::Dump(const std::string& path,
+                      const std::string& snapshot_path, uint64_t version) {
+  std::unique_ptr<RouteSnapshot> snapshot = Parse(path);
+  if (snapshot == nullptr) {
+    return -1;
+  }
+  snapshot->version_ = version;
+  return RouteFile::Write(snapshot_path, *snapshot);
+}
+
+int RouteLoader::Load() {
+  struct stat st {};
+  if (stat(path_.c_str(), &st) == -1) {
+    std::cerr << "stat route file " << path_ << " error!\n";
+    return -1;
+  }
+  std::unique_ptr<RouteSnapshot> snapshot;
+  if (RouteFile::IsRouteFile(path_)) {
+    // 二进制快照直接映射，不需要解析和重建
+    snapshot.reset(new RouteSnapshot);
+    snapshot->file_ = RouteFile::Open(path_);
+    if (snapshot->file_ == nullptr) {
+      return -1;
+    }
+  } else {
+    snapshot = Parse(path_);
+    if (snapshot == nullptr) {
+      return -1;
+    }
+  }
+  mtime_ = st.st_mtim;
+  if (snapshot->file_ != nullptr) {
+    // 二进制快照使用生成时写入的版本号
+    version_ = snapshot->file_->GetVersion();
+    snapshot->version_ = version_;
+  } else {
+    snapshot->version_ = ++version_;
+  }
+  table_->Update(std::move(snapshot));
+  return 0;
+}
+
+bool RouteLoader::Changed() {
+  struct stat st {};
+  if (stat(path_.c_str(), &st) == -1) {
+    return false;
+  }
+  return st.st_mtim.tv_sec != mtime_.tv_sec ||
+         st.st_mtim.tv_nsec != mtime_.tv_nsec;
+}
+
+void RouteLoader::Start() {
+  if (running_.exchange(true)) {
+    return;
+  }
+  thread_ = std::thread(&RouteLoader::Run, this);
+}
+
+void RouteLoader::Stop() {
+  if (!running_.exchange(false)) {
+    return;
+  }
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+void RouteLoader::Run() {
+  while (running_) {
+    if (Changed()) {
+      // 在后台线程中重建整份快照，读者不受影响
+      Load();
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(interval_ms_));
+  }
+}
@@ -0,0 +1,87 @@
+#include "lars_dns/route_table.h"
+
+#include <algorithm>
+#include <thread>
+
+bool RouteSnapshot::Find(uint64_t key, std::vector<HostInfo>* hosts) const {
+  if (file_ != nullptr) {
+    return file_->Find(key, hosts);
+  }
+  auto itr = routes_.find(key);
+  if (itr == routes_.end()) {
+    return false;
+  }
+  hosts->assign(itr->second.begin(), itr->second.end());
+  return true;
+}
+
+size_t RouteSnapshot::Size() const {
+  return file_ != nullptr ? file_->GetEntryNum() : routes_.size();
+}
+
+void RouteSnapshot::ForEach(const route_visitor& visitor) const {
+  if (file_ != nullptr) {
+    file_->ForEach(visitor);
+    return;
+  }
+  for (const auto& route : routes_) {
+    visitor(route.first, route.second.data(),
+            static_cast<uint32_t>(route.second.size()));
+  }
+}
+
+RouteTable::RouteTable()
+    : reader_num_(0), epoch_(1), current_(new RouteSnapshot) {}
+
+RouteTable::~RouteTable() { delete current_.load(); }
+
+int RouteTable::RegisterReader() {
+  int reader = reader_num_.fetch_add(1);
+  if (reader >= MAX_ROUTE_READERS) {
+    return -1;
+  }
+  return reader;
+}
+
+const RouteSnapshot* RouteTable::ReadLock(int reader) const {
+  // 先公布自己所在的epoch，再读取快照指针
+  readers_[reader].epoch_.store(epoch_.load());
+  return current_.load();
+}
+
+void RouteTable::ReadUnlock(int reader) const {
+  readers_[reader].epoch_.store(0, std::memory_order_release);
+}
+
+bool RouteTable::Query(int reader, int modid, int cmdid,
+                       std::vector<HostInfo>* hosts) const {
+  const RouteSnapshot* snapshot = ReadLock(reader);
+  bool found = snapshot->Find(RouteKey(modid, cmdid), hosts);
+  ReadUnlock(reader);
+  return found;
+}
+
+uint64_t RouteTable::GetVersion(int reader) const {
+  const RouteSnapshot* snapshot = ReadLock(reader);
+  uint64_t version = snapshot->version_;
+  ReadUnlock(reader);
+  return version;
+}
+
+void RouteTable::Update(std::unique_ptr<RouteSnapshot> snapshot) {
+  std::lock_guard<std::mutex> lock(update_mutex_);
+  const RouteSnapshot* old = current_.exchange(snapshot.release());
+  uint64_t epoch = epoch_.fetch_add(1) + 1;
+  // 等待宽限期：还停留在旧epoch的读者可能持有旧快照
+  int num = std::min(reader_num_.load(), MAX_ROUTE_READERS);
+  for (int i = 0; i < num; ++i) {
+    while (true) {
+      uint64_t reader_epoch = readers_[i].epoch_.load(std::memory_order_acquire);
+      if (reader_epoch == 0 || reader_epoch >= epoch) {
+        break;
+      }
+      std::this_thread::yield();
+    }
+  }
+  delete old;
+}
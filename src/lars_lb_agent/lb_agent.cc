@@ -0,0 +1,123 @@
+#include "lars_lb_agent/lb_agent.h"
+
+#include <cstring>
+#include <iostream>
+
+#include "lars_dns/route_table.h"
+
+// 路由服务回复的回调
+auto route_response_callback = [](const char* data, int len, int msg_id,
+                                  void* args, NetConnection* conn) {
+  auto agent = static_cast<LbAgent*>(args);
+  agent->OnRouteResponse(data, len);
+};
+// 本地进程获取主机的回调
+auto get_host_callback = [](const char* data, int len, int msg_id, void* args,
+                            NetConnection* conn) {
+  auto agent = static_cast<LbAgent*>(args);
+  agent->OnGetHost(data, len, conn);
+};
+// 本地进程上报调用结果的回调
+auto report_callback = [](const char* data, int len, int msg_id, void* args,
+                          NetConnection* conn) {
+  auto agent = static_cast<LbAgent*>(args);
+  agent->OnReport(data, len);
+};
+
+LbAgent::LbAgent(EventLoop* loop, const char* dns_ip, uint16_t dns_port,
+                 const LbConfig& config, int refresh_ms)
+    : loop_(loop), config_(config), dns_client_(loop, dns_ip, dns_port) {
+  dns_client_.AddMsgRouter(ID_GET_ROUTE_RESPONSE, route_response_callback,
+                           this);
+  refresh_timer_ = loop_->RunEvery(refresh_ms, [this]() { Refresh(); });
+}
+
+LbAgent::~LbAgent() { loop_->CancelTimer(refresh_timer_); }
+
+int LbAgent::GetHost(int modid, int cmdid, HostInfo* host) {
+  uint64_t key = RouteKey(modid, cmdid);
+  auto itr = routes_.find(key);
+  if (itr == routes_.end()) {
+    // 第一次使用的路由，先占位再拉取
+    routes_[key].reset(new LoadBalance(&config_));
+    Fetch(modid, cmdid);
+    return RET_NOEXIST;
+  }
+  return itr->second->GetHost(loop_->GetNowNs(), host);
+}
+
+void LbAgent::Report(int modid, int cmdid, const HostInfo& host,
+                     int retcode) {
+  auto itr = routes_.find(RouteKey(modid, cmdid));
+  if (itr == routes_.end()) {
+    return;
+  }
+  itr->second->Report(host, retcode == 0, loop_->GetNowNs());
+}
+
+void LbAgent::Serve(const char* ip, uint16_t port) {
+  server_.reset(new TcpServer(loop_, ip, port, true));
+  server_->AddMsgRouter(ID_GET_HOST_REQUEST, get_host_callback, this);
+  server_->AddMsgRouter(ID_REPORT_REQUEST, report_callback, this);
+}
+
+void LbAgent::Fetch(int modid, int cmdid) {
+  if (dns_client_.Connect() == -1) {
+    // 下一次刷新时重试
+    return;
+  }
+  GetRouteRequest req{modid, cmdid};
+  dns_client_.SendMessage(reinterpret_cast<const char*>(&req), sizeof(req),
+                          ID_GET_ROUTE_REQUEST);
+}
+
+void LbAgent::Refresh() {
+  for (const auto& route : routes_) {
+    Fetch(static_cast<int>(route.first >> 32),
+          static_cast<int>(route.first & 0xffffffff));
+  }
+}
+
+void LbAgent::OnRouteResponse(const char* data, int len) {
+  GetRouteResponse rsp{};
+  if (len < static_cast<int>(sizeof(rsp))) {
+    std::cerr << "get route response format error, len: " << len << std::endl;
+    return;
+  }
+  memcpy(&rsp, data, sizeof(rsp));
+  if (rsp.host_num_ < 0 ||
+      len != static_cast<int>(sizeof(rsp) + rsp.host_num_ * sizeof(HostInfo))) {
+    std::cerr << "get route response format error, len: " << len << std::endl;
+    return;
+  }
+  auto itr = routes_.find(RouteKey(rsp.modid_, rsp.cmdid_));
+  if (itr == routes_.end()) {
+    return;
+  }
+  hosts_.resize(rsp.host_num_);
+  memcpy(hosts_.data(), data + sizeof(rsp), rsp.host_num_ * sizeof(HostInfo));
+  itr->second->Update(hosts_, loop_->GetNowNs());
+}
+
+void LbAgent::OnGetHost(const char* data, int len, NetConnection* conn) {
+  GetHostRequest req{};
+  if (len != sizeof(req)) {
+    std::cerr << "get host request format error, len: " << len << std::endl;
+    return;
+  }
+  memcpy(&req, data, sizeof(req));
+  GetHostResponse rsp{req.modid_, req.cmdid_, RET_NOEXIST, {0, 0}};
+  rsp.retcode_ = GetHost(req.modid_, req.cmdid_, &rsp.host_);
+  conn->SendMessage(reinterpret_cast<const char*>(&rsp), sizeof(rsp),
+                    ID_GET_HOST_RESPONSE);
+}
+
+void LbAgent::OnReport(const char* data, int len) {
+  ReportRequest req{};
+  if (len != sizeof(req)) {
+    std::cerr << "report request format error, len: " << len << std::endl;
+    return;
+  }
+  memcpy(&req, data, sizeof(req));
+  Report(req.modid_, req.cmdid_, req.host_, req.retcode_);
+}
@@ -0,0 +1,150 @@
+#include "lars_lb_agent/load_balance.h"
+
+#include <unordered_set>
+
+void HostList::PushBack(HostStat* stat) {
+  stat->prev_ = tail_;
+  stat->next_ = nullptr;
+  if (tail_ != nullptr) {
+    tail_->next_ = stat;
+  } else {
+    head_ = stat;
+  }
+  tail_ = stat;
+  ++size_;
+}
+
+void HostList::Remove(HostStat* stat) {
+  if (stat->prev_ != nullptr) {
+    stat->prev_->next_ = stat->next_;
+  } else {
+    head_ = stat->next_;
+  }
+  if (stat->next_ != nullptr) {
+    stat->next_->prev_ = stat->prev_;
+  } else {
+    tail_ = stat->prev_;
+  }
+  stat->prev_ = stat->next_ = nullptr;
+  --size_;
+}
+
+int LoadBalance::GetHost(uint64_t now_ns, HostInfo* host) {
+  ++get_count_;
+  HostStat* stat = nullptr;
+  int ret = RET_SUCC;
+  bool probe = config_->probe_num_ > 0 &&
+               get_count_ % static_cast<uint64_t>(config_->probe_num_) == 0;
+  if (!overload_.Empty() && (idle_.Empty() || probe)) {
+    // 定期从过载主机中取一个探测，过载超时的直接恢复
+    stat = overload_.Front();
+    uint64_t timeout_ns =
+        static_cast<uint64_t>(config_->overload_timeout_ms_) * 1000000;
+    if (now_ns - stat->overload_ns_ >= timeout_ns) {
+      SetIdle(stat, now_ns);
+    } else {
+      overload_.Remove(stat);
+      overload_.PushBack(stat);
+      ret = idle_.Empty() ? RET_OVERLOAD : RET_SUCC;
+    }
+  } else if (!idle_.Empty()) {
+    // 轮询idle主机
+    stat = idle_.Front();
+    idle_.Remove(stat);
+    idle_.PushBack(stat);
+  } else {
+    return RET_NOEXIST;
+  }
+  *host = stat->host_;
+  return ret;
+}
+
+void LoadBalance::RollWindow(HostStat* stat, uint64_t now_ns) const {
+  uint64_t window_ns = static_cast<uint64_t>(config_->window_ms_) * 1000000;
+  uint64_t elapsed = now_ns - stat->window_start_ns_;
+  if (elapsed < window_ns) {
+    return;
+  }
+  // 超过两个窗口没有调用，上一个窗口的数据也作废
+  bool adjacent = elapsed < 2 * window_ns;
+  stat->prev_succ_ = adjacent ? stat->succ_ : 0;
+  stat->prev_err_ = adjacent ? stat->err_ : 0;
+  stat->succ_ = stat->err_ = 0;
+  stat->window_start_ns_ = now_ns;
+}
+
+void LoadBalance::Report(const HostInfo& host, bool succ, uint64_t now_ns) {
+  auto itr = hosts_.find(HostKey(host));
+  if (itr == hosts_.end()) {
+    return;
+  }
+  HostStat* stat = itr->second.get();
+  RollWindow(stat, now_ns);
+  if (succ) {
+    ++stat->succ_;
+    ++stat->cont_succ_;
+  } else {
+    ++stat->err_;
+    stat->cont_succ_ = 0;
+  }
+  if (stat->overload_) {
+    if (stat->cont_succ_ >= static_cast<uint32_t>(config_->recover_succ_)) {
+      SetIdle(stat, now_ns);
+    }
+    return;
+  }
+  uint32_t err = stat->err_ + stat->prev_err_;
+  uint32_t total = stat->succ_ + stat->prev_succ_ + err;
+  if (err >= static_cast<uint32_t>(config_->min_err_) &&
+      err >= config_->err_rate_ * total) {
+    SetOverload(stat, now_ns);
+  }
+}
+
+void LoadBalance::SetOverload(HostStat* stat, uint64_t now_ns) {
+  idle_.Remove(stat);
+  stat->overload_ = true;
+  stat->overload_ns_ = now_ns;
+  stat->cont_succ_ = 0;
+  overload_.PushBack(stat);
+}
+
+void LoadBalance::SetIdle(HostStat* stat, uint64_t now_ns) {
+  overload_.Remove(stat);
+  stat->overload_ = false;
+  stat->succ_ = stat->err_ = stat->prev_succ_ = stat->prev_err_ = 0;
+  stat->cont_succ_ = 0;
+  stat->window_start_ns_ = now_ns;
+  idle_.PushBack(stat);
+}
+
+void LoadBalance::Update(const std::vector<HostInfo>& hosts, uint64_t now_ns) {
+  std::unordered_set<uint64_t> keys;
+  for (const auto& host : hosts) {
+    uint64_t key = HostKey(host);
+    keys.insert(key);
+    if (hosts_.find(key) != hosts_.end()) {
+      continue;
+    }
+    // 新主机加入idle
+    std::unique_ptr<HostStat> stat(new HostStat);
+    stat->host_ = host;
+    stat->window_start_ns_ = now_ns;
+    idle_.PushBack(stat.get());
+    hosts_[key] = std::move(stat);
+  }
+  // 删除路由服务中已经不存在的主机
+  for (auto itr = hosts_.begin(); itr != hosts_.end();) {
+    if (keys.count(itr->first) != 0) {
+      ++itr;
+      continue;
+    }
+    HostStat* stat = itr->second.get();
+    if (stat->overload_) {
+      overload_.Remove(stat);
+    } else {
+      idle_.Remove(stat);
+    }
+    itr = hosts_.erase(itr);
+  }
+}
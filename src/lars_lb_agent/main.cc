@@ -0,0 +1,35 @@
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "lars_lb_agent/lb_agent.h"
+
+// lars_lb_agent dns_ip dns_port [ip] [port] [threads]
+int main(int argc, char** argv) {
+  if (argc < 3) {
+    std::cerr << "usage: " << argv[0]
+              << " dns_ip dns_port [ip] [port] [threads]\n";
+    return 1;
+  }
+  const char* dns_ip = argv[1];
+  uint16_t dns_port = static_cast<uint16_t>(atoi(argv[2]));
+  const char* ip = argc > 3 ? argv[3] : "127.0.0.1";
+  uint16_t port = argc > 4 ? static_cast<uint16_t>(atoi(argv[4])) : 8888;
+  int threads = argc > 5 ? atoi(argv[5]) : 2;
+
+  // 每个线程一个事件循环和一个agent，线程之间不共享状态
+  std::vector<std::thread> loops;
+  for (int i = 0; i < threads; ++i) {
+    loops.emplace_back([=]() {
+      EventLoop loop;
+      LbAgent agent(&loop, dns_ip, dns_port);
+      agent.Serve(ip, port);
+      loop.EventProcess();
+    });
+  }
+  for (auto& t : loops) {
+    t.join();
+  }
+  return 0;
+}
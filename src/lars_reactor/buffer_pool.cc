@@ -1,7 +1,25 @@
 #include "lars_reactor/buffer_pool.h"
+
+#include <array>
 #include <cassert>
 #include <iostream>
 
+#include "lars_reactor/profiler.h"
+#include "lars_reactor/trace.h"
+
+thread_local int BufferPool::current_node_ = 0;
+
+BufferPool& BufferPool::instance(int node) {
+  if (node < 0 || node >= MAX_NUMA_NODES) {
+    node = 0;
+  }
+  static std::array<std::unique_ptr<BufferPool>, MAX_NUMA_NODES> pools;
+  static std::array<std::once_flag, MAX_NUMA_NODES> flags;
+  std::call_once(flags[node],
+                 [node] { pools[node].reset(new BufferPool(node)); });
+  return *pools[node];
+}
+
 void BufferPool::PreAllocPool(std::shared_ptr<IoBuffer>& prev, MEM_CAP size,
                               int nums) {
   pool_[size] = std::make_shared<IoBuffer>(size);
@@ -10,6 +28,7 @@ void BufferPool::PreAllocPool(std::shared_ptr<IoBuffer>& prev, MEM_CAP size,
     exit(1);
   }
   prev = pool_[size];
+  prev->SetNode(node_);
   for (int i = 1; i < nums; ++i) {
     prev->SetNext(std::make_shared<IoBuffer>(size));
     if (prev->GetNext() == nullptr) {
@@ -17,10 +36,32 @@ void BufferPool::PreAllocPool(std::shared_ptr<IoBuffer>& prev, MEM_CAP size,
       exit(1);
     }
     prev = prev->GetNext();
+    prev->SetNode(node_);
   }
   total_mem_ += size / 1024 * nums;
 }
 
+int BufferPool::PreAllocNum(MEM_CAP size) {
+  switch (size) {
+    case m4K:
+      return 5000;
+    case m16K:
+      return 1000;
+    case m64K:
+      return 500;
+    case m256K:
+      return 200;
+    case m1M:
+      return 50;
+    case m4M:
+      return 20;
+    case m8M:
+      return 10;
+    default:
+      return 0;
+  }
+}
+
 MEM_CAP BufferPool::FindNearestIndex(int n) {
   if (n <= m4K) {
     return m4K;
@@ -40,23 +81,41 @@ MEM_CAP BufferPool::FindNearestIndex(int n) {
   return unknown;
 }
 
-BufferPool::BufferPool() : total_mem_(0) {
+BufferPool::BufferPool(int node)
+    : total_mem_(0),
+      node_(node),
+      lazy_(node != 0 || NumaTopology::instance().NodeCount() > 1) {
+  if (lazy_) {
+    //每个numa节点的内存池由绑定到本节点cpu的线程调用WarmUp预分配，
+    //在此之前按需分配
+    return;
+  }
+  WarmUp();
+}
+
+void BufferPool::WarmUp() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (warmed_) {
+    return;
+  }
+  warmed_ = true;
   std::shared_ptr<IoBuffer> prev;
-  PreAllocPool(prev, m4K, 5000);
-  PreAllocPool(prev, m16K, 1000);
-  PreAllocPool(prev, m64K, 500);
-  PreAllocPool(prev, m256K, 200);
-  PreAllocPool(prev, m1M, 50);
-  PreAllocPool(prev, m4M, 20);
-  PreAllocPool(prev, m8M, 10);
+  for (MEM_CAP size : {m4K, m16K, m64K, m256K, m1M, m4M, m8M}) {
+    auto it = pool_.find(size);
+    if (it == pool_.end() || it->second == nullptr) {
+      PreAllocPool(prev, size, PreAllocNum(size));
+    }
+  }
 }
 
 std::shared_ptr<IoBuffer> BufferPool::AllocBuffer(int n) {
+  LARS_TRACE_SPAN("BufferPool::AllocBuffer");
   int index = static_cast<int>(FindNearestIndex(n));
   if (index == -1) {
     return nullptr;
   }
-  std::lock_guard<std::mutex> lock(mutex_);
+  HandlerProfiler::CountAlloc(index);
+  auto lock = TracedLock(mutex_, "BufferPool::lock");
   if (pool_[index] == nullptr) {
     if (total_mem_ + index / 1024 >= EXTRA_MEM_LIMIT) {
       std::cerr << "already use too much memory!\n";
@@ -67,6 +126,7 @@ std::shared_ptr<IoBuffer> BufferPool::AllocBuffer(int n) {
       std::cerr << "new io_buf error\n";
       exit(1);
     }
+    new_buffer->SetNode(node_);
     total_mem_ += index / 1024;
     return new_buffer;
   }
@@ -79,7 +139,13 @@ std::shared_ptr<IoBuffer> BufferPool::AllocBuffer() {
   return AllocBuffer(m4K);
 }
 void BufferPool::revert(const std::shared_ptr<IoBuffer>& buffer) {
-  std::lock_guard<std::mutex> lock(mutex_);
+  LARS_TRACE_SPAN("BufferPool::revert");
+  if (buffer->GetNode() != node_) {
+    //归还到buffer所属numa节点的内存池
+    instance(buffer->GetNode()).revert(buffer);
+    return;
+  }
+  auto lock = TracedLock(mutex_, "BufferPool::lock");
   int index = buffer->GetCapacity();
   buffer->Clear();
   assert(pool_.find(index) != pool_.end());
@@ -0,0 +1,78 @@
+#include "lars_reactor/coroutine.h"
+
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <utility>
+#include <vector>
+
+//帧内存池的分级数
+#define CORO_FRAME_CLASSES (CORO_FRAME_MAX / CORO_FRAME_ALIGN)
+
+// 每个线程的空闲帧，下标为分级
+thread_local std::vector<void*> frame_free_lists[CORO_FRAME_CLASSES];
+
+void* FramePool::Alloc(size_t size) {
+  if (size > CORO_FRAME_MAX) {
+    return ::operator new(size);
+  }
+  size_t index = (size - 1) / CORO_FRAME_ALIGN;
+  std::vector<void*>& free_list = frame_free_lists[index];
+  if (!free_list.empty()) {
+    void* ptr = free_list.back();
+    free_list.pop_back();
+    return ptr;
+  }
+  return ::operator new((index + 1) * CORO_FRAME_ALIGN);
+}
+
+void FramePool::Free(void* ptr, size_t size) {
+  if (size > CORO_FRAME_MAX) {
+    ::operator delete(ptr);
+    return;
+  }
+  frame_free_lists[(size - 1) / CORO_FRAME_ALIGN].push_back(ptr);
+}
+
+CoMailbox::CoMailbox(MsgRouter* router, int msg_id)
+    : router_(router), msg_id_(msg_id) {
+  if (router_->Register(msg_id_, [this](const char* data, int len, int msg_id,
+                                        void* args, NetConnection* conn) {
+        OnMessage(data, len, msg_id, conn);
+      }) == -1) {
+    // msg_id被其他回调占用，消息永远不会投递到信箱，等待的协程会一直挂起
+    std::cerr << "co mailbox msg_id " << msg_id_ << " is already taken!\n";
+    exit(1);
+  }
+}
+
+CoMailbox::~CoMailbox() {
+  router_->Unregister(msg_id_);
+  for (ReadAwaiter* waiter : waiters_) {
+    waiter->waiter_.destroy();
+  }
+}
+
+void CoMailbox::OnMessage(const char* data, int len, int msg_id,
+                          NetConnection* conn) {
+  // 消息可能排队或者协程在下一次挂起之后才使用连接，只保存弱引用
+  if (waiters_.empty()) {
+    messages_.push_back({msg_id, std::string(data, len), conn->GetHandle()});
+    return;
+  }
+  ReadAwaiter* waiter = waiters_.front();
+  waiters_.pop_front();
+  waiter->message_ = {msg_id, std::string(data, len), conn->GetHandle()};
+  waiter->delivered_ = true;
+  // 在消息回调中直接恢复协程，运行到它下一次挂起
+  waiter->waiter_.resume();
+}
+
+CoMessage CoMailbox::ReadAwaiter::await_resume() {
+  if (delivered_) {
+    return std::move(message_);
+  }
+  CoMessage message = std::move(mailbox_->messages_.front());
+  mailbox_->messages_.pop_front();
+  return message;
+}
@@ -0,0 +1,63 @@
+#include "lars_reactor/dispatch_scheduler.h"
+
+#include "lars_reactor/tcp_conn.h"
+#include "lars_reactor/trace.h"
+
+DispatchScheduler::DispatchScheduler(EventLoop* loop) : loop_(loop) {}
+
+void DispatchScheduler::SetMsgClass(int msg_id, int cls) {
+  if (cls < 0 || cls >= PRIORITY_CLASSES) {
+    msg_classes_.erase(msg_id);
+    return;
+  }
+  msg_classes_[msg_id] = cls;
+}
+
+void DispatchScheduler::SetWeight(int cls, int weight) {
+  if (cls >= 0 && cls < PRIORITY_CLASSES) {
+    weights_[cls] = weight > 0 ? weight : 1;
+  }
+}
+
+void DispatchScheduler::AddConn(TcpConn* conn) { conns_.push_back(conn); }
+
+void DispatchScheduler::Push(int cls, TcpConn* conn, const char* data, int len,
+                             int msg_id, bool compressed) {
+  queues_[cls].push_back({conn, data, len, msg_id, compressed});
+  if (!scheduled_) {
+    scheduled_ = true;
+    loop_->AddTask([this]() { Drain(); });
+  }
+}
+
+void DispatchScheduler::Drain() {
+  LARS_TRACE_SPAN("DispatchScheduler::Drain");
+  scheduled_ = false;
+  size_t heads[PRIORITY_CLASSES] = {0};
+  bool more = true;
+  while (more) {
+    more = false;
+    for (int cls = 0; cls < PRIORITY_CLASSES; ++cls) {
+      std::vector<Frame>& queue = queues_[cls];
+      for (int n = 0; n < weights_[cls] && heads[cls] < queue.size(); ++n) {
+        Frame frame = queue[heads[cls]++];
+        // 前面的回调可能关闭了连接，ibuf已经清空
+        if (frame.conn_->GetFd() != -1) {
+          frame.conn_->DispatchFrame(frame.data_, frame.len_, frame.msg_id_,
+                                     frame.compressed_);
+        }
+        frame.conn_->ReleaseFrame();
+      }
+      more = more || heads[cls] < queue.size();
+    }
+  }
+  for (auto& queue : queues_) {
+    queue.clear();
+  }
+  // 移除已分发的数据，预算用完的连接会继续解析，帧进入下一轮
+  std::vector<TcpConn*> conns;
+  conns.swap(conns_);
+  for (TcpConn* conn : conns) {
+    conn->FinishQueued();
+  }
+}
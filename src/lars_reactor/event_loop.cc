@@ -1,52 +1,166 @@
 #include "lars_reactor/event_loop.h"
 
-#include <cassert>
+#include <pthread.h>
+#include <sched.h>
+
+#include <ctime>
 #include <iostream>
 #include <utility>
 
+#include "lars_reactor/buffer_pool.h"
+#include "lars_reactor/trace.h"
+
 EventLoop::EventLoop() {
   epoll_fd_ = epoll_create1(0);
   if (epoll_fd_ == -1) {
     std::cerr << "epoll_create error!\n";
     exit(1);
   }
+  now_ns_ = ClockNs();
+}
+
+uint64_t EventLoop::ClockNs() {
+  struct timespec ts {};
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000000UL + ts.tv_nsec;
 }
 
 void EventLoop::EventProcess() {
-  while (true) {
-    int nfds = epoll_wait(epoll_fd_, fired_evs_.data(), MAXEVENTS, 10);
-    for (int i = 0; i < nfds; ++i) {
-      // 通过触发的fd找到对应的绑定事件
-      auto ev_itr = io_evs_.find(fired_evs_[i].data.fd);
-      assert(ev_itr != io_evs_.end());
-      IoEvent* ev = &(ev_itr->second);
-      if (fired_evs_[i].events & EPOLLIN) {
-        // 读事件，调读回调函数
+  while (!quit_) {
+    int nfds = WaitEvents();
+    now_ns_ = ClockNs();
+    ProcessEvents(nfds);
+    RunTasks();
+    stats_.busy_ns_ += ClockNs() - now_ns_;
+  }
+}
+
+bool EventLoop::BindCpuSet(const std::vector<int>& cpus) {
+  if (cpus.empty()) {
+    return false;
+  }
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  for (int cpu : cpus) {
+    if (cpu < 0 || cpu >= CPU_SETSIZE) {
+      std::cerr << "cpu " << cpu << " out of range error!\n";
+      return false;
+    }
+    CPU_SET(cpu, &cpu_set);
+  }
+  int ret = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+  if (ret != 0) {
+    std::cerr << "bind event loop to cpu " << cpus[0] << " error!\n";
+    return false;
+  }
+  cpu_ = cpus[0];
+  // 本线程之后的buffer都从本地numa节点的内存池分配，
+  // 在已经绑核的线程里预分配，让物理页落在本地节点
+  numa_node_ = NumaTopology::instance().NodeOfCpu(cpu_);
+  BufferPool::SetCurrentNode(numa_node_);
+  BufferPool::instance(numa_node_).WarmUp();
+  return true;
+}
+
+int EventLoop::WaitEvents() {
+  LARS_TRACE_SPAN("EventLoop::WaitEvents");
+  int nfds;
+  uint64_t begin = ClockNs();
+  if (busy_poll_us_ > 0) {
+    // 在自旋预算内以timeout=0轮询，避免阻塞唤醒带来的延迟
+    uint64_t deadline = begin + static_cast<uint64_t>(busy_poll_us_) * 1000;
+    uint64_t now;
+    do {
+      nfds = epoll_wait(epoll_fd_, fired_evs_.data(), MAXEVENTS, 0);
+      now = ClockNs();
+    } while (nfds == 0 && now < deadline);
+    stats_.spin_ns_ += now - begin;
+    if (nfds != 0) {
+      ++stats_.spin_hits_;
+      return nfds;
+    }
+    // 自旋预算耗尽，转入阻塞等待
+    ++stats_.spin_misses_;
+    begin = now;
+  }
+  // 还有任务(如上一轮留下的待分发消息)时不阻塞
+  nfds = epoll_wait(epoll_fd_, fired_evs_.data(), MAXEVENTS,
+                    tasks_.empty() ? EPOLL_WAIT_TIMEOUT : 0);
+  stats_.block_ns_ += ClockNs() - begin;
+  return nfds;
+}
+
+void EventLoop::ProcessEvents(int nfds) {
+  for (int i = 0; i < nfds; ++i) {
+    // 通过触发的fd找到对应的绑定事件，可能已经被本轮之前的回调删除
+    IoEvent* ev = GetData(fired_evs_[i].data.fd);
+    if (ev == nullptr) {
+      continue;
+    }
+    if (fired_evs_[i].events & EPOLLIN) {
+      // 读事件，调读回调函数
+      LARS_TRACE_SPAN_ARG("EventLoop::read_callback", fired_evs_[i].data.fd);
+      void* args = ev->rcb_args_;
+      ev->read_callback_(this, fired_evs_[i].data.fd, args);
+    } else if (fired_evs_[i].events & EPOLLOUT) {
+      // 写事件，调写回调函数
+      LARS_TRACE_SPAN_ARG("EventLoop::write_callback", fired_evs_[i].data.fd);
+      void* args = ev->wcb_args_;
+      ev->write_callback_(this, fired_evs_[i].data.fd, args);
+    } else if (fired_evs_[i].events & (EPOLLHUP | EPOLLERR)) {
+      // 水平触发未处理，可能会出现HUP事件，正常处理读写，没有则清空
+      if (ev->read_callback_ != nullptr) {
         void* args = ev->rcb_args_;
         ev->read_callback_(this, fired_evs_[i].data.fd, args);
-      } else if (fired_evs_[i].events & EPOLLOUT) {
-        // 写事件，调写回调函数
+      } else if (ev->write_callback_ != nullptr) {
         void* args = ev->wcb_args_;
         ev->write_callback_(this, fired_evs_[i].data.fd, args);
-      } else if (fired_evs_[i].events & (EPOLLHUP | EPOLLERR)) {
-        // 水平触发未处理，可能会出现HUP事件，正常处理读写，没有则清空
-        if (ev->read_callback_ != nullptr) {
-          void* args = ev->rcb_args_;
-          ev->read_callback_(this, fired_evs_[i].data.fd, args);
-        } else if (ev->write_callback_ != nullptr) {
-          void* args = ev->wcb_args_;
-          ev->write_callback_(this, fired_evs_[i].data.fd, args);
-        } else {
-          // 删除
-          std::cerr << "fd " << fired_evs_[i].data.fd
-                    << " get error,delete it from epoll!\n";
-          this->DelIoEvent(fired_evs_[i].data.fd);
-        }
+      } else {
+        // 删除
+        std::cerr << "fd " << fired_evs_[i].data.fd
+                  << " get error,delete it from epoll!\n";
+        this->DelIoEvent(fired_evs_[i].data.fd);
       }
     }
   }
 }
 
+int EventLoop::RunAfter(int delay_ms, timer_callback callback) {
+  if (timers_ == nullptr) {
+    timers_.reset(new TimerQueue(this));
+  }
+  uint64_t delay_ns = static_cast<uint64_t>(delay_ms) * 1000000;
+  return timers_->AddTimer(ClockNs() + delay_ns, 0, std::move(callback));
+}
+
+int EventLoop::RunEvery(int interval_ms, timer_callback callback) {
+  if (timers_ == nullptr) {
+    timers_.reset(new TimerQueue(this));
+  }
+  uint64_t interval_ns = static_cast<uint64_t>(interval_ms) * 1000000;
+  return timers_->AddTimer(ClockNs() + interval_ns, interval_ns,
+                           std::move(callback));
+}
+
+void EventLoop::CancelTimer(int timer_id) {
+  if (timers_ != nullptr) {
+    timers_->CancelTimer(timer_id);
+  }
+}
+
+void EventLoop::RunTasks() {
+  if (tasks_.empty()) {
+    return;
+  }
+  LARS_TRACE_SPAN("EventLoop::RunTasks");
+  // 任务执行过程中可能继续添加任务，留到下一轮
+  std::vector<std::function<void()>> tasks;
+  tasks.swap(tasks_);
+  for (auto& task : tasks) {
+    task();
+  }
+}
+
 /**
  * 这里我们处理的事件机制是
  * 如果EPOLLIN 在mask中， EPOLLOUT就不允许在mask中
@@ -56,57 +170,60 @@ void EventLoop::EventProcess() {
 
 void EventLoop::AddIoEvent(int fd, io_callback proc, int mask, void* args) {
   int final_mask, op;
+  if (fd >= static_cast<int>(io_evs_.size())) {
+    io_evs_.resize(fd + 1);
+  }
+  IoEvent& ev = io_evs_[fd];
   // 找到当前fd是否已经有事件
-  auto itr = io_evs_.find(fd);
-  if (itr == io_evs_.end()) {
+  if (ev.mask_ == 0) {
     // 如果没有操作动作就是ADD
-    // 没有找到
     final_mask = mask;
     op = EPOLL_CTL_ADD;
   } else {
     // 如果有操作动作是MOD
     // 添加事件标识位
-    final_mask = itr->second.mask_ | mask;
+    final_mask = ev.mask_ | mask;
     op = EPOLL_CTL_MOD;
   }
   // 注册回调函数
   if (mask & EPOLLIN) {
-    io_evs_[fd].read_callback_ = std::move(proc);
-    io_evs_[fd].rcb_args_ = args;
+    ev.read_callback_ = proc;
+    ev.rcb_args_ = args;
   } else if (mask & EPOLLOUT) {
-    io_evs_[fd].write_callback_ = std::move(proc);
-    io_evs_[fd].wcb_args_ = args;
+    ev.write_callback_ = proc;
+    ev.wcb_args_ = args;
   }
-  // epoll_ctl添加到epoll堆里
-  io_evs_[fd].mask_ = final_mask;
   // 创建原生epoll事件
   struct epoll_event event {};
   event.events = final_mask;
   event.data.fd = fd;
   if (epoll_ctl(epoll_fd_, op, fd, &event) == -1) {
     std::cerr << "epoll_ctr " << fd << " error!\n";
+    if (op == EPOLL_CTL_ADD) {
+      ev = IoEvent();
+    }
     return;
   }
-  // 将fd添加到监听集合中
-  listen_fds.insert(fd);
+  // epoll_ctl添加到epoll堆里之后再记录mask
+  ev.mask_ = final_mask;
 }
 
 void EventLoop::DelIoEvent(int fd) {
   // 将事件从_io_evs删除
-  io_evs_.erase(fd);
-  // 将fd从监听集合中删除
-  listen_fds.erase(fd);
+  if (fd < static_cast<int>(io_evs_.size())) {
+    io_evs_[fd] = IoEvent();
+  }
   // 将fd从epoll堆删除
   epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
 }
 
 void EventLoop::DelIoEvent(int fd, int mask) {
   // 如果没有该事件，直接返回
-  auto itr = io_evs_.find(fd);
-  if (itr == io_evs_.end()) {
+  IoEvent* ev = GetData(fd);
+  if (ev == nullptr) {
     return;
   }
-  int& o_mask = itr->second.mask_;
+  int& o_mask = ev->mask_;
   // 修正mask
   o_mask = o_mask & (~mask);
   if (o_mask == 0) {
@@ -121,9 +238,9 @@ void EventLoop::DelIoEvent(int fd, int mask) {
   }
 }
 IoEvent* EventLoop::GetData(int fd) {
-  auto itr = io_evs_.find(fd);
-  if (itr != io_evs_.end()) {
-    return &(itr->second);
+  if (fd < 0 || fd >= static_cast<int>(io_evs_.size()) ||
+      io_evs_[fd].mask_ == 0) {
+    return nullptr;
   }
-  return nullptr;
+  return &io_evs_[fd];
 }
@@ -0,0 +1,192 @@
+#include "lars_reactor/hot_restart.h"
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+//一次最多交接的监听fd个数
+#define HOT_RESTART_MAX_FDS 64
+//新进程等待旧进程发送fd的最长时间(秒)
+#define HOT_RESTART_RECV_TIMEOUT 5
+
+// 新进程连接的回调
+auto handoff_callback = [](EventLoop* loop, int fd, void* args) {
+  auto restart = static_cast<HotRestart*>(args);
+  restart->DoHandoff();
+};
+
+static void FillAddr(const std::string& path, struct sockaddr_un* addr) {
+  memset(addr, 0, sizeof(*addr));
+  addr->sun_family = AF_UNIX;
+  strncpy(addr->sun_path, path.c_str(), sizeof(addr->sun_path) - 1);
+}
+
+HotRestart::HotRestart(EventLoop* loop, const std::string& path)
+    : loop_(loop), path_(path) {}
+
+HotRestart::~HotRestart() {
+  if (drain_timer_ != -1) {
+    loop_->CancelTimer(drain_timer_);
+  }
+  if (sockfd_ != -1) {
+    loop_->DelIoEvent(sockfd_);
+    close(sockfd_);
+    unlink(path_.c_str());
+  }
+}
+
+int HotRestart::Inherit(const std::string& path, std::vector<int>* fds) {
+  int sockfd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (sockfd == -1) {
+    std::cerr << "HotRestart::socket()\n";
+    return -1;
+  }
+  struct sockaddr_un addr {};
+  FillAddr(path, &addr);
+  if (connect(sockfd, reinterpret_cast<const struct sockaddr*>(&addr),
+              sizeof(addr)) == -1) {
+    // 没有旧进程，正常冷启动
+    close(sockfd);
+    return -1;
+  }
+  struct timeval tv {};
+  tv.tv_sec = HOT_RESTART_RECV_TIMEOUT;
+  setsockopt(sockfd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+  int count = 0;
+  char control[CMSG_SPACE(sizeof(int) * HOT_RESTART_MAX_FDS)];
+  struct iovec iov {};
+  iov.iov_base = &count;
+  iov.iov_len = sizeof(count);
+  struct msghdr msg {};
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+  ssize_t ret;
+  do {
+    ret = recvmsg(sockfd, &msg, MSG_CMSG_CLOEXEC);
+  } while (ret == -1 && errno == EINTR);
+  close(sockfd);
+  struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+  if (ret != sizeof(count) || count <= 0 || count > HOT_RESTART_MAX_FDS ||
+      (msg.msg_flags & MSG_CTRUNC) || cmsg == nullptr ||
+      cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS ||
+      cmsg->cmsg_len != CMSG_LEN(sizeof(int) * count)) {
+    std::cerr << "inherit listen fds from " << path << " error!\n";
+    // 已经收到的fd不会再有人使用，全部关闭
+    for (; ret > 0 && cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+      if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+        int num = static_cast<int>((cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int));
+        for (int i = 0; i < num; ++i) {
+          int fd;
+          memcpy(&fd, CMSG_DATA(cmsg) + i * sizeof(int), sizeof(fd));
+          close(fd);
+        }
+      }
+    }
+    return -2;
+  }
+  fds->resize(count);
+  memcpy(fds->data(), CMSG_DATA(cmsg), sizeof(int) * count);
+  return 0;
+}
+
+int HotRestart::Listen() {
+  sockfd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (sockfd_ == -1) {
+    std::cerr << "HotRestart::socket()\n";
+    return -1;
+  }
+  struct sockaddr_un addr {};
+  FillAddr(path_, &addr);
+  // 旧进程的unix socket还在，但旧进程已经交出fd，不会再有人连接它
+  unlink(path_.c_str());
+  if (bind(sockfd_, reinterpret_cast<const struct sockaddr*>(&addr),
+           sizeof(addr)) < 0 ||
+      listen(sockfd_, 1) == -1) {
+    std::cerr << "listen hot restart " << path_ << " error\n";
+    close(sockfd_);
+    sockfd_ = -1;
+    return -1;
+  }
+  loop_->AddIoEvent(sockfd_, handoff_callback, EPOLLIN, this);
+  return 0;
+}
+
+void HotRestart::DoHandoff() {
+  int connfd = accept4(sockfd_, nullptr, nullptr, SOCK_CLOEXEC);
+  if (connfd == -1) {
+    std::cerr << "accept hot restart error\n";
+    return;
+  }
+  std::vector<int> fds;
+  for (TcpServer* server : servers_) {
+    if (server->GetListenFd() != -1) {
+      fds.push_back(server->GetListenFd());
+    }
+  }
+  int count = static_cast<int>(fds.size());
+  if (count == 0 || count > HOT_RESTART_MAX_FDS) {
+    std::cerr << "no listen fd to hand off\n";
+    close(connfd);
+    return;
+  }
+  char control[CMSG_SPACE(sizeof(int) * HOT_RESTART_MAX_FDS)];
+  memset(control, 0, sizeof(control));
+  struct iovec iov {};
+  iov.iov_base = &count;
+  iov.iov_len = sizeof(count);
+  struct msghdr msg {};
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = CMSG_SPACE(sizeof(int) * count);
+  struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(int) * count);
+  memcpy(CMSG_DATA(cmsg), fds.data(), sizeof(int) * count);
+  ssize_t ret = sendmsg(connfd, &msg, MSG_NOSIGNAL);
+  close(connfd);
+  if (ret == -1) {
+    // 交接失败，继续作为当前进程服务
+    std::cerr << "hand off listen fds error!\n";
+    return;
+  }
+
+  // 新进程已经持有监听socket，本进程不再accept，unix socket路径留给新进程
+  for (TcpServer* server : servers_) {
+    server->StopAccept();
+  }
+  loop_->DelIoEvent(sockfd_);
+  close(sockfd_);
+  sockfd_ = -1;
+
+  draining_ = true;
+  drain_deadline_ns_ = EventLoop::ClockNs() +
+                       static_cast<uint64_t>(drain_timeout_ms_) * 1000000;
+  drain_timer_ =
+      loop_->RunEvery(HOT_RESTART_DRAIN_INTERVAL, [this]() { CheckDrained(); });
+  std::cout << "hand off " << count << " listen fds, draining connections\n";
+}
+
+void HotRestart::CheckDrained() {
+  size_t conns = 0;
+  for (TcpServer* server : servers_) {
+    conns += server->GetConnNum();
+  }
+  if (conns != 0 && EventLoop::ClockNs() < drain_deadline_ns_) {
+    return;
+  }
+  if (conns != 0) {
+    std::cerr << "drain timeout, " << conns << " connections left\n";
+  }
+  loop_->CancelTimer(drain_timer_);
+  drain_timer_ = -1;
+  loop_->Stop();
+}
@@ -1,10 +1,13 @@
 #include "lars_reactor/io_buffer.h"
 
+#include "lars_reactor/trace.h"
+
 IoBuffer::IoBuffer(int size)
     : data_(new char[size]),
       capacity_(size),
       length_(0),
       head_(0),
+      node_(0),
       next_(nullptr) {}
 
 void IoBuffer::Clear() {
@@ -14,6 +17,7 @@ void IoBuffer::Clear() {
 void IoBuffer::Adjust() {
   if (head_ != 0) {
     if (length_ != 0) {
+      LARS_TRACE_SPAN_ARG("IoBuffer::Adjust", length_);
       memmove(data_, data_ + head_, length_);
     }
     head_ = 0;
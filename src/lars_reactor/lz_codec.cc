@@ -0,0 +1,174 @@
+#include "lars_reactor/lz_codec.h"
+
+#include <cstdint>
+#include <cstring>
+
+//最短匹配长度
+#define LZ_MIN_MATCH 4
+//最后LZ_LAST_LITERALS字节必须是字面量
+#define LZ_LAST_LITERALS 5
+//匹配不能从最后LZ_MF_LIMIT字节开始
+#define LZ_MF_LIMIT 12
+//最大回溯距离
+#define LZ_MAX_DISTANCE 65535
+//哈希表的位数
+#define LZ_HASH_LOG 12
+
+static inline uint32_t Read32(const uint8_t* p) {
+  uint32_t value;
+  memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+static inline uint32_t Hash(uint32_t sequence) {
+  return (sequence * 2654435761U) >> (32 - LZ_HASH_LOG);
+}
+
+// 写长度的扩展字节(长度>=15时)，返回新的写入位置
+static inline uint8_t* WriteLength(uint8_t* op, int len) {
+  for (len -= 15; len >= 255; len -= 255) {
+    *op++ = 255;
+  }
+  *op++ = static_cast<uint8_t>(len);
+  return op;
+}
+
+// 写一个序列的token和字面量，返回新的写入位置，空间不够返回nullptr
+static uint8_t* WriteLiterals(uint8_t* op, uint8_t* oend, const uint8_t* anchor,
+                              int literals, int match_len) {
+  // token + 扩展长度 + 字面量 + offset + 匹配扩展长度
+  if (oend - op < 1 + literals / 255 + 1 + literals + 2 + match_len / 255 + 1) {
+    return nullptr;
+  }
+  uint8_t* token = op++;
+  *token = static_cast<uint8_t>((literals >= 15 ? 15 : literals) << 4);
+  if (literals >= 15) {
+    op = WriteLength(op, literals);
+  }
+  memcpy(op, anchor, literals);
+  return op + literals;
+}
+
+int LzCodec::Compress(const char* src, int n, char* dst, int cap) {
+  const uint8_t* base = reinterpret_cast<const uint8_t*>(src);
+  const uint8_t* ip = base;
+  const uint8_t* anchor = base;
+  const uint8_t* iend = base + n;
+  uint8_t* op = reinterpret_cast<uint8_t*>(dst);
+  uint8_t* oend = op + cap;
+  uint32_t table[1 << LZ_HASH_LOG];
+  memset(table, 0, sizeof(table));
+
+  if (n >= LZ_MF_LIMIT + 1) {
+    const uint8_t* mflimit = iend - LZ_MF_LIMIT;
+    const uint8_t* matchlimit = iend - LZ_LAST_LITERALS;
+    int misses = 0;
+    while (ip < mflimit) {
+      uint32_t sequence = Read32(ip);
+      uint32_t h = Hash(sequence);
+      const uint8_t* ref = base + table[h];
+      table[h] = static_cast<uint32_t>(ip - base);
+      if (ref >= ip || ip - ref > LZ_MAX_DISTANCE || Read32(ref) != sequence) {
+        // 连续没有匹配时加大步长，跳过不可压缩的数据
+        ip += 1 + (misses++ >> 6);
+        continue;
+      }
+      misses = 0;
+      // 向后扩展匹配
+      const uint8_t* match_end = ip + LZ_MIN_MATCH;
+      const uint8_t* ref_end = ref + LZ_MIN_MATCH;
+      while (match_end < matchlimit && *match_end == *ref_end) {
+        ++match_end;
+        ++ref_end;
+      }
+      int match_len = static_cast<int>(match_end - ip) - LZ_MIN_MATCH;
+      int literals = static_cast<int>(ip - anchor);
+      uint8_t* token = op;
+      op = WriteLiterals(op, oend, anchor, literals, match_len);
+      if (op == nullptr) {
+        return 0;
+      }
+      uint16_t offset = static_cast<uint16_t>(ip - ref);
+      *op++ = static_cast<uint8_t>(offset);
+      *op++ = static_cast<uint8_t>(offset >> 8);
+      *token |= static_cast<uint8_t>(match_len >= 15 ? 15 : match_len);
+      if (match_len >= 15) {
+        op = WriteLength(op, match_len);
+      }
+      ip = match_end;
+      anchor = ip;
+    }
+  }
+  // 最后一个序列只有字面量
+  op = WriteLiterals(op, oend, anchor, static_cast<int>(iend - anchor), 0);
+  if (op == nullptr) {
+    return 0;
+  }
+  return static_cast<int>(op - reinterpret_cast<uint8_t*>(dst));
+}
+
+// 读长度的扩展字节，越界返回-1
+static inline int ReadLength(const uint8_t*& ip, const uint8_t* iend, int len) {
+  uint8_t b;
+  do {
+    if (ip >= iend) {
+      return -1;
+    }
+    b = *ip++;
+    len += b;
+  } while (b == 255);
+  return len;
+}
+
+int LzCodec::Decompress(const char* src, int n, char* dst, int cap) {
+  const uint8_t* ip = reinterpret_cast<const uint8_t*>(src);
+  const uint8_t* iend = ip + n;
+  uint8_t* ostart = reinterpret_cast<uint8_t*>(dst);
+  uint8_t* op = ostart;
+  uint8_t* oend = op + cap;
+  while (ip < iend) {
+    uint8_t token = *ip++;
+    int literals = token >> 4;
+    if (literals == 15 && (literals = ReadLength(ip, iend, literals)) == -1) {
+      return -1;
+    }
+    if (literals > iend - ip || literals > oend - op) {
+      return -1;
+    }
+    memcpy(op, ip, literals);
+    ip += literals;
+    op += literals;
+    if (ip == iend) {
+      // 最后一个序列
+      return static_cast<int>(op - ostart);
+    }
+    if (iend - ip < 2) {
+      return -1;
+    }
+    int offset = ip[0] | (ip[1] << 8);
+    ip += 2;
+    if (offset == 0 || offset > op - ostart) {
+      return -1;
+    }
+    int match_len = token & 15;
+    if (match_len == 15 &&
+        (match_len = ReadLength(ip, iend, match_len)) == -1) {
+      return -1;
+    }
+    match_len += LZ_MIN_MATCH;
+    if (match_len > oend - op) {
+      return -1;
+    }
+    const uint8_t* match = op - offset;
+    if (offset >= match_len) {
+      memcpy(op, match, match_len);
+      op += match_len;
+    } else {
+      // 重叠的匹配(如连续重复的字节)逐字节复制
+      for (int i = 0; i < match_len; ++i) {
+        *op++ = *match++;
+      }
+    }
+  }
+  return -1;
+}
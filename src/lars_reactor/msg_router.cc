@@ -0,0 +1,69 @@
+#include "lars_reactor/msg_router.h"
+
+#include "lars_reactor/trace.h"
+
+#include <iostream>
+#include <utility>
+
+int MsgRouter::Register(int msg_id, msg_callback callback, void* args) {
+  if (routers_.find(msg_id) != routers_.end()) {
+    std::cerr << "msg_id " << msg_id << " is already registered!\n";
+    return -1;
+  }
+  routers_[msg_id] = {std::move(callback), args};
+  return 0;
+}
+
+int MsgRouter::RegisterChunk(int msg_id, chunk_callback callback, void* args) {
+  if (chunks_.find(msg_id) != chunks_.end()) {
+    std::cerr << "msg_id " << msg_id << " is already registered!\n";
+    return -1;
+  }
+  chunks_[msg_id] = {std::move(callback), args};
+  return 0;
+}
+
+int MsgRouter::RegisterChain(int msg_id, chain_callback callback, void* args) {
+  if (chains_.find(msg_id) != chains_.end()) {
+    std::cerr << "msg_id " << msg_id << " is already registered!\n";
+    return -1;
+  }
+  chains_[msg_id] = {std::move(callback), args};
+  return 0;
+}
+
+bool MsgRouter::Call(int msg_id, int len, const char* data, NetConnection* conn) {
+  auto itr = routers_.find(msg_id);
+  if (itr == routers_.end()) {
+    return false;
+  }
+  LARS_TRACE_SPAN_ARG("MsgRouter::Call", msg_id);
+  ProfileScope profile(profiler_, msg_id);
+  itr->second.callback_(data, len, msg_id, itr->second.args_, conn);
+  return true;
+}
+
+bool MsgRouter::CallChunk(int msg_id, const char* data, int len, int offset,
+                          int total, NetConnection* conn) {
+  auto itr = chunks_.find(msg_id);
+  if (itr == chunks_.end()) {
+    return false;
+  }
+  LARS_TRACE_SPAN_ARG("MsgRouter::CallChunk", msg_id);
+  ProfileScope profile(profiler_, msg_id);
+  itr->second.callback_(data, len, offset, total, msg_id, itr->second.args_,
+                        conn);
+  return true;
+}
+
+bool MsgRouter::CallChain(int msg_id, const std::shared_ptr<IoBuffer>& chain,
+                          int total, NetConnection* conn) {
+  auto itr = chains_.find(msg_id);
+  if (itr == chains_.end()) {
+    return false;
+  }
+  LARS_TRACE_SPAN_ARG("MsgRouter::CallChain", msg_id);
+  ProfileScope profile(profiler_, msg_id);
+  itr->second.callback_(chain, total, msg_id, itr->second.args_, conn);
+  return true;
+}
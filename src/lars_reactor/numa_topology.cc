@@ -0,0 +1,76 @@
+#include "lars_reactor/numa_topology.h"
+
+#include <unistd.h>
+
+#include <cstdlib>
+#include <fstream>
+#include <string>
+
+NumaTopology::NumaTopology() {
+  for (int node = 0; node < MAX_NUMA_NODES; ++node) {
+    std::ifstream in("/sys/devices/system/node/node" + std::to_string(node) +
+                     "/cpulist");
+    if (!in) {
+      break;
+    }
+    std::string list;
+    std::getline(in, list);
+    node_cpus_.push_back(ParseCpuList(list.c_str()));
+  }
+  if (node_cpus_.empty()) {
+    // 没有numa信息，所有cpu都归属node 0
+    long ncpus = sysconf(_SC_NPROCESSORS_CONF);
+    std::vector<int> cpus;
+    for (int cpu = 0; cpu < ncpus; ++cpu) {
+      cpus.push_back(cpu);
+    }
+    node_cpus_.push_back(cpus);
+  }
+  for (int node = 0; node < NodeCount(); ++node) {
+    for (int cpu : node_cpus_[node]) {
+      if (cpu >= static_cast<int>(cpu_node_.size())) {
+        cpu_node_.resize(cpu + 1, 0);
+      }
+      cpu_node_[cpu] = node;
+    }
+  }
+}
+
+int NumaTopology::NodeOfCpu(int cpu) const {
+  if (cpu < 0 || cpu >= static_cast<int>(cpu_node_.size())) {
+    return 0;
+  }
+  return cpu_node_[cpu];
+}
+
+const std::vector<int>& NumaTopology::CpusOfNode(int node) const {
+  if (node < 0 || node >= NodeCount()) {
+    return node_cpus_[0];
+  }
+  return node_cpus_[node];
+}
+
+std::vector<int> NumaTopology::ParseCpuList(const char* list) {
+  std::vector<int> cpus;
+  const char* p = list;
+  while (*p != '\0' && *p != '\n') {
+    char* end;
+    long first = strtol(p, &end, 10);
+    if (end == p) {
+      break;
+    }
+    long last = first;
+    p = end;
+    if (*p == '-') {
+      last = strtol(p + 1, &end, 10);
+      p = end;
+    }
+    for (long cpu = first; cpu <= last; ++cpu) {
+      cpus.push_back(static_cast<int>(cpu));
+    }
+    if (*p == ',') {
+      ++p;
+    }
+  }
+  return cpus;
+}
@@ -0,0 +1,158 @@
+#include "lars_reactor/profiler.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+
+#include "lars_reactor/buffer_pool.h"
+#include "lars_reactor/event_loop.h"
+#include "lars_reactor/message.h"
+#include "lars_reactor/msg_router.h"
+#include "lars_reactor/net_connection.h"
+
+thread_local uint32_t HandlerProfiler::t_calls_ = 0;
+thread_local ProfileSample* HandlerProfiler::t_sample_ = nullptr;
+
+//各规格的内存块容量，与MEM_CAP对应
+static const int kSizeClasses[PROFILE_SIZE_CLASSES] = {m4K,  m16K, m64K, m256K,
+                                                       m1M,  m4M,  m8M};
+//报告中各规格的名字
+static const char* kSizeNames[PROFILE_SIZE_CLASSES] = {"4K",   "16K", "64K",
+                                                       "256K", "1M",  "4M",
+                                                       "8M"};
+
+static uint64_t ThreadCpuNs() {
+  struct timespec ts {};
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000000UL + ts.tv_nsec;
+}
+
+int HandlerProfiler::SizeClass(int size) {
+  for (int i = 0; i < PROFILE_SIZE_CLASSES - 1; ++i) {
+    if (size <= kSizeClasses[i]) {
+      return i;
+    }
+  }
+  return PROFILE_SIZE_CLASSES - 1;
+}
+
+void HandlerProfiler::Begin(ProfileSample* sample, uint64_t* wall_ns,
+                            uint64_t* cpu_ns) {
+  memset(sample->allocs_, 0, sizeof(sample->allocs_));
+  sample->prev_ = t_sample_;
+  t_sample_ = sample;
+  *wall_ns = EventLoop::ClockNs();
+  *cpu_ns = ThreadCpuNs();
+}
+
+void HandlerProfiler::End(int msg_id, ProfileSample* sample, uint64_t wall_ns,
+                          uint64_t cpu_ns) {
+  uint64_t cpu = ThreadCpuNs() - cpu_ns;
+  uint64_t wall = EventLoop::ClockNs() - wall_ns;
+  t_sample_ = sample->prev_;
+  if (t_sample_ != nullptr) {
+    // 嵌套的回调的分配也算在外层回调上
+    for (int i = 0; i < PROFILE_SIZE_CLASSES; ++i) {
+      t_sample_->allocs_[i] += sample->allocs_[i];
+    }
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  HandlerStats& stats = stats_[msg_id];
+  stats.samples_++;
+  stats.wall_ns_ += wall;
+  stats.cpu_ns_ += cpu;
+  stats.max_wall_ns_ = std::max(stats.max_wall_ns_, wall);
+  for (int i = 0; i < PROFILE_SIZE_CLASSES; ++i) {
+    stats.allocs_[i] += sample->allocs_[i];
+  }
+}
+
+bool HandlerProfiler::GetStats(int msg_id, HandlerStats* stats) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto itr = stats_.find(msg_id);
+  if (itr == stats_.end()) {
+    return false;
+  }
+  *stats = itr->second;
+  return true;
+}
+
+std::vector<std::pair<int, HandlerStats>> HandlerProfiler::Report(
+    ProfileSort sort) {
+  std::vector<std::pair<int, HandlerStats>> report;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    report.assign(stats_.begin(), stats_.end());
+  }
+  auto key = [sort](const HandlerStats& stats) {
+    switch (sort) {
+      case PROFILE_SORT_WALL:
+        return stats.wall_ns_;
+      case PROFILE_SORT_ALLOCS:
+        return stats.TotalAllocs();
+      default:
+        return stats.cpu_ns_;
+    }
+  };
+  std::sort(report.begin(), report.end(),
+            [&key](const std::pair<int, HandlerStats>& a,
+                   const std::pair<int, HandlerStats>& b) {
+              uint64_t ka = key(a.second), kb = key(b.second);
+              return ka != kb ? ka > kb : a.first < b.first;
+            });
+  return report;
+}
+
+std::string HandlerProfiler::Dump(ProfileSort sort) {
+  std::vector<std::pair<int, HandlerStats>> report = Report(sort);
+  std::string out;
+  char line[512];
+  snprintf(line, sizeof(line), "%-12s %10s %12s %12s %12s %12s %10s  %s\n",
+           "msg_id", "samples", "est_calls", "cpu_us/call", "wall_us/call",
+           "max_wall_us", "allocs/call", "allocs_by_size");
+  out += line;
+  uint64_t rate = static_cast<uint64_t>(std::max(GetRate(), 1));
+  for (const auto& item : report) {
+    const HandlerStats& stats = item.second;
+    double samples = static_cast<double>(stats.samples_);
+    int n = snprintf(line, sizeof(line),
+                     "%-12d %10lu %12lu %12.3f %12.3f %12.3f %10.2f ",
+                     item.first, static_cast<unsigned long>(stats.samples_),
+                     static_cast<unsigned long>(stats.samples_ * rate),
+                     stats.cpu_ns_ / samples / 1000.0,
+                     stats.wall_ns_ / samples / 1000.0,
+                     stats.max_wall_ns_ / 1000.0,
+                     stats.TotalAllocs() / samples);
+    for (int i = 0; i < PROFILE_SIZE_CLASSES; ++i) {
+      if (stats.allocs_[i] != 0 && n < static_cast<int>(sizeof(line))) {
+        n += snprintf(line + n, sizeof(line) - n, " %s:%lu", kSizeNames[i],
+                      static_cast<unsigned long>(stats.allocs_[i]));
+      }
+    }
+    out += line;
+    out += '\n';
+  }
+  return out;
+}
+
+void HandlerProfiler::Reset() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  stats_.clear();
+}
+
+int HandlerProfiler::AddDumpRouter(MsgRouter* router, int msg_id) {
+  return router->Register(
+      msg_id,
+      [](const char* data, int len, int msg_id, void* args,
+         NetConnection* conn) {
+        std::string report = static_cast<HandlerProfiler*>(args)->Dump();
+        if (report.size() > MESSAGE_LENGTH_LIMIT) {
+          // 报告按开销排序，在行尾截断，保留开销最大的msg_id
+          report.resize(report.rfind('\n', MESSAGE_LENGTH_LIMIT - 1) + 1);
+        }
+        conn->SendMessage(report.data(), static_cast<int>(report.size()),
+                          msg_id);
+      },
+      this);
+}
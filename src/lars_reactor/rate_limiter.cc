@@ -0,0 +1,65 @@
+#include "lars_reactor/rate_limiter.h"
+
+RateLimiter::Bucket RateLimiter::MakeBucket(int rate, int burst) {
+  Bucket bucket;
+  if (rate > 0) {
+    bucket.interval_ns_ = 1000000000UL / static_cast<uint64_t>(rate);
+    bucket.tolerance_ns_ =
+        bucket.interval_ns_ * static_cast<uint64_t>(burst > 1 ? burst - 1 : 0);
+  }
+  return bucket;
+}
+
+void RateLimiter::SetConnLimit(int rate, int burst) {
+  conn_limit_ = MakeBucket(rate, burst);
+}
+
+void RateLimiter::SetMsgLimit(int msg_id, int rate, int burst) {
+  if (rate <= 0) {
+    msg_buckets_.erase(msg_id);
+    return;
+  }
+  msg_buckets_[msg_id].limit_ = MakeBucket(rate, burst);
+}
+
+void RateLimiter::ResetConn(int fd) {
+  if (fd >= static_cast<int>(conn_tat_.size())) {
+    conn_tat_.resize(fd + 1);
+  }
+  conn_tat_[fd] = 0;
+}
+
+uint64_t RateLimiter::Admit(int fd, int msg_id, uint64_t now_ns) {
+  if (max_inflight_ > 0 && inflight_ >= max_inflight_) {
+    return RATE_INFLIGHT_RETRY_NS;
+  }
+  uint64_t* conn_tat = nullptr;
+  uint64_t wait = 0;
+  if (conn_limit_.interval_ns_ != 0) {
+    if (fd >= static_cast<int>(conn_tat_.size())) {
+      ResetConn(fd);
+    }
+    conn_tat = &conn_tat_[fd];
+    wait = Wait(conn_limit_, *conn_tat, now_ns);
+  }
+  MsgBucket* msg = nullptr;
+  if (!msg_buckets_.empty()) {
+    auto itr = msg_buckets_.find(msg_id);
+    if (itr != msg_buckets_.end()) {
+      msg = &itr->second;
+      uint64_t msg_wait = Wait(msg->limit_, msg->tat_, now_ns);
+      wait = msg_wait > wait ? msg_wait : wait;
+    }
+  }
+  if (wait > 0) {
+    return wait;
+  }
+  // 两个桶都允许才消耗令牌
+  if (conn_tat != nullptr) {
+    *conn_tat = Next(conn_limit_, *conn_tat, now_ns);
+  }
+  if (msg != nullptr) {
+    msg->tat_ = Next(msg->limit_, msg->tat_, now_ns);
+  }
+  return 0;
+}
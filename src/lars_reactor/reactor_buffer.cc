@@ -11,10 +11,21 @@ ReactorBuffer::~ReactorBuffer() {
 }
 
 int ReactorBuffer::Length() const {
+  if (ring_ != nullptr) {
+    return ring_->GetLength();
+  }
   return buffer_ != nullptr ? buffer_->GetLength() : 0;
 }
 
 void ReactorBuffer::Pop(int len) {
+  if (ring_ != nullptr) {
+    ring_->Pop(len);
+    return;
+  }
+  //空消息体的帧，头部移除后buffer可能已经归还
+  if (len == 0) {
+    return;
+  }
   assert(buffer_ != nullptr && len <= buffer_->GetLength());
   buffer_->Pop(len);
   //当此时_buf的可用长度已经为0
@@ -26,11 +37,35 @@ void ReactorBuffer::Pop(int len) {
 }
 
 void ReactorBuffer::Clear() {
+  if (ring_ != nullptr) {
+    ring_->Clear();
+  }
   if (buffer_ != nullptr) {
     BufferPool::instance().revert(buffer_);
     buffer_ = nullptr;
   }
 }
+bool ReactorBuffer::EnableRing(int size) {
+  if (Length() != 0) {
+    return false;
+  }
+  Clear();
+  std::unique_ptr<RingBuffer> ring(new RingBuffer(size));
+  if (!ring->Valid()) {
+    return false;
+  }
+  ring_ = std::move(ring);
+  return true;
+}
+
+bool ReactorBuffer::DisableRing() {
+  if (Length() != 0) {
+    return false;
+  }
+  ring_.reset();
+  return true;
+}
+
 int InputBuffer::ReadData(int fd) {
   //硬件有多少数据可以读
   int need_read;
@@ -41,6 +76,9 @@ int InputBuffer::ReadData(int fd) {
     std::cerr << "ioctl FIONREAD!\n";
     return -1;
   }
+  if (ring_ != nullptr) {
+    return ReadRing(fd, need_read);
+  }
   if (buffer_ == nullptr) {
     //如果io_buf为空,从内存池申请
     buffer_ = BufferPool::instance().AllocBuffer(need_read);
@@ -88,7 +126,77 @@ int InputBuffer::ReadData(int fd) {
   }
   return static_cast<int>(already_read);
 }
+int InputBuffer::ReadRing(int fd, int need_read) {
+  //环形缓冲区容量固定，读满为止，剩余的数据等下次EPOLLIN再读
+  int free = ring_->GetFree();
+  if (free == 0) {
+    std::cerr << "ring buffer is full!\n";
+    return -1;
+  }
+  int len = need_read == 0 || need_read > free ? free : need_read;
+  ssize_t already_read;
+  do {
+    already_read = read(fd, ring_->Tail(), len);
+  } while (already_read == -1 && errno == EINTR);
+  if (already_read > 0) {
+    ring_->Push(static_cast<int>(already_read));
+  }
+  return static_cast<int>(already_read);
+}
+
+int InputBuffer::ReadTls(TlsSession* tls) {
+  //openssl每次最多解出一个记录，读到没有数据为止，
+  //否则留在openssl中的数据不会再触发EPOLLIN
+  int total = 0;
+  while (true) {
+    if (ring_ != nullptr || !Reserve(TLS_RECORD_SIZE)) {
+      return -1;
+    }
+    int ret = tls->Read(buffer_->GetData() + buffer_->GetLength(),
+                        buffer_->GetCapacity() - buffer_->GetLength());
+    if (ret > 0) {
+      buffer_->SetLength(buffer_->GetLength() + ret);
+      total += ret;
+      continue;
+    }
+    if (total > 0 && ret != -1) {
+      //先处理已经读到的数据，对端关闭在下一次EPOLLIN处理
+      return total;
+    }
+    if (buffer_->GetLength() == 0) {
+      BufferPool::instance().revert(buffer_);
+      buffer_ = nullptr;
+    }
+    return ret;
+  }
+}
+
+bool InputBuffer::Reserve(int len) {
+  if (buffer_ == nullptr) {
+    buffer_ = BufferPool::instance().AllocBuffer(len);
+  } else if (buffer_->GetCapacity() - buffer_->GetLength() < len) {
+    assert(buffer_->GetHead() == 0);
+    auto new_buffer =
+        BufferPool::instance().AllocBuffer(len + buffer_->GetLength());
+    if (new_buffer == nullptr) {
+      std::cerr << "no idle buffer for alloc!\n";
+      return false;
+    }
+    new_buffer->Copy(buffer_);
+    BufferPool::instance().revert(buffer_);
+    buffer_ = new_buffer;
+  }
+  if (buffer_ == nullptr) {
+    std::cerr << "no idle buffer for alloc!\n";
+    return false;
+  }
+  return true;
+}
+
 char* InputBuffer::Data() const {
+  if (ring_ != nullptr) {
+    return ring_->Data();
+  }
   return buffer_ != nullptr ? buffer_->GetData() + buffer_->GetHead() : nullptr;
 }
 void InputBuffer::Adjust() {
@@ -98,12 +206,32 @@ void InputBuffer::Adjust() {
 }
 
 int OutputBuffer::SentData(const char* data, int len) {
+  char* dst = Append(len);
+  if (dst == nullptr) {
+    return -1;
+  }
+  //将data数据拷贝到io_buf中,拼接到后面
+  memcpy(dst, data, len);
+  return 0;
+}
+
+char* OutputBuffer::Append(int len) {
+  if (ring_ != nullptr) {
+    if (ring_->GetFree() < len) {
+      std::cerr << "ring buffer is full!\n";
+      return nullptr;
+    }
+    //环形缓冲区双重映射，尾部空间总是连续的
+    char* dst = ring_->Tail();
+    ring_->Push(len);
+    return dst;
+  }
   if (buffer_ == nullptr) {
     //如果io_buf为空,从内存池申请
     buffer_ = BufferPool::instance().AllocBuffer(len);
     if (buffer_ == nullptr) {
       std::cerr << "no idle buffer for alloc!\n";
-      return -1;
+      return nullptr;
     }
   } else {
     //如果io_buf可用，判断是否够存
@@ -112,9 +240,9 @@ int OutputBuffer::SentData(const char* data, int len) {
       //不够存，冲内存池申请
       auto new_buffer =
           BufferPool::instance().AllocBuffer(len + buffer_->GetLength());
-      if (buffer_ == nullptr) {
+      if (new_buffer == nullptr) {
         std::cerr << "no idle buffer for alloc!\n";
-        return -1;
+        return nullptr;
       }
       //将之前的_buf的数据考到新申请的buf中
       new_buffer->Copy(buffer_);
@@ -124,24 +252,38 @@ int OutputBuffer::SentData(const char* data, int len) {
       buffer_ = new_buffer;
     }
   }
-  //将data数据拷贝到io_buf中,拼接到后面
-  memcpy(buffer_->GetData() + buffer_->GetLength(), data, len);
+  char* dst = buffer_->GetData() + buffer_->GetLength();
   buffer_->SetLength(buffer_->GetLength() + len);
-  return 0;
+  return dst;
+}
+
+void OutputBuffer::Trim(int len) {
+  assert(len <= Length());
+  if (ring_ != nullptr) {
+    ring_->Unpush(len);
+    return;
+  }
+  buffer_->SetLength(buffer_->GetLength() - len);
 }
 
 int OutputBuffer::WriteFd(int fd) {
-  assert(buffer_ != nullptr && buffer_->GetHead() == 0);
+  return WriteFd(fd, Length());
+}
+
+int OutputBuffer::WriteFd(int fd, int len) {
+  assert(ring_ != nullptr || (buffer_ != nullptr && buffer_->GetHead() == 0));
+  assert(len <= Length());
   ssize_t already_write;
   do {
-    already_write = write(fd, buffer_->GetData(), buffer_->GetLength());
+    if (ring_ != nullptr) {
+      already_write = write(fd, ring_->Data(), len);
+    } else {
+      already_write = write(fd, buffer_->GetData(), len);
+    }
   } while (already_write == -1 &&
            errno == EINTR);  //systemCall引起的中断，继续写
   if (already_write > 0) {
-    //已经处理的数据清空
-    buffer_->Pop(static_cast<int>(already_write));
-    //未处理数据前置，覆盖老数据
-    buffer_->Adjust();
+    Consume(static_cast<int>(already_write));
   }
   //如果fd非阻塞，可能会得到EAGAIN错误
   if (already_write == -1 && errno == EAGAIN) {
@@ -150,3 +292,28 @@ int OutputBuffer::WriteFd(int fd) {
   }
   return static_cast<int>(already_write);
 }
+
+int OutputBuffer::WriteTls(TlsSession* tls, int len) {
+  assert(ring_ != nullptr || (buffer_ != nullptr && buffer_->GetHead() == 0));
+  assert(len <= Length());
+  const char* data = ring_ != nullptr ? ring_->Data() : buffer_->GetData();
+  int already_write = tls->Write(data, len);
+  if (already_write > 0) {
+    Consume(already_write);
+  }
+  return already_write;
+}
+
+void OutputBuffer::Consume(int len) {
+  if (ring_ != nullptr) {
+    //环形缓冲区只需要移动head
+    ring_->Pop(len);
+    return;
+  }
+  //已经处理的数据清空，全部写完时buffer归还内存池，空闲连接不占用buffer
+  Pop(len);
+  //未处理数据前置，覆盖老数据
+  if (buffer_ != nullptr) {
+    buffer_->Adjust();
+  }
+}
@@ -0,0 +1,61 @@
+#include "lars_reactor/ring_buffer.h"
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cassert>
+#include <iostream>
+
+RingBuffer::RingBuffer(int size)
+    : base_(nullptr), capacity_(0), head_(0), length_(0) {
+  long page = sysconf(_SC_PAGESIZE);
+  capacity_ = static_cast<int>((size + page - 1) / page * page);
+  int fd = memfd_create("lars_ring_buffer", MFD_CLOEXEC);
+  if (fd == -1) {
+    std::cerr << "memfd_create error!\n";
+    return;
+  }
+  if (ftruncate(fd, capacity_) == -1) {
+    std::cerr << "ftruncate ring buffer error!\n";
+    close(fd);
+    return;
+  }
+  // 先预留2倍大小的连续虚拟地址，再把同一个memfd映射到前后两半
+  void* area = mmap(nullptr, 2 * capacity_, PROT_NONE,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (area == MAP_FAILED) {
+    std::cerr << "mmap ring buffer error!\n";
+    close(fd);
+    return;
+  }
+  char* addr = static_cast<char*>(area);
+  if (mmap(addr, capacity_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED,
+           fd, 0) == MAP_FAILED ||
+      mmap(addr + capacity_, capacity_, PROT_READ | PROT_WRITE,
+           MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED) {
+    std::cerr << "mmap ring buffer mirror error!\n";
+    munmap(addr, 2 * capacity_);
+    close(fd);
+    return;
+  }
+  // 映射建立后fd就不再需要了
+  close(fd);
+  base_ = addr;
+}
+
+RingBuffer::~RingBuffer() {
+  if (base_ != nullptr) {
+    munmap(base_, 2 * capacity_);
+  }
+}
+
+void RingBuffer::Pop(int len) {
+  assert(len <= length_);
+  length_ -= len;
+  head_ = length_ == 0 ? 0 : (head_ + len) % capacity_;
+}
+
+void RingBuffer::Push(int len) {
+  assert(len <= GetFree());
+  length_ += len;
+}
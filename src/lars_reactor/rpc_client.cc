@@ -0,0 +1,208 @@
+#include "lars_reactor/rpc_client.h"
+
+#include <cstring>
+#include <iostream>
+#include <utility>
+
+#include "lars_reactor/message.h"
+
+//时间轮每格的时长(纳秒)
+#define RPC_WHEEL_TICK_NS (RPC_WHEEL_TICK_MS * 1000000UL)
+
+RpcClient::RpcClient(EventLoop* loop, NetConnection* conn, MsgRouter* router)
+    : loop_(loop),
+      conn_(conn),
+      handle_(conn->GetHandle()),
+      router_(router),
+      wheel_(RPC_WHEEL_SIZE, -1) {
+  tick_ = EventLoop::ClockNs() / RPC_WHEEL_TICK_NS;
+  if (router_->Register(RPC_RESPONSE_ID,
+                        [this](const char* data, int len, int msg_id,
+                               void* args, NetConnection* conn) {
+                          OnResponse(data, len);
+                        }) == -1) {
+    // 同一个路由上只能有一个RpcClient，否则响应无法匹配
+    std::cerr << "rpc client register response router error!\n";
+    router_ = nullptr;
+  }
+  if (handle_ != nullptr && handle_->Get() == nullptr) {
+    conn_ = nullptr;
+  } else if (handle_ != nullptr) {
+    close_id_ = handle_->AddCloseCallback([this]() {
+      conn_ = nullptr;
+      FailAll();
+    });
+  }
+}
+
+RpcClient::~RpcClient() {
+  if (timer_id_ != -1) {
+    loop_->CancelTimer(timer_id_);
+  }
+  if (handle_ != nullptr) {
+    handle_->RemoveCloseCallback(close_id_);
+  }
+  if (router_ != nullptr) {
+    router_->Unregister(RPC_RESPONSE_ID);
+  }
+}
+
+uint64_t RpcClient::Call(int msg_id, const char* data, int len,
+                         uint32_t timeout_ms, rpc_callback callback) {
+  if (len < 0 || len > MESSAGE_LENGTH_LIMIT - RPC_HEAD_LEN) {
+    std::cerr << "rpc request too long, len: " << len << std::endl;
+    return 0;
+  }
+  if (router_ == nullptr || conn_ == nullptr) {
+    return 0;
+  }
+  int slot = Alloc();
+  PendingCall& call = calls_[slot];
+  // 代数从1开始，请求id不会为0
+  uint64_t request_id =
+      (static_cast<uint64_t>(call.generation_) << 32) | static_cast<uint32_t>(slot);
+
+  auto fill = [&](MsgBuilder<RpcHeadSchema>& builder) {
+    builder.Set<kRpcRequestId>(request_id)
+        .Set<kRpcTimeout>(timeout_ms)
+        .Set<kRpcStatus>(RPC_OK);
+    if (len > 0) {
+      memcpy(builder.Tail(), data, len);
+    }
+  };
+  if (SendView<RpcHeadSchema>(conn_, msg_id, fill, len) == -1) {
+    Release(slot);
+    return 0;
+  }
+
+  call.callback_ = std::move(callback);
+  if (timeout_ms != 0) {
+    call.deadline_ns_ =
+        EventLoop::ClockNs() + static_cast<uint64_t>(timeout_ms) * 1000000;
+    Link(slot, static_cast<int>((call.deadline_ns_ / RPC_WHEEL_TICK_NS) &
+                                (RPC_WHEEL_SIZE - 1)));
+    if (timed_num_++ == 0 && timer_id_ == -1) {
+      timer_id_ = loop_->RunEvery(RPC_WHEEL_TICK_MS, [this]() { OnTick(); });
+    }
+  }
+  return request_id;
+}
+
+void RpcClient::OnResponse(const char* data, int len) {
+  if (len < RPC_HEAD_LEN) {
+    std::cerr << "rpc response too short, len: " << len << std::endl;
+    return;
+  }
+  MsgView<RpcHeadSchema> head(data, len);
+  uint64_t request_id = head.Get<kRpcRequestId>();
+  uint32_t slot = static_cast<uint32_t>(request_id);
+  uint32_t generation = static_cast<uint32_t>(request_id >> 32);
+  if (slot >= calls_.size() || !calls_[slot].used_ ||
+      calls_[slot].generation_ != generation) {
+    // 已经超时或者取消的调用，响应直接丢弃
+    return;
+  }
+  rpc_callback callback = Release(static_cast<int>(slot));
+  callback(static_cast<int>(head.Get<kRpcStatus>()), head.Tail(),
+           head.TailLength());
+}
+
+void RpcClient::OnTick() {
+  uint64_t now = EventLoop::ClockNs();
+  uint64_t now_tick = now / RPC_WHEEL_TICK_NS;
+  // 最多转一圈，当前格下次还要再检查一遍
+  uint64_t begin = tick_;
+  if (now_tick - begin >= RPC_WHEEL_SIZE) {
+    begin = now_tick - RPC_WHEEL_SIZE + 1;
+  }
+  std::vector<rpc_callback> expired;
+  for (uint64_t t = begin; t <= now_tick; ++t) {
+    int slot = wheel_[t & (RPC_WHEEL_SIZE - 1)];
+    while (slot != -1) {
+      int next = calls_[slot].next_;
+      // 超过一圈的调用留在格中等下一圈
+      if (calls_[slot].deadline_ns_ <= now) {
+        expired.push_back(Release(slot));
+      }
+      slot = next;
+    }
+  }
+  tick_ = now_tick;
+  if (timed_num_ == 0) {
+    loop_->CancelTimer(timer_id_);
+    timer_id_ = -1;
+  }
+  // 回调中可能发起新的调用，最后统一执行
+  for (auto& callback : expired) {
+    callback(RPC_TIMEOUT, nullptr, 0);
+  }
+}
+
+void RpcClient::FailAll() {
+  std::vector<rpc_callback> failed;
+  for (size_t slot = 0; slot < calls_.size(); ++slot) {
+    if (calls_[slot].used_) {
+      failed.push_back(Release(static_cast<int>(slot)));
+    }
+  }
+  for (auto& callback : failed) {
+    callback(RPC_CLOSED, nullptr, 0);
+  }
+}
+
+int RpcClient::Alloc() {
+  int slot;
+  if (!free_slots_.empty()) {
+    slot = free_slots_.back();
+    free_slots_.pop_back();
+  } else {
+    slot = static_cast<int>(calls_.size());
+    calls_.emplace_back();
+  }
+  PendingCall& call = calls_[slot];
+  if (++call.generation_ == 0) {
+    call.generation_ = 1;
+  }
+  call.used_ = true;
+  call.deadline_ns_ = 0;
+  ++pending_num_;
+  return slot;
+}
+
+rpc_callback RpcClient::Release(int slot) {
+  PendingCall& call = calls_[slot];
+  if (call.bucket_ != -1) {
+    Unlink(slot);
+    --timed_num_;
+  }
+  rpc_callback callback = std::move(call.callback_);
+  call.callback_ = nullptr;
+  call.used_ = false;
+  free_slots_.push_back(slot);
+  --pending_num_;
+  return callback;
+}
+
+void RpcClient::Link(int slot, int bucket) {
+  PendingCall& call = calls_[slot];
+  call.bucket_ = bucket;
+  call.prev_ = -1;
+  call.next_ = wheel_[bucket];
+  if (call.next_ != -1) {
+    calls_[call.next_].prev_ = slot;
+  }
+  wheel_[bucket] = slot;
+}
+
+void RpcClient::Unlink(int slot) {
+  PendingCall& call = calls_[slot];
+  if (call.prev_ != -1) {
+    calls_[call.prev_].next_ = call.next_;
+  } else {
+    wheel_[call.bucket_] = call.next_;
+  }
+  if (call.next_ != -1) {
+    calls_[call.next_].prev_ = call.prev_;
+  }
+  call.prev_ = call.next_ = call.bucket_ = -1;
+}
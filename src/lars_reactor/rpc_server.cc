@@ -0,0 +1,92 @@
+#include "lars_reactor/rpc_server.h"
+
+#include <cstring>
+#include <iostream>
+#include <utility>
+
+#include "lars_reactor/message.h"
+
+RpcContext::RpcContext(const RpcContext& other)
+    : conn_(nullptr),
+      request_id_(other.request_id_),
+      deadline_ns_(other.deadline_ns_) {
+  // 拷贝发生在处理回调中(连接一定还在)或者从另一个拷贝而来，
+  // 只有需要保存上下文时才创建连接的弱引用
+  handle_ = other.handle_ != nullptr || other.conn_ == nullptr
+                ? other.handle_
+                : other.conn_->GetHandle();
+}
+
+RpcContext& RpcContext::operator=(const RpcContext& other) {
+  if (this != &other) {
+    RpcContext copy(other);
+    conn_ = nullptr;
+    handle_ = std::move(copy.handle_);
+    request_id_ = copy.request_id_;
+    deadline_ns_ = copy.deadline_ns_;
+  }
+  return *this;
+}
+
+int RpcContext::Reply(const char* data, int len) const {
+  NetConnection* conn = GetConn();
+  if (conn == nullptr) {
+    // 连接已经关闭，或者连接不支持延迟回复
+    return -1;
+  }
+  return RpcServer::SendResponse(conn, request_id_, RPC_OK, data, len);
+}
+
+RpcServer::RpcServer(EventLoop* loop, MsgRouter* router)
+    : loop_(loop), router_(router) {}
+
+int RpcServer::Register(int msg_id, rpc_handler handler) {
+  return router_->Register(
+      msg_id, [this, handler](const char* data, int len, int msg_id,
+                              void* args, NetConnection* conn) {
+        OnRequest(data, len, conn, handler);
+      });
+}
+
+void RpcServer::OnRequest(const char* data, int len, NetConnection* conn,
+                          const rpc_handler& handler) {
+  if (len < RPC_HEAD_LEN) {
+    std::cerr << "rpc request too short, len: " << len << std::endl;
+    return;
+  }
+  MsgView<RpcHeadSchema> head(data, len);
+  uint32_t timeout_ms = head.Get<kRpcTimeout>();
+  uint64_t deadline_ns = 0;
+  if (timeout_ms != 0) {
+    // 以读到请求的那一轮事件循环为起点，同一轮中排在后面的请求可能已经超时
+    deadline_ns = loop_->GetNowNs() +
+                  static_cast<uint64_t>(timeout_ms) * 1000000;
+    if (EventLoop::ClockNs() > deadline_ns) {
+      // 客户端已经放弃了这个请求，处理也是浪费
+      ++expired_;
+      return;
+    }
+  }
+  handler(data + RPC_HEAD_LEN, len - RPC_HEAD_LEN,
+          RpcContext(conn, head.Get<kRpcRequestId>(), deadline_ns));
+}
+
+int RpcServer::SendResponse(NetConnection* conn, uint64_t request_id,
+                            uint32_t status, const char* data, int len) {
+  if (len < 0 || len > MESSAGE_LENGTH_LIMIT - RPC_HEAD_LEN) {
+    std::cerr << "rpc response too long, len: " << len << std::endl;
+    return -1;
+  }
+  // 扩展头和响应直接编码到连接的输出缓冲区
+  return SendView<RpcHeadSchema>(
+      conn, RPC_RESPONSE_ID,
+      [&](MsgBuilder<RpcHeadSchema>& builder) {
+        builder.Set<kRpcRequestId>(request_id)
+            .Set<kRpcTimeout>(0)
+            .Set<kRpcStatus>(status);
+        if (len > 0) {
+          memcpy(builder.Tail(), data, len);
+        }
+      },
+      len);
+}
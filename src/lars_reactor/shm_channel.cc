@@ -0,0 +1,447 @@
+#include "lars_reactor/shm_channel.h"
+
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <iostream>
+
+#include "lars_reactor/message.h"
+
+//控制头页的大小，两个方向的控制头各占一半
+#define SHM_HEADER_PAGE 4096
+
+// doorbell的读事件回调
+auto shm_read_callback = [](EventLoop* loop, int fd, void* args) {
+  auto channel = static_cast<ShmChannel*>(args);
+  channel->DoRead();
+};
+// unix socket的accept回调
+auto shm_accept_callback = [](EventLoop* loop, int fd, void* args) {
+  auto server = static_cast<ShmServer*>(args);
+  server->DoAccept();
+};
+// 客户端unix socket可读(关闭)的回调
+auto shm_close_callback = [](EventLoop* loop, int fd, void* args) {
+  auto server = static_cast<ShmServer*>(args);
+  server->DoClose(fd);
+};
+
+ShmChannel::ShmChannel(EventLoop* loop, MsgRouter* router)
+    : loop_(loop), router_(router) {}
+
+ShmChannel::~ShmChannel() {
+  if (handle_ != nullptr) {
+    handle_->Close();
+  }
+  if (recv_efd_ != -1) {
+    if (!closed_) {
+      loop_->DelIoEvent(recv_efd_);
+    }
+    close(recv_efd_);
+  }
+  if (send_efd_ != -1) {
+    close(send_efd_);
+  }
+  if (recv_data_ != nullptr) {
+    munmap(recv_data_, 2 * ring_size_);
+  }
+  if (send_data_ != nullptr) {
+    munmap(send_data_, 2 * ring_size_);
+  }
+  if (header_page_ != nullptr) {
+    munmap(header_page_, SHM_HEADER_PAGE);
+  }
+  if (memfd_ != -1) {
+    close(memfd_);
+  }
+  if (unix_fd_ != -1 && own_unix_fd_) {
+    close(unix_fd_);
+  }
+}
+
+char* ShmChannel::MapRing(int memfd, off_t offset) {
+  // 先预留2倍大小的连续虚拟地址，再把同一段数据映射到前后两半
+  void* area = mmap(nullptr, 2 * ring_size_, PROT_NONE,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (area == MAP_FAILED) {
+    return nullptr;
+  }
+  char* addr = static_cast<char*>(area);
+  if (mmap(addr, ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED,
+           memfd, offset) == MAP_FAILED ||
+      mmap(addr + ring_size_, ring_size_, PROT_READ | PROT_WRITE,
+           MAP_SHARED | MAP_FIXED, memfd, offset) == MAP_FAILED) {
+    munmap(addr, 2 * ring_size_);
+    return nullptr;
+  }
+  return addr;
+}
+
+int ShmChannel::Map(int memfd, int ring_size, bool server) {
+  memfd_ = memfd;
+  ring_size_ = ring_size;
+  // memfd布局: 控制头页 | 客户端->服务端环 | 服务端->客户端环
+  header_page_ = mmap(nullptr, SHM_HEADER_PAGE, PROT_READ | PROT_WRITE,
+                      MAP_SHARED, memfd, 0);
+  if (header_page_ == MAP_FAILED) {
+    header_page_ = nullptr;
+    std::cerr << "mmap shm header error!\n";
+    return -1;
+  }
+  auto c2s = static_cast<ShmRingHeader*>(header_page_);
+  auto s2c = reinterpret_cast<ShmRingHeader*>(static_cast<char*>(header_page_) +
+                                              SHM_HEADER_PAGE / 2);
+  char* c2s_data = MapRing(memfd, SHM_HEADER_PAGE);
+  char* s2c_data = MapRing(memfd, SHM_HEADER_PAGE + ring_size);
+  if (c2s_data == nullptr || s2c_data == nullptr) {
+    std::cerr << "mmap shm ring error!\n";
+    if (c2s_data != nullptr) {
+      munmap(c2s_data, 2 * ring_size_);
+    }
+    if (s2c_data != nullptr) {
+      munmap(s2c_data, 2 * ring_size_);
+    }
+    return -1;
+  }
+  recv_header_ = server ? c2s : s2c;
+  send_header_ = server ? s2c : c2s;
+  recv_data_ = server ? c2s_data : s2c_data;
+  send_data_ = server ? s2c_data : c2s_data;
+  return 0;
+}
+
+void ShmChannel::Register() {
+  loop_->AddIoEvent(recv_efd_, shm_read_callback, EPOLLIN, this);
+}
+
+std::unique_ptr<ShmChannel> ShmChannel::Create(EventLoop* loop,
+                                               MsgRouter* router,
+                                               int ring_size) {
+  if (ring_size < SHM_RING_MIN_SIZE || ring_size > SHM_RING_MAX_SIZE) {
+    std::cerr << "shm ring size " << ring_size << " out of range error!\n";
+    return nullptr;
+  }
+  long page = sysconf(_SC_PAGESIZE);
+  ring_size = static_cast<int>((ring_size + page - 1) / page * page);
+  std::unique_ptr<ShmChannel> channel(new ShmChannel(loop, router));
+  int memfd = memfd_create("lars_shm_channel", MFD_CLOEXEC);
+  if (memfd == -1 || ftruncate(memfd, SHM_HEADER_PAGE + 2L * ring_size) == -1) {
+    std::cerr << "create shm channel memfd error!\n";
+    if (memfd != -1) {
+      close(memfd);
+    }
+    return nullptr;
+  }
+  if (channel->Map(memfd, ring_size, true) == -1) {
+    return nullptr;
+  }
+  // 新的memfd内容为0，两个消费者初始都处于等待状态
+  channel->recv_header_->waiting_.store(1);
+  channel->send_header_->waiting_.store(1);
+  channel->recv_efd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  channel->send_efd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (channel->recv_efd_ == -1 || channel->send_efd_ == -1) {
+    std::cerr << "create shm channel eventfd error!\n";
+    return nullptr;
+  }
+  channel->Register();
+  return channel;
+}
+
+int ShmChannel::SendFds(int unix_fd) const {
+  // fd顺序: memfd, 客户端->服务端doorbell, 服务端->客户端doorbell
+  int fds[3] = {memfd_, recv_efd_, send_efd_};
+  char control[CMSG_SPACE(sizeof(fds))];
+  memset(control, 0, sizeof(control));
+  int ring_size = ring_size_;
+  struct iovec iov {};
+  iov.iov_base = &ring_size;
+  iov.iov_len = sizeof(ring_size);
+  struct msghdr msg {};
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+  struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+  memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+  if (sendmsg(unix_fd, &msg, MSG_NOSIGNAL) == -1) {
+    std::cerr << "send shm channel fds error!\n";
+    return -1;
+  }
+  return 0;
+}
+
+std::unique_ptr<ShmChannel> ShmChannel::RecvFds(int unix_fd, EventLoop* loop,
+                                                MsgRouter* router) {
+  int fds[3];
+  char control[CMSG_SPACE(sizeof(fds))];
+  int ring_size = 0;
+  struct iovec iov {};
+  iov.iov_base = &ring_size;
+  iov.iov_len = sizeof(ring_size);
+  struct msghdr msg {};
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+  ssize_t ret;
+  do {
+    ret = recvmsg(unix_fd, &msg, MSG_CMSG_CLOEXEC);
+  } while (ret == -1 && errno == EINTR);
+  struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+  if (ret != sizeof(ring_size) || cmsg == nullptr ||
+      cmsg->cmsg_type != SCM_RIGHTS ||
+      cmsg->cmsg_len != CMSG_LEN(sizeof(fds))) {
+    std::cerr << "recv shm channel fds error!\n";
+    close(unix_fd);
+    return nullptr;
+  }
+  memcpy(fds, CMSG_DATA(cmsg), sizeof(fds));
+  // 环大小来自对端，映射之前确认它和memfd的实际大小一致
+  long page = sysconf(_SC_PAGESIZE);
+  struct stat st {};
+  if (ring_size < SHM_RING_MIN_SIZE || ring_size > SHM_RING_MAX_SIZE ||
+      ring_size % page != 0 || fstat(fds[0], &st) == -1 ||
+      st.st_size < SHM_HEADER_PAGE + 2L * ring_size) {
+    std::cerr << "shm channel ring size " << ring_size << " error!\n";
+    for (int fd : fds) {
+      close(fd);
+    }
+    close(unix_fd);
+    return nullptr;
+  }
+  std::unique_ptr<ShmChannel> channel(new ShmChannel(loop, router));
+  channel->unix_fd_ = unix_fd;
+  channel->own_unix_fd_ = true;
+  // 客户端方向与服务端相反
+  channel->send_efd_ = fds[1];
+  channel->recv_efd_ = fds[2];
+  if (channel->Map(fds[0], ring_size, false) == -1) {
+    return nullptr;
+  }
+  channel->Register();
+  return channel;
+}
+
+std::unique_ptr<ShmChannel> ShmChannel::Connect(const std::string& path,
+                                                EventLoop* loop,
+                                                MsgRouter* router) {
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd == -1) {
+    std::cerr << "ShmChannel::socket()\n";
+    return nullptr;
+  }
+  struct sockaddr_un addr {};
+  addr.sun_family = AF_UNIX;
+  strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+  if (connect(fd, reinterpret_cast<const struct sockaddr*>(&addr),
+              sizeof(addr)) == -1) {
+    std::cerr << "connect shm server " << path << " error!\n";
+    close(fd);
+    return nullptr;
+  }
+  return RecvFds(fd, loop, router);
+}
+
+int ShmChannel::SendMessage(const char* data, int msg_len, int msg_id) {
+  if (msg_len < 0 || msg_len > MESSAGE_LENGTH_LIMIT) {
+    std::cerr << "shm message too long, msg_len: " << msg_len << std::endl;
+    return -1;
+  }
+  if (closed_) {
+    return -1;
+  }
+  uint64_t tail = send_header_->tail_.load(std::memory_order_relaxed);
+  uint64_t head = send_header_->head_.load(std::memory_order_acquire);
+  // head由对端写入，不可信，和DoRead一样校验
+  if (tail - head > static_cast<uint64_t>(ring_size_)) {
+    std::cerr << "shm ring position error, need close, head: " << head
+              << " tail: " << tail << std::endl;
+    Close();
+    return -1;
+  }
+  uint64_t need = MESSAGE_HEAD_LEN + msg_len;
+  if (ring_size_ - (tail - head) < need) {
+    // 环满，由调用方决定重试还是丢弃
+    return -1;
+  }
+  // 环数据双重映射，跨越环尾的写入也是连续的
+  char* pos = send_data_ + tail % ring_size_;
+  MsgHead msg_head{msg_id, msg_len};
+  memcpy(pos, &msg_head, MESSAGE_HEAD_LEN);
+  memcpy(pos + MESSAGE_HEAD_LEN, data, msg_len);
+  send_header_->tail_.store(tail + need, std::memory_order_release);
+  // 发布数据之后再检查消费者是否在等待，只有第一个生产者敲doorbell
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (send_header_->waiting_.load(std::memory_order_relaxed) != 0 &&
+      send_header_->waiting_.exchange(0) != 0) {
+    uint64_t one = 1;
+    ssize_t ret = write(send_efd_, &one, sizeof(one));
+    (void)ret;
+    ++doorbells_;
+  }
+  return 0;
+}
+
+void ShmChannel::DoRead() {
+  if (closed_) {
+    return;
+  }
+  uint64_t count;
+  ssize_t ret = read(recv_efd_, &count, sizeof(count));
+  (void)ret;
+  while (true) {
+    // 处理期间waiting_为0，生产者不会敲doorbell
+    uint64_t head = recv_header_->head_.load(std::memory_order_relaxed);
+    uint64_t tail = recv_header_->tail_.load(std::memory_order_acquire);
+    // 共享内存中的数据不可信，位置和长度都要校验后才能使用
+    if (tail - head > static_cast<uint64_t>(ring_size_)) {
+      std::cerr << "shm ring position error, need close, head: " << head
+                << " tail: " << tail << std::endl;
+      Close();
+      return;
+    }
+    while (head != tail) {
+      const char* pos = recv_data_ + head % ring_size_;
+      MsgHead msg_head{};
+      memcpy(&msg_head, pos, MESSAGE_HEAD_LEN);
+      if (tail - head < MESSAGE_HEAD_LEN || msg_head.msg_len_ < 0 ||
+          msg_head.msg_len_ > MESSAGE_LENGTH_LIMIT ||
+          MESSAGE_HEAD_LEN + static_cast<uint64_t>(msg_head.msg_len_) >
+              tail - head) {
+        std::cerr << "shm message format error, need close, msg_id: "
+                  << msg_head.msg_id_ << " msg_len: " << msg_head.msg_len_
+                  << std::endl;
+        Close();
+        return;
+      }
+      if (!router_->Call(msg_head.msg_id_, msg_head.msg_len_,
+                         pos + MESSAGE_HEAD_LEN, this)) {
+        if (unrouted_++ == 0) {
+          std::cerr << "shm message has no router, msg_id: "
+                    << msg_head.msg_id_ << std::endl;
+        }
+      }
+      if (closed_) {
+        // 回调中关闭了通道
+        return;
+      }
+      head += MESSAGE_HEAD_LEN + msg_head.msg_len_;
+      recv_header_->head_.store(head, std::memory_order_release);
+    }
+    // 即将休眠，设置等待标记后再检查一次，避免丢失唤醒
+    recv_header_->waiting_.store(1);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (recv_header_->tail_.load(std::memory_order_acquire) == head) {
+      break;
+    }
+    recv_header_->waiting_.store(0);
+  }
+}
+
+std::shared_ptr<ConnHandle> ShmChannel::GetHandle() {
+  if (closed_) {
+    return std::make_shared<ConnHandle>(nullptr);
+  }
+  if (handle_ == nullptr) {
+    handle_ = std::make_shared<ConnHandle>(this);
+  }
+  return handle_;
+}
+
+void ShmChannel::Close() {
+  if (closed_) {
+    return;
+  }
+  closed_ = true;
+  loop_->DelIoEvent(recv_efd_);
+  if (handle_ != nullptr) {
+    std::shared_ptr<ConnHandle> handle = std::move(handle_);
+    handle->Close();
+  }
+  // 对端读到EOF；服务端的unix socket由ShmServer::DoClose关闭并释放通道
+  if (unix_fd_ != -1) {
+    shutdown(unix_fd_, SHUT_RDWR);
+  }
+}
+
+ShmServer::ShmServer(EventLoop* loop, const std::string& path, int ring_size)
+    : path_(path), loop_(loop), ring_size_(ring_size) {
+  if (ring_size_ < SHM_RING_MIN_SIZE || ring_size_ > SHM_RING_MAX_SIZE) {
+    std::cerr << "shm ring size " << ring_size_ << " out of range error!\n";
+    exit(1);
+  }
+  sockfd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (sockfd_ == -1) {
+    std::cerr << "ShmServer::socket()\n";
+    exit(1);
+  }
+  struct sockaddr_un addr {};
+  addr.sun_family = AF_UNIX;
+  strncpy(addr.sun_path, path_.c_str(), sizeof(addr.sun_path) - 1);
+  unlink(path_.c_str());
+  if (bind(sockfd_, reinterpret_cast<const struct sockaddr*>(&addr),
+           sizeof(addr)) < 0) {
+    std::cerr << "bind " << path_ << " error\n";
+    exit(1);
+  }
+  if (listen(sockfd_, 500) == -1) {
+    std::cerr << "listen error\n";
+    exit(1);
+  }
+  loop_->AddIoEvent(sockfd_, shm_accept_callback, EPOLLIN, this);
+}
+
+ShmServer::~ShmServer() {
+  for (auto& channel : channels_) {
+    loop_->DelIoEvent(channel.first);
+    close(channel.first);
+  }
+  channels_.clear();
+  loop_->DelIoEvent(sockfd_);
+  close(sockfd_);
+  unlink(path_.c_str());
+}
+
+void ShmServer::DoAccept() {
+  int connfd = accept4(sockfd_, nullptr, nullptr, SOCK_CLOEXEC);
+  if (connfd == -1) {
+    std::cerr << "accept shm client error\n";
+    return;
+  }
+  std::unique_ptr<ShmChannel> channel =
+      ShmChannel::Create(loop_, &router_, ring_size_);
+  if (channel == nullptr || channel->SendFds(connfd) == -1) {
+    close(connfd);
+    return;
+  }
+  // 客户端退出或通道关闭时unix socket可读(读到0)
+  channel->unix_fd_ = connfd;
+  loop_->AddIoEvent(connfd, shm_close_callback, EPOLLIN, this);
+  channels_[connfd] = std::move(channel);
+}
+
+void ShmServer::DoClose(int fd) {
+  char buf[64];
+  ssize_t ret = read(fd, buf, sizeof(buf));
+  if (ret > 0 || (ret == -1 && errno == EAGAIN)) {
+    return;
+  }
+  loop_->DelIoEvent(fd);
+  close(fd);
+  // 通道可能正在自己的回调中，延迟到本轮事件处理完之后再释放
+  auto itr = channels_.find(fd);
+  if (itr != channels_.end()) {
+    std::shared_ptr<ShmChannel> channel(std::move(itr->second));
+    channels_.erase(itr);
+    loop_->AddTask([channel]() {});
+  }
+}
@@ -0,0 +1,57 @@
+#include "lars_reactor/slab_pool.h"
+
+#include <new>
+
+//slab的分级数
+#define SLAB_CLASSES (SLAB_MAX_SIZE / SLAB_ALIGN)
+
+namespace {
+
+// 空闲对象链表，复用对象本身的内存保存next
+struct SlabNode {
+  SlabNode* next_;
+};
+
+// 每个分级的空闲链表和正在切分的chunk
+struct SlabClass {
+  SlabNode* free_ = nullptr;
+  char* chunk_ = nullptr;
+  size_t remain_ = 0;
+};
+
+thread_local SlabClass slab_classes[SLAB_CLASSES];
+
+}  // namespace
+
+void* SlabPool::Alloc(size_t size) {
+  if (size == 0 || size > SLAB_MAX_SIZE) {
+    return ::operator new(size);
+  }
+  size_t index = (size - 1) / SLAB_ALIGN;
+  size_t slot = (index + 1) * SLAB_ALIGN;
+  SlabClass& cls = slab_classes[index];
+  if (cls.free_ != nullptr) {
+    SlabNode* node = cls.free_;
+    cls.free_ = node->next_;
+    return node;
+  }
+  if (cls.remain_ < slot) {
+    cls.chunk_ = static_cast<char*>(::operator new(SLAB_CHUNK_SIZE));
+    cls.remain_ = SLAB_CHUNK_SIZE;
+  }
+  void* ptr = cls.chunk_;
+  cls.chunk_ += slot;
+  cls.remain_ -= slot;
+  return ptr;
+}
+
+void SlabPool::Free(void* ptr, size_t size) {
+  if (size == 0 || size > SLAB_MAX_SIZE) {
+    ::operator delete(ptr);
+    return;
+  }
+  SlabClass& cls = slab_classes[(size - 1) / SLAB_ALIGN];
+  SlabNode* node = static_cast<SlabNode*>(ptr);
+  node->next_ = cls.free_;
+  cls.free_ = node;
+}
@@ -0,0 +1,142 @@
+#include "lars_reactor/tcp_client.h"
+
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+
+#include "lars_reactor/tcp_conn.h"
+
+TcpClient::TcpClient(EventLoop* loop, const char* ip, uint16_t port)
+    : loop_(loop) {
+  // 服务端关闭后再次write会产生SIGPIPE
+  if (signal(SIGPIPE, SIG_IGN) == SIG_ERR) {
+    std::cerr << "signal ignore SIGPIPE\n";
+  }
+  bzero(&server_addr_, sizeof(server_addr_));
+  server_addr_.sin_family = AF_INET;
+  inet_aton(ip, &server_addr_.sin_addr);
+  server_addr_.sin_port = htons(port);
+}
+
+// 非阻塞连接的可写事件回调
+auto client_connect_callback = [](EventLoop* loop, int fd, void* args) {
+  auto client = static_cast<TcpClient*>(args);
+  client->DoConnect();
+};
+
+TcpClient::~TcpClient() {
+  if (connect_fd_ != -1) {
+    loop_->DelIoEvent(connect_fd_);
+    close(connect_fd_);
+  }
+  if (conn_ != nullptr) {
+    conn_->CleanConn();
+  }
+}
+
+int TcpClient::Connect() {
+  if (IsConnected()) {
+    return 0;
+  }
+  if (IsConnecting()) {
+    return 1;
+  }
+  if (EventLoop::ClockNs() < retry_at_ns_) {
+    return -1;
+  }
+  int sockfd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                      IPPROTO_TCP);
+  if (sockfd == -1) {
+    std::cerr << "TcpClient::socket()\n";
+    return -1;
+  }
+  // 非阻塞连接，服务端不可用时不阻塞事件循环
+  if (connect(sockfd, reinterpret_cast<const struct sockaddr*>(&server_addr_),
+              sizeof(server_addr_)) == 0) {
+    return OnConnected(sockfd);
+  }
+  if (errno != EINPROGRESS) {
+    std::cerr << "connect " << inet_ntoa(server_addr_.sin_addr) << ":"
+              << ntohs(server_addr_.sin_port) << " error!\n";
+    close(sockfd);
+    OnConnectFailed();
+    return -1;
+  }
+  connect_fd_ = sockfd;
+  loop_->AddIoEvent(sockfd, client_connect_callback, EPOLLOUT, this);
+  return 1;
+}
+
+void TcpClient::DoConnect() {
+  int sockfd = connect_fd_;
+  connect_fd_ = -1;
+  loop_->DelIoEvent(sockfd);
+  int err = 0;
+  socklen_t len = sizeof(err);
+  if (getsockopt(sockfd, SOL_SOCKET, SO_ERROR, &err, &len) == -1 || err != 0) {
+    std::cerr << "connect " << inet_ntoa(server_addr_.sin_addr) << ":"
+              << ntohs(server_addr_.sin_port) << " error!\n";
+    close(sockfd);
+    OnConnectFailed();
+    return;
+  }
+  OnConnected(sockfd);
+}
+
+int TcpClient::OnConnected(int sockfd) {
+  retry_ms_ = 0;
+  retry_at_ns_ = 0;
+  conn_ = std::make_shared<TcpConn>(sockfd, loop_);
+  conn_->SetRouter(&router_);
+  if (tls_ctx_ != nullptr &&
+      !conn_->EnableTls(tls_ctx_, false,
+                        tls_host_.empty() ? inet_ntoa(server_addr_.sin_addr)
+                                          : tls_host_)) {
+    conn_->CleanConn();
+    OnConnectFailed();
+    return -1;
+  }
+  if (compress_threshold_ > 0) {
+    conn_->EnableCompression(compress_threshold_);
+  }
+  for (const auto& msg : pending_) {
+    conn_->SendMessage(msg.second.data(), static_cast<int>(msg.second.size()),
+                       msg.first);
+  }
+  pending_.clear();
+  pending_bytes_ = 0;
+  return 0;
+}
+
+void TcpClient::OnConnectFailed() {
+  pending_.clear();
+  pending_bytes_ = 0;
+  retry_ms_ = retry_ms_ == 0 ? CLIENT_RETRY_MIN_MS
+                             : std::min(retry_ms_ * 2, CLIENT_RETRY_MAX_MS);
+  retry_at_ns_ = EventLoop::ClockNs() + retry_ms_ * 1000000UL;
+}
+
+bool TcpClient::IsConnected() const {
+  return conn_ != nullptr && conn_->GetFd() != -1;
+}
+
+int TcpClient::SendMessage(const char* data, int msg_len, int msg_id) {
+  if (IsConnecting()) {
+    if (msg_len < 0 || pending_bytes_ + msg_len > CLIENT_PENDING_LIMIT) {
+      return -1;
+    }
+    pending_.emplace_back(msg_id, std::string(data, msg_len));
+    pending_bytes_ += msg_len;
+    return 0;
+  }
+  if (!IsConnected()) {
+    return -1;
+  }
+  return conn_->SendMessage(data, msg_len, msg_id);
+}
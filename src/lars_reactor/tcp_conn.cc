@@ -3,13 +3,27 @@
 #include <fcntl.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
+#include <sys/sendfile.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
+#include <algorithm>
 #include <csignal>
 #include <iostream>
 
+#include "lars_reactor/lz_codec.h"
 #include "lars_reactor/message.h"
-// 回显业务
+#include "lars_reactor/schema.h"
+#include "lars_reactor/tcp_server.h"
+#include "lars_reactor/trace.h"
+
+std::atomic<int64_t> TcpConn::large_global_limit_(LARGE_MESSAGE_GLOBAL_LIMIT);
+std::atomic<int64_t> TcpConn::large_in_use_(0);
+
+static_assert(sizeof(TcpConn) <= TCP_CONN_MAX_SIZE,
+              "idle TcpConn should stay compact");
+// 回显业务，未注册路由的消息默认回显
 auto callback_busi = [](const char* data, int len, int msg_id, void* args,
                         TcpConn* conn) {
   conn->SendMessage(data, len, msg_id);
@@ -24,24 +38,102 @@ auto conn_write_callback = [](EventLoop* loop, int fd, void* args) {
   auto conn = static_cast<TcpConn*>(args);
   conn->DoWrite();
 };
+// 发送文件时数据源的读事件回调
+auto conn_source_callback = [](EventLoop* loop, int fd, void* args) {
+  auto conn = static_cast<TcpConn*>(args);
+  conn->ResumeWrite();
+};
 
-TcpConn::TcpConn(int connfd, EventLoop* loop) {
+TcpConn::TcpConn(int connfd, EventLoop* loop, TcpServer* server) {
   connfd_ = connfd;
   loop_ = loop;
+  server_ = server;
+  router_ = server != nullptr ? &server->GetRouter() : nullptr;
   // 1. 将connfd设置成非阻塞状态
   int flag = fcntl(connfd_, F_GETFL, 0);
   fcntl(connfd_, F_SETFL, O_NONBLOCK | flag);
   // 2. 设置TCP_NODELAY禁止做读写缓存，降低小包延迟
   int op = 1;
   setsockopt(connfd_, IPPROTO_TCP, TCP_NODELAY, &op, sizeof(op));
-  // 3. 将该链接的读事件让event_loop监控
+  // 3. 如果event_loop开启了busy-poll，让内核在该socket上也做忙轮询；
+  //    同一server下设置失败一次(通常是缺少CAP_NET_ADMIN)之后不再尝试，只报一次错
+  int busy_poll_us = loop_->GetBusyPoll();
+  if (busy_poll_us > 0 && (server_ == nullptr || server_->BusyPollUsable())) {
+    int ret = setsockopt(connfd_, SOL_SOCKET, SO_BUSY_POLL, &busy_poll_us,
+                         sizeof(busy_poll_us));
+#ifdef SO_PREFER_BUSY_POLL
+    if (ret == 0) {
+      ret = setsockopt(connfd_, SOL_SOCKET, SO_PREFER_BUSY_POLL, &op,
+                       sizeof(op));
+    }
+#endif
+    if (ret == -1) {
+      std::cerr << "setsockopt SO_BUSY_POLL error!\n";
+      if (server_ != nullptr) {
+        server_->DisableBusyPoll();
+      }
+    }
+  }
+  // 4. 将该链接的读事件让event_loop监控
   loop_->AddIoEvent(connfd_, conn_read_callback, EPOLLIN, this);
 }
 
+TcpConn::~TcpConn() {
+  // 没有经过CleanConn直接销毁的连接也要让弱引用失效
+  if (extra_ != nullptr && extra_->handle_ != nullptr) {
+    extra_->handle_->Close();
+  }
+}
+
+std::shared_ptr<ConnHandle> TcpConn::GetHandle() {
+  if (connfd_ == -1) {
+    return std::make_shared<ConnHandle>(nullptr);
+  }
+  ConnExtra& extra = Extra();
+  if (extra.handle_ == nullptr) {
+    extra.handle_ = std::make_shared<ConnHandle>(this);
+  }
+  return extra.handle_;
+}
+
 void TcpConn::DoRead() {
+  LARS_TRACE_SPAN_ARG("TcpConn::DoRead", connfd_);
+  if (tls_ != nullptr && !tls_->Established()) {
+    if (DoHandshake() != 1) {
+      return;
+    }
+    // 内核解密时socket上的数据由下一次EPOLLIN处理，
+    // 用户态解密时openssl可能已经读走了握手之后的数据
+    if (!UserTlsRecv()) {
+      return;
+    }
+  }
+  if (queued_ > 0) {
+    // 排队的帧还指向ibuf，本轮分发完之后再读
+    return;
+  }
+  // 0. 组装模式下的大消息直接读到IoBuffer链表中，不经过ibuf
+  if (InLarge() && extra_->large_.chain_) {
+    int ret = ReadLargeChain();
+    if (ret == -1) {
+      std::cerr << "read large message from socket!\n";
+      this->CleanConn();
+    } else if (ret == 0) {
+      std::cerr << "connection closed by peer!\n";
+      this->CleanConn();
+    } else if (extra_->large_.received_ == extra_->large_.total_) {
+      FinishLarge();
+    }
+    // 用户态解密时大消息之后的数据可能已经被openssl读走，继续读到ibuf
+    if (connfd_ == -1 || !UserTlsRecv() || !tls_->Pending()) {
+      return;
+    }
+  }
   // 1. 从套接字读取数据
-  int ret = ibuf_.ReadData(connfd_);
-  if (ret == -1) {
+  int ret = UserTlsRecv() ? ibuf_.ReadTls(tls_.get()) : ibuf_.ReadData(connfd_);
+  if (ret == TLS_AGAIN) {
+    return;
+  } else if (ret == -1) {
     std::cerr << "read data from socket!\n";
     this->CleanConn();
     return;
@@ -52,46 +144,488 @@ void TcpConn::DoRead() {
     return;
   }
   // 2. 解析msg_head数据
+  ParseMessages();
+  // 回调中用过又没有被保存的弱引用随ConnExtra释放
+  if (extra_ != nullptr && connfd_ != -1) {
+    ShrinkExtra();
+  }
+}
+
+void TcpConn::ParseMessages() {
   MsgHead head{};
+  // 开启优先级分发时帧先排队，分发完之后才从ibuf中移除，每轮最多解析budget帧
+  int budget = scheduler_ != nullptr ? scheduler_->GetConnBudget() : -1;
   //[这里用while，可能一次性读取多个完整包过来]
-  while (ibuf_.Length() >= MESSAGE_HEAD_LEN) {
+  //业务回调中可能关闭连接，关闭后不再继续解析
+  while (connfd_ != -1) {
+    if (InLarge()) {
+      // ibuf中的数据属于正在接收的大消息
+      if (!ConsumeLarge()) {
+        break;
+      }
+      continue;
+    }
+    if (ibuf_.Length() - queued_ < MESSAGE_HEAD_LEN || budget == 0) {
+      break;
+    }
     // 2.1 读取msg_head头部，固定长度MESSAGE_HEAD_LEN
-    memcpy(&head, ibuf_.Data(), MESSAGE_HEAD_LEN);
+    head = DecodeHead(ibuf_.Data() + queued_);
+    bool compressed = false;
+    if ((compress_flags_ & COMPRESS_LOCAL) &&
+        (head.msg_len_ & MSG_FLAG_COMPRESSED)) {
+      compressed = true;
+      head.msg_len_ &= ~MSG_FLAG_COMPRESSED;
+    }
+    if (head.msg_len_ > MESSAGE_LENGTH_LIMIT && large_limit_ > 0 &&
+        !compressed) {
+      if (queued_ > 0) {
+        // 大消息直接使用ibuf，等排队的帧分发完再处理
+        break;
+      }
+      if (!BeginLarge(head)) {
+        std::cerr << "large message not accepted, need close, msg_id: "
+                  << head.msg_id_ << " msg_len: " << head.msg_len_
+                  << std::endl;
+        this->CleanConn();
+        return;
+      }
+      // 大消息和普通消息一样做准入检查，占用的在途名额在整条消息结束时归还
+      int admit = limiter_ != nullptr ? Admit(head) : 0;
+      if (admit == 0) {
+        extra_->large_.held_ = limiter_ != nullptr;
+      } else {
+        ReleaseLarge();
+        if (admit == -1) {
+          // 消息头留在ibuf中，恢复读之后重新开始
+          break;
+        }
+        // 被拒绝的大消息不能一次跳过，消息体到达后逐段丢弃
+        LargeMessage& large = extra_->large_;
+        large.msg_id_ = head.msg_id_;
+        large.total_ = head.msg_len_;
+        large.discard_ = true;
+      }
+      // 大消息模式，消息体不再整体放进ibuf
+      ibuf_.Pop(MESSAGE_HEAD_LEN);
+      continue;
+    }
     if (head.msg_len_ > MESSAGE_LENGTH_LIMIT || head.msg_len_ < 0) {
       std::cerr << "data format error, need close, msg_len: " << head.msg_len_
                 << std::endl;
       this->CleanConn();
-      break;
+      return;
     }
-    if (ibuf_.Length() < MESSAGE_HEAD_LEN + head.msg_len_) {
+    if (ibuf_.Length() - queued_ < MESSAGE_HEAD_LEN + head.msg_len_) {
       // 缓存buf中剩余的数据，小于实际上应该接受的数据
       // 说明是一个不完整的包，应该抛弃
       break;
     }
+    if (head.msg_id_ == COMPRESS_NEGOTIATE_ID &&
+        (compress_flags_ & COMPRESS_LOCAL)) {
+      OnCompressNegotiate(ibuf_.Data() + queued_ + MESSAGE_HEAD_LEN,
+                          head.msg_len_);
+      SkipFrame(MESSAGE_HEAD_LEN + head.msg_len_);
+      continue;
+    }
+    int admit = limiter_ != nullptr ? Admit(head) : 0;
+    if (admit == -1) {
+      // 暂停读时消息留在ibuf中
+      break;
+    }
+    if (admit == 1) {
+      // 丢弃被拒绝的消息，继续解析
+      SkipFrame(MESSAGE_HEAD_LEN + head.msg_len_);
+      continue;
+    }
+    if (scheduler_ != nullptr) {
+      // 帧数据留在ibuf中排队
+      if (queued_ == 0) {
+        scheduler_->AddConn(this);
+      }
+      scheduler_->Push(scheduler_->ClassOf(head.msg_id_, priority_), this,
+                       ibuf_.Data() + queued_ + MESSAGE_HEAD_LEN,
+                       head.msg_len_, head.msg_id_, compressed);
+      queued_ += MESSAGE_HEAD_LEN + head.msg_len_;
+      --budget;
+      continue;
+    }
     // 2.2 再根据头长度读取数据体，然后针对数据体处理 业务
-    // TODO 添加包路由模式
-
     // 头部处理完了，往后偏移MESSAGE_HEAD_LEN长度
     ibuf_.Pop(MESSAGE_HEAD_LEN);
     // 处理ibuf.data()业务数据
-    std::cout << "read data: " << ibuf_.Data() << std::endl;
-    // 回显业务
-    callback_busi(ibuf_.Data(), head.msg_len_, head.msg_id_, nullptr, this);
+    DispatchFrame(ibuf_.Data(), head.msg_len_, head.msg_id_, compressed);
+    ReleaseFrame();
+    if (connfd_ == -1) {
+      return;
+    }
     // 消息体处理完了,往后便宜msg_len长度
     ibuf_.Pop(head.msg_len_);
   }
-  ibuf_.Adjust();
+  if (queued_ == 0) {
+    ibuf_.Adjust();
+  }
+}
+
+void TcpConn::SkipFrame(int len) {
+  if (queued_ == 0) {
+    ibuf_.Pop(len);
+  } else {
+    // 前面还有排队的帧，数据不能移动，分发完之后一起移除
+    queued_ += len;
+  }
+}
+
+void TcpConn::DispatchFrame(const char* data, int len, int msg_id,
+                            bool compressed) {
+  if (!compressed) {
+    Dispatch(data, len, msg_id);
+    return;
+  }
+  int origin = len >= COMPRESS_HEAD_LEN
+                   ? static_cast<int>(LoadLE<uint32_t>(data))
+                   : -1;
+  if (origin < 0 || origin > MESSAGE_LENGTH_LIMIT) {
+    std::cerr << "compressed message format error, need close, msg_id: "
+              << msg_id << std::endl;
+    CleanConn();
+    return;
+  }
+  // 解压到内存池的buffer中，业务处理完归还
+  std::shared_ptr<IoBuffer> buffer = BufferPool::instance().AllocBuffer(origin);
+  if (buffer == nullptr ||
+      LzCodec::Decompress(data + COMPRESS_HEAD_LEN, len - COMPRESS_HEAD_LEN,
+                          buffer->GetData(), origin) != origin) {
+    std::cerr << "decompress message error, need close, msg_id: " << msg_id
+              << std::endl;
+    if (buffer != nullptr) {
+      BufferPool::instance().revert(buffer);
+    }
+    CleanConn();
+    return;
+  }
+  Dispatch(buffer->GetData(), origin, msg_id);
+  BufferPool::instance().revert(buffer);
+}
+
+void TcpConn::EnableCompression(int threshold) {
+  if (compress_flags_ & COMPRESS_LOCAL) {
+    return;
+  }
+  compress_flags_ |= COMPRESS_LOCAL;
+  compress_threshold_ = static_cast<uint16_t>(
+      std::min(std::max(threshold, COMPRESS_HEAD_LEN + 1), 0xffff));
+  char nonce[sizeof(uint64_t)];
+  StoreLE<uint64_t>(nonce, CompressNonce());
+  SendMessage(nonce, sizeof(nonce), COMPRESS_NEGOTIATE_ID);
+}
+
+uint64_t TcpConn::CompressNonce() const {
+  return (static_cast<uint64_t>(getpid()) << 48) ^
+         static_cast<uint64_t>(reinterpret_cast<uintptr_t>(this));
+}
+
+void TcpConn::OnCompressNegotiate(const char* data, int len) {
+  // 不认识协商消息的对端可能原样回显
+  if (len == sizeof(uint64_t) && LoadLE<uint64_t>(data) != CompressNonce()) {
+    compress_flags_ |= COMPRESS_PEER;
+  }
+}
+
+void TcpConn::FinishQueued() {
+  if (connfd_ == -1) {
+    return;
+  }
+  if (queued_ > 0) {
+    ibuf_.Pop(queued_);
+    queued_ = 0;
+  }
+  if (extra_ != nullptr && extra_->pause_timer_ != -1) {
+    ibuf_.Adjust();
+    return;
+  }
+  // 预算用完时剩余的完整帧进入下一轮的队列
+  ParseMessages();
+}
+
+void TcpConn::Dispatch(const char* data, int len, int msg_id) {
+  if (router_ == nullptr || !router_->Call(msg_id, len, data, this)) {
+    std::cout << "read data: " << data << std::endl;
+    // 回显业务
+    callback_busi(data, len, msg_id, nullptr, this);
+  }
+}
+
+void TcpConn::ReleaseFrame() {
+  if (limiter_ != nullptr) {
+    limiter_->Release();
+  }
+}
+
+void TcpConn::SetRateLimiter(RateLimiter* limiter) {
+  limiter_ = limiter;
+  if (limiter_ != nullptr) {
+    limiter_->ResetConn(connfd_);
+  }
+}
+
+int TcpConn::Admit(const MsgHead& head) {
+  uint64_t wait_ns = limiter_->Admit(connfd_, head.msg_id_, loop_->GetNowNs());
+  if (wait_ns == 0) {
+    // 从准入(可能先排队)到分发完成都计入在途
+    limiter_->Hold();
+    return 0;
+  }
+  // 对端不读拒绝应答时obuf会一直增长，改为暂停读由tcp窗口反压
+  if (limiter_->GetAction() == RATE_PAUSE ||
+      obuf_.Length() >= RATE_REJECT_BACKLOG) {
+    limiter_->CountShed(RATE_PAUSE);
+    PauseRead(wait_ns);
+    return -1;
+  }
+  limiter_->CountShed(RATE_REJECT);
+  // 回复被拒绝的msg_id，由调用方丢弃消息
+  char* body = AppendMessage(sizeof(uint32_t), RATE_REJECT_ID);
+  if (body != nullptr) {
+    StoreLE<uint32_t>(body, static_cast<uint32_t>(head.msg_id_));
+  }
+  return 1;
+}
+
+void TcpConn::PauseRead(uint64_t wait_ns) {
+  // 取消EPOLLIN，socket缓冲区满了之后由tcp窗口反压客户端
+  loop_->DelIoEvent(connfd_, EPOLLIN);
+  int delay_ms = static_cast<int>((wait_ns + 999999) / 1000000);
+  Extra().pause_timer_ = loop_->RunAfter(delay_ms, [this]() { ResumeRead(); });
+}
+
+void TcpConn::ResumeRead() {
+  extra_->pause_timer_ = -1;
+  loop_->AddIoEvent(connfd_, conn_read_callback, EPOLLIN, this);
+  // 先处理暂停时留在ibuf中的消息，socket中的数据由下一次EPOLLIN处理
+  ParseMessages();
+  if (connfd_ != -1) {
+    ShrinkExtra();
+  }
+}
+
+bool TcpConn::BeginLarge(const MsgHead& head) {
+  if (router_ == nullptr || head.msg_len_ > LARGE_MESSAGE_MAX_LEN) {
+    return false;
+  }
+  LargeMessage& large = Extra().large_;
+  if (router_->HasChunk(head.msg_id_)) {
+    // 分片模式不占用额外内存，不受组装上限限制
+    large.chain_ = false;
+  } else if (router_->HasChain(head.msg_id_) &&
+             head.msg_len_ <= large_limit_) {
+    // 先占用全局额度，多个连接同时组装时不会耗尽内存池
+    if (large_in_use_.fetch_add(head.msg_len_) + head.msg_len_ >
+        large_global_limit_) {
+      large_in_use_ -= head.msg_len_;
+      std::cerr << "large message global limit exceeded!\n";
+      ShrinkExtra();
+      return false;
+    }
+    large.chain_ = true;
+  } else {
+    ShrinkExtra();
+    return false;
+  }
+  large.msg_id_ = head.msg_id_;
+  large.total_ = head.msg_len_;
+  large.received_ = 0;
+  return true;
+}
+
+bool TcpConn::ConsumeLarge() {
+  LargeMessage& large = extra_->large_;
+  int len = std::min(ibuf_.Length(), large.total_ - large.received_);
+  if (len == 0) {
+    return false;
+  }
+  if (large.discard_) {
+    // 被拒绝的消息体直接丢弃
+  } else if (large.chain_) {
+    if (!AppendChain(ibuf_.Data(), len)) {
+      this->CleanConn();
+      return false;
+    }
+  } else {
+    router_->CallChunk(large.msg_id_, ibuf_.Data(), len, large.received_,
+                       large.total_, this);
+    if (connfd_ == -1) {
+      return false;
+    }
+  }
+  large.received_ += len;
+  ibuf_.Pop(len);
+  if (large.received_ == large.total_) {
+    FinishLarge();
+    return true;
+  }
+  return false;
+}
+
+bool TcpConn::ReserveChain() {
+  LargeMessage& large = extra_->large_;
+  if (large.tail_ != nullptr &&
+      large.tail_->GetLength() < large.tail_->GetCapacity()) {
+    return true;
+  }
+  // 每个分片按剩余长度申请，最大LARGE_MESSAGE_CHUNK
+  int remain = large.total_ - large.received_;
+  auto buffer =
+      BufferPool::instance().AllocBuffer(std::min(remain, LARGE_MESSAGE_CHUNK));
+  if (buffer == nullptr) {
+    std::cerr << "no idle buffer for large message!\n";
+    return false;
+  }
+  if (large.tail_ == nullptr) {
+    large.head_ = buffer;
+  } else {
+    large.tail_->SetNext(buffer);
+  }
+  large.tail_ = buffer;
+  return true;
+}
+
+bool TcpConn::AppendChain(const char* data, int len) {
+  while (len > 0) {
+    if (!ReserveChain()) {
+      return false;
+    }
+    IoBuffer* tail = extra_->large_.tail_.get();
+    int n = std::min(len, tail->GetCapacity() - tail->GetLength());
+    memcpy(tail->GetData() + tail->GetLength(), data, n);
+    tail->SetLength(tail->GetLength() + n);
+    data += n;
+    len -= n;
+  }
+  return true;
+}
+
+int TcpConn::ReadLargeChain() {
+  LargeMessage& large = extra_->large_;
+  if (UserTlsRecv()) {
+    return ReadLargeChainTls();
+  }
+  if (!ReserveChain()) {
+    return -1;
+  }
+  IoBuffer* tail = large.tail_.get();
+  // 只读到当前大消息结束，后续消息留在socket中由ibuf读取
+  int len = std::min(tail->GetCapacity() - tail->GetLength(),
+                     large.total_ - large.received_);
+  ssize_t already_read;
+  do {
+    already_read = read(connfd_, tail->GetData() + tail->GetLength(), len);
+  } while (already_read == -1 && errno == EINTR);
+  if (already_read == -1 && errno == EAGAIN) {
+    return 1;
+  }
+  if (already_read > 0) {
+    tail->SetLength(tail->GetLength() + static_cast<int>(already_read));
+    large.received_ += static_cast<int>(already_read);
+  }
+  return static_cast<int>(already_read);
+}
+
+int TcpConn::ReadLargeChainTls() {
+  LargeMessage& large = extra_->large_;
+  //openssl每次最多解出一个记录，读到没有数据为止，
+  //否则留在openssl中的数据不会再触发EPOLLIN
+  int total = 0;
+  while (large.received_ < large.total_) {
+    if (!ReserveChain()) {
+      return -1;
+    }
+    IoBuffer* tail = large.tail_.get();
+    int len = std::min(tail->GetCapacity() - tail->GetLength(),
+                       large.total_ - large.received_);
+    int ret = tls_->Read(tail->GetData() + tail->GetLength(), len);
+    if (ret <= 0) {
+      if (total > 0 && ret != -1) {
+        //先处理已经读到的数据，对端关闭在下一次EPOLLIN处理
+        return total;
+      }
+      return ret == TLS_AGAIN ? 1 : ret;
+    }
+    tail->SetLength(tail->GetLength() + ret);
+    large.received_ += ret;
+    total += ret;
+  }
+  return total;
+}
+
+void TcpConn::FinishLarge() {
+  LargeMessage& large = extra_->large_;
+  if (large.chain_) {
+    // 回调中可能关闭连接，先持有链表
+    std::shared_ptr<IoBuffer> chain = large.head_;
+    router_->CallChain(large.msg_id_, chain, large.total_, this);
+  }
+  ReleaseLarge();
+  ShrinkExtra();
+}
+
+void TcpConn::ReleaseLarge() {
+  if (extra_ == nullptr) {
+    return;
+  }
+  LargeMessage& large = extra_->large_;
+  if (large.chain_) {
+    large_in_use_ -= large.total_;
+  }
+  if (large.held_) {
+    limiter_->Release();
+  }
+  // 归还组装链表
+  std::shared_ptr<IoBuffer> buffer = large.head_;
+  while (buffer != nullptr) {
+    std::shared_ptr<IoBuffer> next = buffer->GetNext();
+    buffer->SetNext(nullptr);
+    BufferPool::instance(buffer->GetNode()).revert(buffer);
+    buffer = next;
+  }
+  large = LargeMessage();
 }
 
 void TcpConn::DoWrite() {
+  LARS_TRACE_SPAN_ARG("TcpConn::DoWrite", connfd_);
   // do_write是触发玩event事件要处理的事情，
   // 应该是直接将out_buf力度数据io写会对方客户端
   // 而不是在这里组装一个message再发
   // 组装message的过程应该是主动调用
 
-  // 只要obuf中有数据就写
-  while (obuf_.Length()) {
-    int ret = obuf_.WriteFd(connfd_);
+  if (tls_ != nullptr && !tls_->Established()) {
+    if (DoHandshake() != 1) {
+      return;
+    }
+  }
+
+  // 只要obuf或者文件队列中有数据就写
+  while (obuf_.Length() || HasFiles()) {
+    int ret;
+    std::deque<FileSegment>* files = HasFiles() ? &extra_->files_ : nullptr;
+    if (files != nullptr && files->front().prior_bytes_ == 0) {
+      // 文件片段之前的obuf数据已经写完，发送文件内容
+      FileSegment& seg = files->front();
+      ret = WriteFile(seg);
+      if (ret > 0 && seg.remain_ == 0 && extra_->pipe_pending_ == 0) {
+        close(seg.fd_);
+        files->pop_front();
+      }
+    } else {
+      // 只写到下一个文件片段之前
+      int len = files == nullptr ? obuf_.Length() : files->front().prior_bytes_;
+      ret = UserTlsSend() ? obuf_.WriteTls(tls_.get(), len)
+                          : obuf_.WriteFd(connfd_, len);
+      if (ret > 0 && files != nullptr) {
+        for (auto& seg : *files) {
+          seg.prior_bytes_ -= ret;
+        }
+      }
+    }
     if (ret == -1) {
       std::cerr << "WriteFd error, close conn!\n";
       return;
@@ -101,53 +635,319 @@ void TcpConn::DoWrite() {
       break;
     }
   }
-  if (obuf_.Length() == 0) {
+  if (obuf_.Length() == 0 && !HasFiles()) {
+    loop_->DelIoEvent(connfd_, EPOLLOUT);
+    ShrinkExtra();
+  } else if (extra_ != nullptr && extra_->wait_fd_ != -1) {
+    // 数据源可读之前不再关注可写，避免水平触发的EPOLLOUT空转
     loop_->DelIoEvent(connfd_, EPOLLOUT);
   }
 }
 
+void TcpConn::WaitSource(int fd) {
+  if (extra_->wait_fd_ != -1) {
+    return;
+  }
+  loop_->AddIoEvent(fd, conn_source_callback, EPOLLIN, this);
+  // 不支持epoll的数据源只能继续靠EPOLLOUT重试
+  if (loop_->GetData(fd) != nullptr) {
+    extra_->wait_fd_ = fd;
+  }
+}
+
+void TcpConn::ResumeWrite() {
+  if (extra_ == nullptr || extra_->wait_fd_ == -1) {
+    return;
+  }
+  loop_->DelIoEvent(extra_->wait_fd_);
+  extra_->wait_fd_ = -1;
+  loop_->AddIoEvent(connfd_, conn_write_callback, EPOLLOUT, this);
+}
+
+int TcpConn::WriteFile(FileSegment& seg) {
+  ssize_t ret;
+  if (seg.regular_) {
+    // 普通文件直接sendfile，偏移由内核推进
+    do {
+      ret = sendfile(connfd_, seg.fd_, &seg.offset_, seg.remain_);
+    } while (ret == -1 && errno == EINTR);
+    if (ret > 0) {
+      seg.remain_ -= ret;
+    }
+  } else {
+    // 其他fd先splice到中转管道，再从管道splice到socket
+    if (extra_->pipe_pending_ == 0 && seg.remain_ > 0) {
+      do {
+        ret = splice(seg.fd_, nullptr, extra_->pipe_fds_[1], nullptr, seg.remain_,
+                     SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+      } while (ret == -1 && errno == EINTR);
+      if (ret > 0) {
+        extra_->pipe_pending_ += ret;
+        seg.remain_ -= ret;
+      } else if (ret == -1 && errno == EAGAIN) {
+        // 数据源暂时没有数据，等它可读再继续
+        WaitSource(seg.fd_);
+        return 0;
+      } else {
+        // 数据源提前结束或出错
+        return -1;
+      }
+    }
+    do {
+      ret = splice(extra_->pipe_fds_[0], nullptr, connfd_, nullptr, extra_->pipe_pending_,
+                   SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+    } while (ret == -1 && errno == EINTR);
+    if (ret > 0) {
+      extra_->pipe_pending_ -= ret;
+    }
+  }
+  if (ret == -1 && errno == EAGAIN) {
+    return 0;
+  }
+  if (ret == 0) {
+    // 文件长度小于声明的消息长度
+    std::cerr << "file shorter than message length!\n";
+    return -1;
+  }
+  return static_cast<int>(ret);
+}
+
 void TcpConn::CleanConn() {
+  if (connfd_ == -1) {
+    return;
+  }
   // 链接清理工作
   // 1 将该链接从tcp_server摘除掉
-  // TODO
+  if (server_ != nullptr) {
+    server_->RemoveConn(connfd_);
+  }
   // 2 将该链接从event_loop中摘除
   loop_->DelIoEvent(connfd_);
   // 3 buf清空
   ibuf_.Clear();
+  queued_ = 0;
   obuf_.Clear();
+  // 回调中可能正在使用extra_，只清空不释放，随连接对象一起销毁
+  ReleaseLarge();
+  if (extra_ != nullptr) {
+    if (extra_->pause_timer_ != -1) {
+      loop_->CancelTimer(extra_->pause_timer_);
+      extra_->pause_timer_ = -1;
+    }
+    if (extra_->wait_fd_ != -1) {
+      loop_->DelIoEvent(extra_->wait_fd_);
+      extra_->wait_fd_ = -1;
+    }
+    for (auto& seg : extra_->files_) {
+      close(seg.fd_);
+    }
+    extra_->files_.clear();
+    if (extra_->pipe_fds_[0] != -1) {
+      close(extra_->pipe_fds_[0]);
+      close(extra_->pipe_fds_[1]);
+      extra_->pipe_fds_[0] = extra_->pipe_fds_[1] = -1;
+      extra_->pipe_pending_ = 0;
+    }
+  }
   // 4 关闭原始套接字
   int fd = connfd_;
   connfd_ = -1;
   close(fd);
+  // 5 通知持有弱引用的一方，关闭回调中可能再次使用本连接，放在最后
+  if (extra_ != nullptr && extra_->handle_ != nullptr) {
+    std::shared_ptr<ConnHandle> handle = std::move(extra_->handle_);
+    handle->Close();
+  }
+}
+
+bool TcpConn::EnableRingBuffer(int size) {
+  if (!ibuf_.EnableRing(size)) {
+    std::cerr << "enable ring buffer error!\n";
+    return false;
+  }
+  if (!obuf_.EnableRing(size)) {
+    // 两个缓冲区保持同一种模式
+    ibuf_.DisableRing();
+    std::cerr << "enable ring buffer error!\n";
+    return false;
+  }
+  return true;
 }
 
 int TcpConn::SendMessage(const char* data, int msg_len, int msg_id) {
-  std::cout << "server sendMessage: " << data << " msg_len :" << msg_len
-            << " msg_id: " << msg_id << std::endl;
+  if ((compress_flags_ & COMPRESS_PEER) && msg_len >= compress_threshold_ &&
+      msg_len <= MESSAGE_LENGTH_LIMIT &&
+      SendCompressed(data, msg_len, msg_id) == 0) {
+    return 0;
+  }
+  // 压缩需要按最大长度预留，预留失败时原样发送只需要原始长度
+  char* body = AppendMessage(msg_len, msg_id);
+  if (body == nullptr) {
+    return -1;
+  }
+  if (msg_len > 0) {
+    memcpy(body, data, msg_len);
+  }
+  return 0;
+}
+
+int TcpConn::SendCompressed(const char* data, int msg_len, int msg_id) {
+  // 直接压缩到obuf中，按最大长度预留，压缩后撤销多余的部分
+  int bound = COMPRESS_HEAD_LEN + LzCodec::Bound(msg_len);
+  char* body = AppendMessage(bound, msg_id);
+  if (body == nullptr) {
+    return -1;
+  }
+  int len = LzCodec::Compress(data, msg_len, body + COMPRESS_HEAD_LEN,
+                              bound - COMPRESS_HEAD_LEN);
+  if (len > 0 && COMPRESS_HEAD_LEN + len < msg_len) {
+    StoreLE<uint32_t>(body, static_cast<uint32_t>(msg_len));
+    len += COMPRESS_HEAD_LEN;
+    EncodeHead(body - MESSAGE_HEAD_LEN, msg_id, len | MSG_FLAG_COMPRESSED);
+  } else {
+    // 不可压缩的数据原样发送
+    memcpy(body, data, msg_len);
+    len = msg_len;
+    EncodeHead(body - MESSAGE_HEAD_LEN, msg_id, len);
+  }
+  obuf_.Trim(bound - len);
+  return 0;
+}
+
+char* TcpConn::AppendMessage(int msg_len, int msg_id) {
+  if (msg_len < 0) {
+    return nullptr;
+  }
   bool active_epollout = false;
-  if(obuf_.Length() ==0 ) {
+  if (obuf_.Length() == 0 && !HasFiles()) {
     //如果现在已经数据都发送完了，那么是一定要激活写事件的
     //如果有数据，说明数据还没有完全写完到对端，那么没必要再激活等写完再激活
     active_epollout = true;
   }
-  //1 先封装message消息头
-  MsgHead head{msg_id,msg_len};
-  //1.1 写消息头
-  int ret = obuf_.SentData(reinterpret_cast<char*>(&head),MESSAGE_HEAD_LEN);
-  if(ret != 0) {
-    std::cerr <<"send head error!\n";
+  //1 消息头和消息体一起预留，失败时不会留下半个消息
+  char* dst = obuf_.Append(MESSAGE_HEAD_LEN + msg_len);
+  if (dst == nullptr) {
+    std::cerr << "send message error!\n";
+    return nullptr;
+  }
+  EncodeHead(dst, msg_id, msg_len);
+  if (active_epollout) {
+    //2. 激活EPOLLOUT写事件
+    loop_->AddIoEvent(connfd_, conn_write_callback, EPOLLOUT, this);
+  }
+  return dst + MESSAGE_HEAD_LEN;
+}
+
+int TcpConn::SendFile(int fd, off_t offset, int len, int msg_id) {
+  struct stat st {};
+  if (len < 0 || fstat(fd, &st) == -1) {
+    std::cerr << "send file error, invalid fd or length!\n";
     return -1;
   }
-    //1.2 写消息体
-  ret = obuf_.SentData(data,msg_len);
-  if(ret != 0) {
-    //如果写消息体失败，那就回滚将消息头的发送也取消
-    obuf_.Pop(MESSAGE_HEAD_LEN);
+  if (len > MESSAGE_LENGTH_LIMIT && large_limit_ == 0) {
+    // 对端没有开启大消息模式时会当作格式错误关闭连接
+    std::cerr << "send file error, message too long without large message!\n";
     return -1;
   }
-  if(active_epollout) {
-    //2. 激活EPOLLOUT写事件
-    loop_->AddIoEvent(connfd_,conn_write_callback,EPOLLOUT,this);
+  if (tls_ != nullptr && (!tls_->Established() || !tls_->KernelSend())) {
+    // 用户态tls无法让内核直接发送文件
+    std::cerr << "send file needs kernel tls!\n";
+    return -1;
+  }
+  bool regular = S_ISREG(st.st_mode);
+  ConnExtra& extra = Extra();
+  if (!regular && extra.pipe_fds_[0] == -1 &&
+      pipe2(extra.pipe_fds_, O_NONBLOCK | O_CLOEXEC) == -1) {
+    std::cerr << "create splice pipe error!\n";
+    return -1;
+  }
+  int file_fd = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+  if (file_fd == -1) {
+    std::cerr << "dup file fd error!\n";
+    return -1;
+  }
+  bool active_epollout = obuf_.Length() == 0 && extra.files_.empty();
+  // 1 消息头走obuf
+  char* head = obuf_.Append(MESSAGE_HEAD_LEN);
+  if (head == nullptr) {
+    std::cerr << "send head error!\n";
+    close(file_fd);
+    return -1;
+  }
+  EncodeHead(head, msg_id, len);
+  // 2 消息体排在obuf当前数据之后，由DoWrite零拷贝发送
+  if (len > 0) {
+    extra.files_.push_back({obuf_.Length(), file_fd, offset,
+                      static_cast<size_t>(len), regular});
+  } else {
+    close(file_fd);
+  }
+  if (active_epollout) {
+    loop_->AddIoEvent(connfd_, conn_write_callback, EPOLLOUT, this);
   }
   return 0;
 }
+
+bool TcpConn::EnableTls(TlsContext* ctx, bool server,
+                        const std::string& peer_name) {
+  if (tls_ != nullptr || ibuf_.IsRing() || ibuf_.Length() != 0 ||
+      obuf_.Length() != 0) {
+    std::cerr << "enable tls error!\n";
+    return false;
+  }
+  tls_.reset(new TlsSession(ctx, connfd_, server));
+  if (!server && !peer_name.empty() && !tls_->SetPeerName(peer_name)) {
+    return false;
+  }
+  if (!server) {
+    // 客户端先发送ClientHello
+    return DoHandshake() != -1;
+  }
+  return true;
+}
+
+int TcpConn::DoHandshake() {
+  int ret = tls_->Handshake();
+  if (ret == -1) {
+    std::cerr << "tls handshake failed, close conn!\n";
+    CleanConn();
+    return -1;
+  }
+  if (ret == 0) {
+    // 握手期间只按openssl的需要等待可写，避免obuf中的数据让EPOLLOUT空转
+    if (tls_->WantWrite()) {
+      loop_->AddIoEvent(connfd_, conn_write_callback, EPOLLOUT, this);
+    } else {
+      loop_->DelIoEvent(connfd_, EPOLLOUT);
+    }
+    return 0;
+  }
+  // 握手完成，发送握手期间积累的消息
+  if (obuf_.Length() > 0 || HasFiles()) {
+    loop_->AddIoEvent(connfd_, conn_write_callback, EPOLLOUT, this);
+  } else {
+    loop_->DelIoEvent(connfd_, EPOLLOUT);
+  }
+  return 1;
+}
+
+TcpConn::ConnExtra& TcpConn::Extra() {
+  if (extra_ == nullptr) {
+    extra_.reset(new ConnExtra());
+  }
+  return *extra_;
+}
+
+void TcpConn::ShrinkExtra() {
+  if (extra_ == nullptr || extra_->large_.total_ > 0 ||
+      !extra_->files_.empty() || extra_->pipe_pending_ > 0 ||
+      extra_->pause_timer_ != -1 ||
+      (extra_->handle_ != nullptr && extra_->handle_.use_count() > 1)) {
+    return;
+  }
+  if (extra_->pipe_fds_[0] != -1) {
+    close(extra_->pipe_fds_[0]);
+    close(extra_->pipe_fds_[1]);
+  }
+  extra_.reset();
+}
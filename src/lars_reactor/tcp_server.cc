@@ -9,6 +9,7 @@
 #include <utility>
 
 #include "lars_reactor/reactor_buffer.h"
+#include "lars_reactor/slab_pool.h"
 #include "lars_reactor/tcp_conn.h"
 
 struct message {
@@ -81,19 +82,10 @@ auto accept_callback = [](EventLoop* loop, int fd, void* args) {
   }
 };
 
-TcpServer::TcpServer(EventLoop* loop, const char* ip, uint16_t port) {
+TcpServer::TcpServer(EventLoop* loop, const char* ip, uint16_t port,
+                     bool reuse_port) {
   bzero(&connaddr_, sizeof(connaddr_));
-  /**
-   * 忽略一些信号 SIGHUP, SIGPIPE
-   * SIGPIPE:如果客户端关闭，服务端再次write就会产生
-   * SIGHUP:如果terminal关闭，会给当前进程发送该信号
-   */
-  if (signal(SIGHUP, SIG_IGN) == SIG_ERR) {
-    std::cerr << "signal ignore SIGHUP\n";
-  }
-  if (signal(SIGPIPE, SIG_IGN) == SIG_ERR) {
-    std::cerr << "signal ignore SIGPIPE\n";
-  }
+  IgnoreSignals();
   // 创建socket
   sockfd_ = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, IPPROTO_TCP);
   if (sockfd_ == -1) {
@@ -111,6 +103,18 @@ TcpServer::TcpServer(EventLoop* loop, const char* ip, uint16_t port) {
   if (setsockopt(sockfd_, SOL_SOCKET, SO_REUSEADDR, &op, sizeof(op)) < 0) {
     std::cerr << "setsockopt SO_REUSEADDR\n";
   }
+  if (reuse_port) {
+    if (setsockopt(sockfd_, SOL_SOCKET, SO_REUSEPORT, &op, sizeof(op)) < 0) {
+      std::cerr << "setsockopt SO_REUSEPORT\n";
+    }
+    // 内核优先把网卡队列中断所在cpu上的新连接分给绑定该cpu的监听socket，
+    // 这样连接和它的buffer都留在同一个numa节点
+    int cpu = loop->GetCpu();
+    if (cpu >= 0 && setsockopt(sockfd_, SOL_SOCKET, SO_INCOMING_CPU, &cpu,
+                               sizeof(cpu)) < 0) {
+      std::cerr << "setsockopt SO_INCOMING_CPU\n";
+    }
+  }
   // 绑定端口
   if (bind(sockfd_, reinterpret_cast<const struct sockaddr*>(&server_addr),
            sizeof(server_addr)) < 0) {
@@ -128,7 +132,42 @@ TcpServer::TcpServer(EventLoop* loop, const char* ip, uint16_t port) {
   loop_->AddIoEvent(sockfd_, accept_callback, EPOLLIN, this);
 }
 
-TcpServer::~TcpServer() { close(sockfd_); }
+TcpServer::TcpServer(EventLoop* loop, int listen_fd)
+    : sockfd_(listen_fd), loop_(loop) {
+  bzero(&connaddr_, sizeof(connaddr_));
+  IgnoreSignals();
+  loop_->AddIoEvent(sockfd_, accept_callback, EPOLLIN, this);
+}
+
+TcpServer::~TcpServer() {
+  if (sockfd_ != -1) {
+    close(sockfd_);
+  }
+}
+
+void TcpServer::IgnoreSignals() {
+  /**
+   * 忽略一些信号 SIGHUP, SIGPIPE
+   * SIGPIPE:如果客户端关闭，服务端再次write就会产生
+   * SIGHUP:如果terminal关闭，会给当前进程发送该信号
+   */
+  if (signal(SIGHUP, SIG_IGN) == SIG_ERR) {
+    std::cerr << "signal ignore SIGHUP\n";
+  }
+  if (signal(SIGPIPE, SIG_IGN) == SIG_ERR) {
+    std::cerr << "signal ignore SIGPIPE\n";
+  }
+}
+
+void TcpServer::StopAccept() {
+  if (sockfd_ == -1) {
+    return;
+  }
+  // 监听socket已经交给新进程，关闭的只是本进程的引用，backlog中的连接由新进程accept
+  loop_->DelIoEvent(sockfd_);
+  close(sockfd_);
+  sockfd_ = -1;
+}
 
 void TcpServer::DoAccept() {
   int connfd;
@@ -150,13 +189,59 @@ void TcpServer::DoAccept() {
         std::cerr << "accept error\n";
       }
     } else {
-      auto conn = std::make_shared<TcpConn>(connfd, loop_);
+      // 连接对象和shared_ptr控制块一起从slab分配
+      auto conn = std::allocate_shared<TcpConn>(SlabAllocator<TcpConn>(),
+                                                connfd, loop_, this);
       if (conn == nullptr) {
         std::cerr << "new tcp connection error!\n";
         exit(1);
       }
+      if (tls_ctx_ != nullptr) {
+        if (!conn->EnableTls(tls_ctx_, true)) {
+          // 不能按明文继续服务配置了tls的端口
+          conn->CleanConn();
+          break;
+        }
+      } else if (ring_size_ > 0) {
+        conn->EnableRingBuffer(ring_size_);
+      }
+      if (large_limit_ > 0) {
+        conn->EnableLargeMessage(large_limit_);
+      }
+      if (limiter_ != nullptr) {
+        conn->SetRateLimiter(limiter_);
+      }
+      conn->SetScheduler(scheduler_);
+      if (compress_threshold_ > 0) {
+        conn->EnableCompression(compress_threshold_);
+      }
+      if (connfd >= static_cast<int>(conns_.size())) {
+        conns_.resize(connfd + 1);
+      }
+      conns_[connfd] = conn;
+      ++conn_num_;
       std::cout << "get new connection success!\n";
       break;
     }
   }
 }
+
+int TcpServer::SetConnPriority(int connfd, int cls) {
+  if (connfd < 0 || connfd >= static_cast<int>(conns_.size()) ||
+      conns_[connfd] == nullptr || cls < 0 || cls >= PRIORITY_CLASSES) {
+    return -1;
+  }
+  conns_[connfd]->SetPriority(cls);
+  return 0;
+}
+
+void TcpServer::RemoveConn(int connfd) {
+  if (connfd < 0 || connfd >= static_cast<int>(conns_.size()) ||
+      conns_[connfd] == nullptr) {
+    return;
+  }
+  // 连接可能正在自己的回调中被关闭，延迟到本轮事件处理完之后再释放
+  std::shared_ptr<TcpConn> conn = std::move(conns_[connfd]);
+  --conn_num_;
+  loop_->AddTask([conn]() {});
+}
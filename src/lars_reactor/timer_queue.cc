@@ -0,0 +1,100 @@
+#include "lars_reactor/timer_queue.h"
+
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include <iostream>
+#include <utility>
+#include <vector>
+
+#include "lars_reactor/event_loop.h"
+
+// timerfd的读事件回调
+auto timer_read_callback = [](EventLoop* loop, int fd, void* args) {
+  auto queue = static_cast<TimerQueue*>(args);
+  queue->OnTimeout();
+};
+
+TimerQueue::TimerQueue(EventLoop* loop) : loop_(loop), next_id_(0) {
+  timer_fd_ = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  if (timer_fd_ == -1) {
+    std::cerr << "timerfd_create error!\n";
+    exit(1);
+  }
+  loop_->AddIoEvent(timer_fd_, timer_read_callback, EPOLLIN, this);
+}
+
+TimerQueue::~TimerQueue() {
+  loop_->DelIoEvent(timer_fd_);
+  close(timer_fd_);
+}
+
+int TimerQueue::AddTimer(uint64_t expire_ns, uint64_t interval_ns,
+                         timer_callback callback) {
+  int timer_id = next_id_++;
+  timers_[timer_id] = {expire_ns, interval_ns, std::move(callback)};
+  auto itr = expires_.emplace(expire_ns, timer_id);
+  if (itr == expires_.begin()) {
+    // 新定时器成为最早到期的，需要重新设置timerfd
+    Reset();
+  }
+  return timer_id;
+}
+
+void TimerQueue::CancelTimer(int timer_id) {
+  auto itr = timers_.find(timer_id);
+  if (itr == timers_.end()) {
+    return;
+  }
+  auto range = expires_.equal_range(itr->second.expire_ns_);
+  for (auto e = range.first; e != range.second; ++e) {
+    if (e->second == timer_id) {
+      expires_.erase(e);
+      break;
+    }
+  }
+  timers_.erase(itr);
+}
+
+void TimerQueue::OnTimeout() {
+  uint64_t count;
+  ssize_t ret = read(timer_fd_, &count, sizeof(count));
+  (void)ret;
+  uint64_t now = EventLoop::ClockNs();
+  // 先取出全部到期的定时器，回调中可能增删定时器
+  std::vector<int> fired;
+  while (!expires_.empty() && expires_.begin()->first <= now) {
+    fired.push_back(expires_.begin()->second);
+    expires_.erase(expires_.begin());
+  }
+  for (int timer_id : fired) {
+    auto itr = timers_.find(timer_id);
+    if (itr == timers_.end()) {
+      continue;
+    }
+    timer_callback callback = itr->second.callback_;
+    if (itr->second.interval_ns_ != 0) {
+      // 周期定时器重新加入队列
+      itr->second.expire_ns_ = now + itr->second.interval_ns_;
+      expires_.emplace(itr->second.expire_ns_, timer_id);
+    } else {
+      timers_.erase(itr);
+    }
+    callback();
+  }
+  Reset();
+}
+
+void TimerQueue::Reset() {
+  struct itimerspec spec {};
+  if (!expires_.empty()) {
+    uint64_t expire_ns = expires_.begin()->first;
+    spec.it_value.tv_sec = static_cast<time_t>(expire_ns / 1000000000UL);
+    spec.it_value.tv_nsec = static_cast<long>(expire_ns % 1000000000UL);
+    if (spec.it_value.tv_sec == 0 && spec.it_value.tv_nsec == 0) {
+      spec.it_value.tv_nsec = 1;
+    }
+  }
+  // it_value全0表示停止定时器
+  timerfd_settime(timer_fd_, TFD_TIMER_ABSTIME, &spec, nullptr);
+}
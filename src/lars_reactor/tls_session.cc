@@ -0,0 +1,260 @@
+#include "lars_reactor/tls_session.h"
+
+#include <iostream>
+
+#ifdef LARS_WITH_TLS
+
+#include <arpa/inet.h>
+#include <openssl/err.h>
+#include <openssl/pem.h>
+#include <openssl/ssl.h>
+#include <openssl/x509v3.h>
+
+// 打印并清空openssl的错误队列
+static void PrintTlsError(const char* what) {
+  std::cerr << what << " error!";
+  unsigned long err;
+  char buf[256];
+  while ((err = ERR_get_error()) != 0) {
+    ERR_error_string_n(err, buf, sizeof(buf));
+    std::cerr << " " << buf;
+  }
+  std::cerr << "\n";
+}
+
+static SSL_CTX* NewCtx(bool server) {
+  SSL_CTX* ctx = SSL_CTX_new(server ? TLS_server_method() : TLS_client_method());
+  if (ctx == nullptr) {
+    PrintTlsError("SSL_CTX_new");
+    return nullptr;
+  }
+  SSL_CTX_set_min_proto_version(ctx, TLS1_2_VERSION);
+  // 握手完成后尝试把密钥交给内核
+  SSL_CTX_set_options(ctx, SSL_OP_ENABLE_KTLS);
+  // 握手后的NewSessionTicket会打断内核接收，不发送会话票据
+  SSL_CTX_set_options(ctx, SSL_OP_NO_TICKET);
+  SSL_CTX_set_num_tickets(ctx, 0);
+  // 内核tls支持AES-GCM
+  SSL_CTX_set_cipher_list(ctx, "ECDHE+AESGCM");
+  // 输出缓冲区在写的过程中可能被Adjust移动
+  SSL_CTX_set_mode(ctx, SSL_MODE_ENABLE_PARTIAL_WRITE |
+                            SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+  return ctx;
+}
+
+TlsContext::~TlsContext() { SSL_CTX_free(ctx_); }
+
+std::unique_ptr<TlsContext> TlsContext::CreateServer(
+    const std::string& cert_file, const std::string& key_file) {
+  SSL_CTX* ctx = NewCtx(true);
+  if (ctx == nullptr) {
+    return nullptr;
+  }
+  std::unique_ptr<TlsContext> context(new TlsContext(ctx));
+  if (SSL_CTX_use_certificate_chain_file(ctx, cert_file.c_str()) != 1 ||
+      SSL_CTX_use_PrivateKey_file(ctx, key_file.c_str(), SSL_FILETYPE_PEM) !=
+          1 ||
+      SSL_CTX_check_private_key(ctx) != 1) {
+    PrintTlsError("load tls certificate");
+    return nullptr;
+  }
+  return context;
+}
+
+std::unique_ptr<TlsContext> TlsContext::CreateServerFromPem(
+    const std::string& cert_pem, const std::string& key_pem) {
+  SSL_CTX* ctx = NewCtx(true);
+  if (ctx == nullptr) {
+    return nullptr;
+  }
+  std::unique_ptr<TlsContext> context(new TlsContext(ctx));
+  BIO* cert_bio = BIO_new_mem_buf(cert_pem.data(), static_cast<int>(cert_pem.size()));
+  BIO* key_bio = BIO_new_mem_buf(key_pem.data(), static_cast<int>(key_pem.size()));
+  X509* cert = PEM_read_bio_X509(cert_bio, nullptr, nullptr, nullptr);
+  EVP_PKEY* key = PEM_read_bio_PrivateKey(key_bio, nullptr, nullptr, nullptr);
+  bool ok = cert != nullptr && key != nullptr &&
+            SSL_CTX_use_certificate(ctx, cert) == 1 &&
+            SSL_CTX_use_PrivateKey(ctx, key) == 1 &&
+            SSL_CTX_check_private_key(ctx) == 1;
+  X509_free(cert);
+  EVP_PKEY_free(key);
+  BIO_free(cert_bio);
+  BIO_free(key_bio);
+  if (!ok) {
+    PrintTlsError("load tls certificate");
+    return nullptr;
+  }
+  return context;
+}
+
+std::unique_ptr<TlsContext> TlsContext::CreateClient(const std::string& ca_file) {
+  SSL_CTX* ctx = NewCtx(false);
+  if (ctx == nullptr) {
+    return nullptr;
+  }
+  std::unique_ptr<TlsContext> context(new TlsContext(ctx));
+  int ret = ca_file.empty()
+                ? SSL_CTX_set_default_verify_paths(ctx)
+                : SSL_CTX_load_verify_locations(ctx, ca_file.c_str(), nullptr);
+  if (ret != 1) {
+    PrintTlsError("load tls ca");
+    return nullptr;
+  }
+  SSL_CTX_set_verify(ctx, SSL_VERIFY_PEER, nullptr);
+  return context;
+}
+
+std::unique_ptr<TlsContext> TlsContext::CreateInsecureClient() {
+  SSL_CTX* ctx = NewCtx(false);
+  if (ctx == nullptr) {
+    return nullptr;
+  }
+  SSL_CTX_set_verify(ctx, SSL_VERIFY_NONE, nullptr);
+  return std::unique_ptr<TlsContext>(new TlsContext(ctx));
+}
+
+void TlsContext::LimitTls12() {
+  SSL_CTX_set_max_proto_version(ctx_, TLS1_2_VERSION);
+}
+
+TlsSession::TlsSession(TlsContext* ctx, int fd, bool server) {
+  ssl_ = SSL_new(ctx->GetCtx());
+  if (ssl_ == nullptr || SSL_set_fd(ssl_, fd) != 1) {
+    PrintTlsError("SSL_new");
+    return;
+  }
+  if (server) {
+    SSL_set_accept_state(ssl_);
+  } else {
+    SSL_set_connect_state(ssl_);
+  }
+}
+
+TlsSession::~TlsSession() { SSL_free(ssl_); }
+
+bool TlsSession::SetPeerName(const std::string& name) {
+  if (ssl_ == nullptr) {
+    return false;
+  }
+  unsigned char addr[sizeof(struct in6_addr)];
+  int ret;
+  if (inet_pton(AF_INET, name.c_str(), addr) == 1 ||
+      inet_pton(AF_INET6, name.c_str(), addr) == 1) {
+    // ip地址和证书的subjectAltName中的IP比较，不发送SNI
+    ret = X509_VERIFY_PARAM_set1_ip_asc(SSL_get0_param(ssl_), name.c_str());
+  } else {
+    ret = SSL_set1_host(ssl_, name.c_str()) == 1 &&
+          SSL_set_tlsext_host_name(ssl_, name.c_str()) == 1;
+  }
+  if (ret != 1) {
+    PrintTlsError("set tls peer name");
+    return false;
+  }
+  return true;
+}
+
+int TlsSession::Handshake() {
+  if (ssl_ == nullptr) {
+    return -1;
+  }
+  if (established_) {
+    return 1;
+  }
+  want_write_ = false;
+  int ret = SSL_do_handshake(ssl_);
+  if (ret != 1) {
+    int err = SSL_get_error(ssl_, ret);
+    if (err == SSL_ERROR_WANT_READ) {
+      return 0;
+    }
+    if (err == SSL_ERROR_WANT_WRITE) {
+      want_write_ = true;
+      return 0;
+    }
+    PrintTlsError("tls handshake");
+    return -1;
+  }
+  established_ = true;
+  kernel_send_ = BIO_get_ktls_send(SSL_get_wbio(ssl_)) != 0;
+  kernel_recv_ = BIO_get_ktls_recv(SSL_get_rbio(ssl_)) != 0;
+  return 1;
+}
+
+int TlsSession::Read(char* buf, int len) {
+  int ret = SSL_read(ssl_, buf, len);
+  if (ret > 0) {
+    return ret;
+  }
+  int err = SSL_get_error(ssl_, ret);
+  if (err == SSL_ERROR_WANT_READ || err == SSL_ERROR_WANT_WRITE) {
+    return TLS_AGAIN;
+  }
+  if (err == SSL_ERROR_ZERO_RETURN) {
+    return 0;
+  }
+  if (err == SSL_ERROR_SYSCALL && ERR_peek_error() == 0) {
+    // 对端没有发送close_notify直接关闭
+    return 0;
+  }
+  PrintTlsError("SSL_read");
+  return -1;
+}
+
+bool TlsSession::Pending() const { return SSL_pending(ssl_) > 0; }
+
+int TlsSession::Write(const char* buf, int len) {
+  int ret = SSL_write(ssl_, buf, len);
+  if (ret > 0) {
+    return ret;
+  }
+  int err = SSL_get_error(ssl_, ret);
+  if (err == SSL_ERROR_WANT_READ || err == SSL_ERROR_WANT_WRITE) {
+    return 0;
+  }
+  PrintTlsError("SSL_write");
+  return -1;
+}
+
+#else
+
+TlsContext::~TlsContext() {}
+
+std::unique_ptr<TlsContext> TlsContext::CreateServer(const std::string&,
+                                                     const std::string&) {
+  std::cerr << "tls support is not compiled in!\n";
+  return nullptr;
+}
+
+std::unique_ptr<TlsContext> TlsContext::CreateServerFromPem(const std::string&,
+                                                            const std::string&) {
+  std::cerr << "tls support is not compiled in!\n";
+  return nullptr;
+}
+
+std::unique_ptr<TlsContext> TlsContext::CreateClient(const std::string&) {
+  std::cerr << "tls support is not compiled in!\n";
+  return nullptr;
+}
+
+std::unique_ptr<TlsContext> TlsContext::CreateInsecureClient() {
+  std::cerr << "tls support is not compiled in!\n";
+  return nullptr;
+}
+
+void TlsContext::LimitTls12() {}
+
+TlsSession::TlsSession(TlsContext*, int, bool) {}
+
+TlsSession::~TlsSession() {}
+
+bool TlsSession::SetPeerName(const std::string&) { return false; }
+
+int TlsSession::Handshake() { return -1; }
+
+int TlsSession::Read(char*, int) { return -1; }
+
+bool TlsSession::Pending() const { return false; }
+
+int TlsSession::Write(const char*, int) { return -1; }
+
+#endif
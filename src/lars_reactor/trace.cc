@@ -0,0 +1,197 @@
+#include "lars_reactor/trace.h"
+
+#include <pthread.h>
+#include <sys/signalfd.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <csignal>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "lars_reactor/event_loop.h"
+#include "lars_reactor/msg_router.h"
+#include "lars_reactor/net_connection.h"
+
+//导出时换算tsc频率至少需要的采样时间(ns)
+#define TRACE_CALIBRATE_NS (10 * 1000000UL)
+
+struct TraceEvent {
+  /// span名，静态字符串
+  const char* name_;
+  /// 附带的整数参数
+  int arg_;
+  /// 开始和结束时间(TraceClock)
+  uint64_t begin_;
+  uint64_t end_;
+};
+
+// 一个线程的span环形缓冲区，只有所属线程写入
+struct TraceBuffer {
+  /// 所属线程id
+  int tid_;
+  /// 已经写入的span总数，release保证导出线程看到完整的记录
+  std::atomic<uint64_t> pos_{0};
+  TraceEvent events_[TRACE_BUFFER_SIZE];
+};
+
+// 所有线程的缓冲区，线程退出后缓冲区保留，仍然可以导出
+struct TraceRegistry {
+  TraceRegistry() {
+    base_tsc_ = TraceClock();
+    base_ns_ = EventLoop::ClockNs();
+  }
+
+  std::mutex mutex_;
+  std::vector<std::unique_ptr<TraceBuffer>> buffers_;
+  /// 时间基准，导出时用来换算tsc频率
+  uint64_t base_tsc_;
+  uint64_t base_ns_;
+  std::string dump_path_ = "/tmp/lars_trace.json";
+};
+
+static_assert((TRACE_BUFFER_SIZE & (TRACE_BUFFER_SIZE - 1)) == 0,
+              "TRACE_BUFFER_SIZE must be a power of 2");
+
+static TraceRegistry& Registry() {
+  static TraceRegistry registry;
+  return registry;
+}
+
+static thread_local TraceBuffer* t_trace_buffer = nullptr;
+
+static TraceBuffer* NewTraceBuffer() {
+  TraceRegistry& registry = Registry();
+  std::unique_ptr<TraceBuffer> buffer(new TraceBuffer());
+  buffer->tid_ = static_cast<int>(syscall(SYS_gettid));
+  TraceBuffer* ret = buffer.get();
+  std::lock_guard<std::mutex> lock(registry.mutex_);
+  registry.buffers_.push_back(std::move(buffer));
+  return ret;
+}
+
+void Tracer::Record(const char* name, int arg, uint64_t begin, uint64_t end) {
+  TraceBuffer* buffer = t_trace_buffer;
+  if (buffer == nullptr) {
+    buffer = t_trace_buffer = NewTraceBuffer();
+  }
+  uint64_t pos = buffer->pos_.load(std::memory_order_relaxed);
+  TraceEvent& event = buffer->events_[pos & (TRACE_BUFFER_SIZE - 1)];
+  event.name_ = name;
+  event.arg_ = arg;
+  event.begin_ = begin;
+  event.end_ = end;
+  buffer->pos_.store(pos + 1, std::memory_order_release);
+}
+
+int Tracer::Dump(const std::string& path) {
+  TraceRegistry& registry = Registry();
+  uint64_t now_ns = EventLoop::ClockNs();
+  if (now_ns - registry.base_ns_ < TRACE_CALIBRATE_NS) {
+    usleep((TRACE_CALIBRATE_NS - (now_ns - registry.base_ns_)) / 1000 + 1);
+    now_ns = EventLoop::ClockNs();
+  }
+  uint64_t now_tsc = TraceClock();
+  double ticks_per_us = static_cast<double>(now_tsc - registry.base_tsc_) *
+                        1000.0 / static_cast<double>(now_ns - registry.base_ns_);
+
+  FILE* fp = fopen(path.c_str(), "w");
+  if (fp == nullptr) {
+    std::cerr << "open trace file " << path << " error!\n";
+    return -1;
+  }
+  int pid = getpid();
+  int count = 0;
+  std::vector<TraceEvent> events;
+  fprintf(fp, "{\"traceEvents\":[");
+  std::lock_guard<std::mutex> lock(registry.mutex_);
+  for (auto& buffer : registry.buffers_) {
+    uint64_t end = buffer->pos_.load(std::memory_order_acquire);
+    uint64_t begin = end > TRACE_BUFFER_SIZE ? end - TRACE_BUFFER_SIZE : 0;
+    events.clear();
+    for (uint64_t i = begin; i < end; ++i) {
+      events.push_back(buffer->events_[i & (TRACE_BUFFER_SIZE - 1)]);
+    }
+    // 复制期间写线程可能覆盖了最旧的记录，丢弃这部分；写线程可能正在写
+    // 下标after的槽位，它和after - TRACE_BUFFER_SIZE是同一个槽位，也要丢弃
+    uint64_t after = buffer->pos_.load(std::memory_order_acquire);
+    uint64_t valid =
+        after + 1 > TRACE_BUFFER_SIZE ? after + 1 - TRACE_BUFFER_SIZE : 0;
+    for (uint64_t i = std::max(begin, valid); i < end; ++i) {
+      const TraceEvent& event = events[i - begin];
+      double ts = static_cast<double>(static_cast<int64_t>(
+                      event.begin_ - registry.base_tsc_)) /
+                  ticks_per_us;
+      double dur = static_cast<double>(event.end_ - event.begin_) / ticks_per_us;
+      // span名都是代码中的标识符，不需要转义
+      fprintf(fp,
+              "%s{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+              "\"pid\":%d,\"tid\":%d,\"args\":{\"arg\":%d}}",
+              count == 0 ? "" : ",", event.name_, ts, dur, pid, buffer->tid_,
+              event.arg_);
+      ++count;
+    }
+  }
+  fprintf(fp, "],\"displayTimeUnit\":\"ns\"}\n");
+  if (fclose(fp) != 0) {
+    std::cerr << "write trace file " << path << " error!\n";
+    return -1;
+  }
+  return count;
+}
+
+void Tracer::SetDumpPath(const std::string& path) {
+  TraceRegistry& registry = Registry();
+  std::lock_guard<std::mutex> lock(registry.mutex_);
+  registry.dump_path_ = path;
+}
+
+std::string Tracer::GetDumpPath() {
+  TraceRegistry& registry = Registry();
+  std::lock_guard<std::mutex> lock(registry.mutex_);
+  return registry.dump_path_;
+}
+
+// signalfd的读事件回调
+auto trace_signal_callback = [](EventLoop* loop, int fd, void* args) {
+  struct signalfd_siginfo info {};
+  while (read(fd, &info, sizeof(info)) == sizeof(info)) {
+  }
+  std::string path = Tracer::GetDumpPath();
+  int count = Tracer::Dump(path);
+  std::cout << "dump " << count << " trace spans to " << path << "\n";
+};
+
+bool Tracer::DumpOnSignal(EventLoop* loop, int signo) {
+  sigset_t mask;
+  sigemptyset(&mask);
+  sigaddset(&mask, signo);
+  // 之后创建的线程继承信号屏蔽字，信号只会通过signalfd送达
+  if (pthread_sigmask(SIG_BLOCK, &mask, nullptr) != 0) {
+    std::cerr << "block signal " << signo << " error!\n";
+    return false;
+  }
+  // signalfd跟随进程存在，不关闭
+  int fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+  if (fd == -1) {
+    std::cerr << "signalfd error!\n";
+    return false;
+  }
+  loop->AddIoEvent(fd, trace_signal_callback, EPOLLIN, nullptr);
+  return true;
+}
+
+int Tracer::AddDumpRouter(MsgRouter* router, int msg_id) {
+  return router->Register(msg_id, [](const char* data, int len, int msg_id,
+                                     void* args, NetConnection* conn) {
+    std::string path = GetDumpPath();
+    if (Dump(path) == -1) {
+      path.clear();
+    }
+    conn->SendMessage(path.data(), static_cast<int>(path.size()), msg_id);
+  });
+}
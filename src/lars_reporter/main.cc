@@ -0,0 +1,40 @@
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "lars_reporter/report_service.h"
+
+// lars_reporter log_dir [ip] [port] [threads] [writers]
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    std::cerr << "usage: " << argv[0]
+              << " log_dir [ip] [port] [threads] [writers]\n";
+    return 1;
+  }
+  ReporterConfig config;
+  config.log_dir_ = argv[1];
+  const char* ip = argc > 2 ? argv[2] : "127.0.0.1";
+  uint16_t port = argc > 3 ? static_cast<uint16_t>(atoi(argv[3])) : 7779;
+  int threads = argc > 4 ? atoi(argv[4]) : 2;
+  if (argc > 5) {
+    config.writer_num_ = atoi(argv[5]);
+  }
+
+  Reporter reporter(config);
+  if (reporter.Start() == -1) {
+    return 1;
+  }
+  std::vector<std::thread> loops;
+  for (int i = 0; i < threads; ++i) {
+    loops.emplace_back([&reporter, ip, port]() {
+      EventLoop loop;
+      ReportService service(&reporter, &loop, ip, port);
+      loop.EventProcess();
+    });
+  }
+  for (auto& t : loops) {
+    t.join();
+  }
+  return 0;
+}
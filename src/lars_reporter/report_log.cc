@@ -0,0 +1,108 @@
+#include "lars_reporter/report_log.h"
+
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <fstream>
+#include <iostream>
+
+#include "lars_reactor/checksum.h"
+
+ReportLog::~ReportLog() { Close(); }
+
+int ReportLog::Open(const std::string& path) {
+  Close();
+  fd_ = open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+  if (fd_ == -1) {
+    std::cerr << "open report log " << path << " error!\n";
+    return -1;
+  }
+  // 之后写坏的批次截断回这个位置
+  offset_ = lseek(fd_, 0, SEEK_END);
+  if (offset_ == -1) {
+    std::cerr << "seek report log " << path << " error!\n";
+    Close();
+    return -1;
+  }
+  return 0;
+}
+
+void ReportLog::Close() {
+  if (fd_ != -1) {
+    close(fd_);
+    fd_ = -1;
+  }
+}
+
+int ReportLog::Append(const ReportRecord* records, uint32_t count, bool sync) {
+  size_t len = count * sizeof(ReportRecord);
+  ReportBatchHeader header{REPORT_BATCH_MAGIC, count,
+                           Checksum(reinterpret_cast<const char*>(records),
+                                    len)};
+  // 头部和记录一次系统调用写入
+  struct iovec iov[2];
+  iov[0].iov_base = &header;
+  iov[0].iov_len = sizeof(header);
+  iov[1].iov_base = const_cast<ReportRecord*>(records);
+  iov[1].iov_len = len;
+  size_t total = sizeof(header) + len;
+  ssize_t ret;
+  do {
+    ret = writev(fd_, iov, 2);
+  } while (ret == -1 && errno == EINTR);
+  if (ret != static_cast<ssize_t>(total)) {
+    std::cerr << "write report log error!\n";
+    ++dropped_;
+    // 部分写入的批次会让后面的批次都读不出来，截断回上一个完整批次
+    if (ret > 0 && ftruncate(fd_, offset_) == -1) {
+      std::cerr << "truncate report log error!\n";
+    }
+    return -1;
+  }
+  offset_ += ret;
+  // 组提交：整个批次只做一次fdatasync
+  if (sync && fdatasync(fd_) == -1) {
+    std::cerr << "fdatasync report log error!\n";
+    return -1;
+  }
+  return 0;
+}
+
+int ReportLog::Read(const std::string& path,
+                    std::vector<ReportRecord>* records) {
+  std::ifstream in(path, std::ios::binary | std::ios::ate);
+  if (!in) {
+    return -1;
+  }
+  // 文件剩余长度，批次头中的记录数不能超过它
+  uint64_t remain = static_cast<uint64_t>(in.tellg());
+  in.seekg(0);
+  int num = 0;
+  ReportBatchHeader header{};
+  std::vector<ReportRecord> batch;
+  while (in.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+    if (header.magic_ != REPORT_BATCH_MAGIC) {
+      std::cerr << "report log " << path << " bad batch magic!\n";
+      break;
+    }
+    remain -= sizeof(header);
+    if (header.count_ > remain / sizeof(ReportRecord)) {
+      // 记录数损坏或最后一个批次没有写完整
+      break;
+    }
+    batch.resize(header.count_);
+    size_t len = header.count_ * sizeof(ReportRecord);
+    remain -= len;
+    if (!in.read(reinterpret_cast<char*>(batch.data()), len) ||
+        Checksum(reinterpret_cast<const char*>(batch.data()), len) !=
+            header.checksum_) {
+      // 最后一个批次可能没有写完整
+      break;
+    }
+    records->insert(records->end(), batch.begin(), batch.end());
+    num += static_cast<int>(header.count_);
+  }
+  return num;
+}
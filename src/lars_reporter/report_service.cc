@@ -0,0 +1,54 @@
+#include "lars_reporter/report_service.h"
+
+#include <cstring>
+#include <ctime>
+#include <iostream>
+
+#include "lars_reporter/report_proto.h"
+
+// 上报请求的回调
+auto report_status_callback = [](const char* data, int len, int msg_id,
+                                 void* args, NetConnection* conn) {
+  auto service = static_cast<ReportService*>(args);
+  service->ReportStatus(data, len);
+};
+
+ReportService::ReportService(Reporter* reporter, EventLoop* loop,
+                             const char* ip, uint16_t port)
+    : reporter_(reporter), server_(loop, ip, port, true) {
+  server_.AddMsgRouter(ID_REPORT_STATUS_REQUEST, report_status_callback, this);
+}
+
+void ReportService::ReportStatus(const char* data, int len) {
+  ReportStatusRequest req{};
+  if (len < static_cast<int>(sizeof(req))) {
+    std::cerr << "report status request format error, len: " << len
+              << std::endl;
+    return;
+  }
+  memcpy(&req, data, sizeof(req));
+  if (req.result_num_ < 0 ||
+      len != static_cast<int>(sizeof(req) +
+                              req.result_num_ * sizeof(HostCallResult))) {
+    std::cerr << "report status request format error, len: " << len
+              << std::endl;
+    return;
+  }
+  ReportRecord record{};
+  record.ts_ = time(nullptr);
+  record.modid_ = req.modid_;
+  record.cmdid_ = req.cmdid_;
+  record.caller_ = req.caller_;
+  const char* result_data = data + sizeof(req);
+  for (int i = 0; i < req.result_num_; ++i) {
+    HostCallResult result{};
+    memcpy(&result, result_data + i * sizeof(result), sizeof(result));
+    record.ip_ = result.ip_;
+    record.port_ = result.port_;
+    record.succ_ = result.succ_;
+    record.err_ = result.err_;
+    record.overload_ = result.overload_;
+    // 队列满时丢弃，不阻塞event_loop
+    reporter_->Submit(record);
+  }
+}
@@ -0,0 +1,107 @@
+#include "lars_reporter/reporter.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "lars_reactor/event_loop.h"
+
+Reporter::Reporter(const ReporterConfig& config)
+    : config_(config), queue_(config.queue_size_), running_(false) {}
+
+Reporter::~Reporter() { Stop(); }
+
+int Reporter::Start() {
+  if (running_) {
+    return 0;
+  }
+  for (int i = 0; i < config_.writer_num_; ++i) {
+    std::unique_ptr<ReportLog> log(new ReportLog);
+    if (log->Open(config_.log_dir_ + "/report." + std::to_string(i) +
+                  ".log") == -1) {
+      logs_.clear();
+      return -1;
+    }
+    logs_.push_back(std::move(log));
+  }
+  running_ = true;
+  for (int i = 0; i < config_.writer_num_; ++i) {
+    writers_.emplace_back(&Reporter::Run, this, i);
+  }
+  return 0;
+}
+
+void Reporter::Stop() {
+  if (!running_.exchange(false)) {
+    return;
+  }
+  for (auto& writer : writers_) {
+    writer.join();
+  }
+  writers_.clear();
+  logs_.clear();
+}
+
+bool Reporter::Submit(const ReportRecord& record) {
+  ++stats_.submitted_;
+  if (!queue_.Push(record)) {
+    ++stats_.dropped_;
+    return false;
+  }
+  return true;
+}
+
+void Reporter::Flush(ReportLog* log, std::vector<ReportRecord>* batch) {
+  if (batch->empty()) {
+    return;
+  }
+  if (log->Append(batch->data(), static_cast<uint32_t>(batch->size()),
+                  config_.sync_) == 0) {
+    stats_.written_ += batch->size();
+    ++stats_.batches_;
+  } else {
+    ++stats_.failed_batches_;
+    stats_.failed_ += batch->size();
+  }
+  batch->clear();
+}
+
+void Reporter::Run(int index) {
+  ReportLog* log = logs_[index].get();
+  std::vector<ReportRecord> batch;
+  batch.reserve(config_.batch_size_);
+  uint64_t latency_ns = static_cast<uint64_t>(config_.max_latency_ms_) * 1000000;
+  // 批次中第一条记录的入队时间
+  uint64_t first_ns = 0;
+  int idle_rounds = 0;
+  ReportRecord record{};
+  while (true) {
+    bool stopping = !running_;
+    if (queue_.Pop(&record)) {
+      if (batch.empty()) {
+        first_ns = EventLoop::ClockNs();
+      }
+      batch.push_back(record);
+      idle_rounds = 0;
+      if (static_cast<int>(batch.size()) >= config_.batch_size_) {
+        Flush(log, &batch);
+      }
+      continue;
+    }
+    // 队列已空
+    if (stopping) {
+      Flush(log, &batch);
+      break;
+    }
+    if (!batch.empty() && EventLoop::ClockNs() - first_ns >= latency_ns) {
+      Flush(log, &batch);
+    }
+    // 逐步退避，空闲时不占满cpu，等待时间不超过延迟上限
+    ++idle_rounds;
+    if (idle_rounds > 64) {
+      int sleep_us = std::min(idle_rounds, config_.max_latency_ms_ * 100);
+      std::this_thread::sleep_for(std::chrono::microseconds(sleep_us));
+    } else {
+      std::this_thread::yield();
+    }
+  }
+}
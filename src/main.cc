@@ -1,8 +1,64 @@
+#include <unistd.h>
+
+#include <csignal>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "lars_reactor/buffer_pool.h"
+#include "lars_reactor/hot_restart.h"
+#include "lars_reactor/profiler.h"
 #include "lars_reactor/tcp_server.h"
+#include "lars_reactor/trace.h"
+
+//热重启交接监听fd的unix socket
+#define LARS_REACTOR_RESTART_PATH "/tmp/lars_reactor.sock"
+//管理端口，只监听本机，导出trace等运维请求不注册在业务端口上
+#define LARS_REACTOR_ADMIN_PORT 8081
 
 int main() {
+  // 先预热内存池，这期间旧进程仍在accept和服务；多numa节点时构造不预分配，
+  // 需要显式WarmUp
+  BufferPool::instance().WarmUp();
   EventLoop loop;
-  TcpServer server(&loop, "127.0.0.1", 8080);
+  std::unique_ptr<TcpServer> server;
+  std::unique_ptr<TcpServer> admin;
+  std::vector<int> fds;
+  int ret = HotRestart::Inherit(LARS_REACTOR_RESTART_PATH, &fds);
+  if (ret == 0 && (fds.size() == 1 || fds.size() == 2)) {
+    // 按AddServer的顺序交出，旧版本的进程只有业务端口
+    server.reset(new TcpServer(&loop, fds[0]));
+    if (fds.size() == 2) {
+      admin.reset(new TcpServer(&loop, fds[1]));
+    } else {
+      admin.reset(new TcpServer(&loop, "127.0.0.1", LARS_REACTOR_ADMIN_PORT));
+    }
+  } else if (ret == -1) {
+    // 没有旧进程，冷启动
+    server.reset(new TcpServer(&loop, "127.0.0.1", 8080));
+    admin.reset(new TcpServer(&loop, "127.0.0.1", LARS_REACTOR_ADMIN_PORT));
+  } else {
+    // 旧进程已经交出(或正在交出)监听fd，再自己监听只会和它抢端口
+    for (int fd : fds) {
+      close(fd);
+    }
+    std::cerr << "hot restart handoff error, got " << fds.size()
+              << " listen fds!\n";
+    return 1;
+  }
+  HotRestart restart(&loop, LARS_REACTOR_RESTART_PATH);
+  restart.AddServer(server.get());
+  restart.AddServer(admin.get());
+  restart.Listen();
+  // SIGUSR2或管理端口上的TRACE_DUMP_ID请求导出trace(编译时开启LARS_TRACE才有span)
+  Tracer::DumpOnSignal(&loop, SIGUSR2);
+#ifdef LARS_WITH_TRACE
+  Tracer::AddDumpRouter(&admin->GetRouter());
+#endif
+  // 按1/PROFILE_DEFAULT_RATE采样业务回调开销，管理端口上的PROFILE_DUMP_ID请求报告
+  HandlerProfiler profiler;
+  server->GetRouter().SetProfiler(&profiler);
+  profiler.AddDumpRouter(&admin->GetRouter());
   loop.EventProcess();
   return 0;
-}
\ No newline at end of file
+}
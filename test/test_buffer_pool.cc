@@ -2,6 +2,7 @@
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "lars_reactor/buffer_pool.h"
+#include "lars_reactor/event_loop.h"
 
 // 测试 BufferPool 的 AllocBuffer 函数
 TEST(BufferPoolTest, AllocBufferTest) {
@@ -175,3 +176,53 @@ TEST_F(MultiThreadBufferPoolTest, MultiThreadAllocBufferTest) {
   ASSERT_EQ(buffers_.size(), 1000);
 }
 
+
+// 测试未设置numa节点时，默认使用node 0的内存池
+TEST(BufferPoolTest, DefaultNumaNodeTest) {
+  EXPECT_EQ(&BufferPool::instance(), &BufferPool::instance(0));
+  EXPECT_EQ(BufferPool::instance().GetNode(), 0);
+
+  auto buffer = BufferPool::instance().AllocBuffer();
+  ASSERT_NE(buffer, nullptr);
+  EXPECT_EQ(buffer->GetNode(), 0);
+  BufferPool::instance().revert(buffer);
+}
+
+// 测试非默认节点的内存池在WarmUp之前按需分配，WarmUp预分配每个规格
+TEST(BufferPoolTest, LazyNodePoolTest) {
+  BufferPool& pool = BufferPool::instance(MAX_NUMA_NODES - 1);
+  EXPECT_TRUE(pool.GetPool().empty());
+
+  auto buffer = pool.AllocBuffer(m16K);
+  ASSERT_NE(buffer, nullptr);
+  EXPECT_EQ(buffer->GetNode(), MAX_NUMA_NODES - 1);
+  EXPECT_EQ(pool.GetPool()[m16K], nullptr);
+  pool.revert(buffer);
+
+  pool.WarmUp();
+  pool_t lists = pool.GetPool();
+  for (MEM_CAP size : {m4K, m16K, m64K, m256K, m1M, m4M, m8M}) {
+    int count = 0;
+    for (auto cur = lists[size]; cur != nullptr; cur = cur->GetNext()) {
+      ++count;
+    }
+    // 已经有空闲buffer的规格不再预分配
+    EXPECT_EQ(count, size == m16K ? 1 : BufferPool::PreAllocNum(size));
+  }
+}
+
+// 测试绑核时拒绝超出cpu_set_t范围的cpu编号
+TEST(NumaTopologyTest, BindCpuRangeTest) {
+  EventLoop loop;
+  EXPECT_FALSE(loop.BindCpu(-1));
+  EXPECT_FALSE(loop.BindCpu(CPU_SETSIZE));
+  EXPECT_FALSE(loop.BindCpuSet({0, CPU_SETSIZE + 1}));
+}
+
+// 测试cpu列表的解析
+TEST(NumaTopologyTest, ParseCpuListTest) {
+  std::vector<int> cpus = NumaTopology::ParseCpuList("0-2,5,8-9\n");
+  std::vector<int> expect = {0, 1, 2, 5, 8, 9};
+  EXPECT_EQ(cpus, expect);
+  EXPECT_GE(NumaTopology::instance().NodeCount(), 1);
+}
@@ -0,0 +1,208 @@
+#include <unistd.h>
+
+#include <random>
+#include <string>
+#include <vector>
+#include "gtest/gtest.h"
+#include "lars_reactor/lz_codec.h"
+#include "test_helper.h"
+
+// 可压缩的消息体，重复的字段名和少量变化的值
+static std::string MakeBody(int len) {
+  std::string body;
+  for (int i = 0; static_cast<int>(body.size()) < len; ++i) {
+    body += "{\"host\":\"10.0.0." + std::to_string(i % 7) + "\",\"port\":8080}";
+  }
+  body.resize(len);
+  return body;
+}
+
+// 测试压缩和解压
+TEST(CompressionTest, CodecTest) {
+  std::mt19937 rng(7);
+  std::string random(5000, 0);
+  for (auto& c : random) {
+    c = static_cast<char>(rng());
+  }
+  for (const std::string& src :
+       {MakeBody(60000), random, std::string(3000, 'a'), std::string("abc"),
+        std::string()}) {
+    std::vector<char> dst(LzCodec::Bound(src.size()));
+    int len = LzCodec::Compress(src.data(), src.size(), dst.data(), dst.size());
+    ASSERT_GT(len, 0);
+    std::vector<char> out(src.size() + 1);
+    ASSERT_EQ(LzCodec::Decompress(dst.data(), len, out.data(), src.size()),
+              src.size());
+    EXPECT_EQ(std::string(out.data(), src.size()), src);
+  }
+
+  // 可压缩的数据明显变小，空间不够时返回0
+  std::string body = MakeBody(60000);
+  std::vector<char> dst(LzCodec::Bound(body.size()));
+  int len = LzCodec::Compress(body.data(), body.size(), dst.data(), dst.size());
+  EXPECT_LT(len, body.size() / 4);
+  EXPECT_EQ(LzCodec::Compress(body.data(), body.size(), dst.data(), len - 1),
+            0);
+
+  // 损坏的数据和不够的输出空间返回-1
+  std::vector<char> out(body.size());
+  EXPECT_EQ(LzCodec::Decompress(dst.data(), len, out.data(), body.size() - 1),
+            -1);
+  EXPECT_EQ(LzCodec::Decompress(dst.data(), len / 2, out.data(), body.size()),
+            -1);
+  char bad[] = {0x00, 0x10, 0x00};
+  EXPECT_EQ(LzCodec::Decompress(bad, sizeof(bad), out.data(), out.size()), -1);
+}
+
+// 测试协商之后大消息压缩发送，小消息和未协商时原样发送
+TEST(CompressionTest, WireTest) {
+  EventLoop loop;
+  int peer;
+  auto conn = MakeConnPair(&loop, &peer);
+  ASSERT_NE(conn, nullptr);
+  conn->EnableCompression(1024);
+  conn->DoWrite();
+  std::vector<char> buf(1 << 17);
+  ASSERT_EQ(read(peer, buf.data(), buf.size()), MESSAGE_HEAD_LEN + 8);
+  MsgHead head = DecodeHead(buf.data());
+  EXPECT_EQ(head.msg_id_, COMPRESS_NEGOTIATE_ID);
+
+  // 对端回显的协商消息不算开启
+  ASSERT_EQ(write(peer, buf.data(), MESSAGE_HEAD_LEN + 8),
+            MESSAGE_HEAD_LEN + 8);
+  conn->DoRead();
+  EXPECT_FALSE(conn->PeerCompression());
+  std::string body = MakeBody(20000);
+  conn->SendMessage(body.data(), body.size(), 1);
+  conn->DoWrite();
+  ASSERT_EQ(read(peer, buf.data(), buf.size()),
+            MESSAGE_HEAD_LEN + body.size());
+
+  char nonce[8];
+  StoreLE<uint64_t>(nonce, 12345);
+  std::string offer = MakeMsg(COMPRESS_NEGOTIATE_ID, std::string(nonce, 8));
+  ASSERT_EQ(write(peer, offer.data(), offer.size()), offer.size());
+  conn->DoRead();
+  EXPECT_TRUE(conn->PeerCompression());
+
+  conn->SendMessage(body.data(), body.size(), 1);
+  conn->DoWrite();
+  int n = read(peer, buf.data(), buf.size());
+  ASSERT_GT(n, MESSAGE_HEAD_LEN + COMPRESS_HEAD_LEN);
+  EXPECT_LT(n, body.size() / 4);
+  head = DecodeHead(buf.data());
+  EXPECT_EQ(head.msg_id_, 1);
+  ASSERT_TRUE(head.msg_len_ & MSG_FLAG_COMPRESSED);
+  int len = head.msg_len_ & ~MSG_FLAG_COMPRESSED;
+  EXPECT_EQ(n, MESSAGE_HEAD_LEN + len);
+  const char* payload = buf.data() + MESSAGE_HEAD_LEN;
+  EXPECT_EQ(LoadLE<uint32_t>(payload), body.size());
+  std::vector<char> out(body.size());
+  ASSERT_EQ(LzCodec::Decompress(payload + COMPRESS_HEAD_LEN,
+                                len - COMPRESS_HEAD_LEN, out.data(),
+                                out.size()),
+            body.size());
+  EXPECT_EQ(std::string(out.data(), out.size()), body);
+
+  // 小于阈值原样发送
+  conn->SendMessage(body.data(), 100, 2);
+  conn->DoWrite();
+  ASSERT_EQ(read(peer, buf.data(), buf.size()), MESSAGE_HEAD_LEN + 100);
+  EXPECT_EQ(DecodeHead(buf.data()).msg_len_, 100);
+
+  conn->CleanConn();
+  close(peer);
+}
+
+// 测试两端都开启压缩时消息收发，损坏的压缩帧关闭连接
+TEST(CompressionTest, ConnTest) {
+  EventLoop loop;
+  MsgRouter router;
+  std::vector<std::string> received;
+  router.Register(1, [&received](const char* data, int len, int msg_id,
+                                 void* args, NetConnection* conn) {
+    received.emplace_back(data, len);
+  });
+  int peer;
+  auto client = MakeConnPair(&loop, &peer);
+  ASSERT_NE(client, nullptr);
+  auto server = MakeConn(peer, &loop);
+  client->SetRouter(&router);
+  server->SetRouter(&router);
+  client->EnableCompression(512);
+  server->EnableCompression(512);
+  client->DoWrite();
+  server->DoWrite();
+  client->DoRead();
+  server->DoRead();
+  ASSERT_TRUE(client->PeerCompression());
+  ASSERT_TRUE(server->PeerCompression());
+
+  std::string body = MakeBody(30000);
+  client->SendMessage(body.data(), body.size(), 1);
+  client->SendMessage("small", 5, 1);
+  client->DoWrite();
+  server->DoRead();
+  ASSERT_EQ(received.size(), 2);
+  EXPECT_EQ(received[0], body);
+  EXPECT_EQ(received[1], "small");
+
+  // 原始长度与解压结果不一致
+  std::string bad(COMPRESS_HEAD_LEN, 0);
+  StoreLE<uint32_t>(&bad[0], 100);
+  bad += std::string(1, 0x10) + "x";
+  bad = MakeFrame(1, static_cast<int>(bad.size()) | MSG_FLAG_COMPRESSED, bad);
+  ASSERT_EQ(write(client->GetFd(), bad.data(), bad.size()), bad.size());
+  server->DoRead();
+  EXPECT_EQ(server->GetFd(), -1);
+  EXPECT_EQ(received.size(), 2);
+
+  client->CleanConn();
+}
+
+// 测试按压缩的最大长度预留obuf失败时原样发送
+TEST(CompressionTest, ReserveFallbackTest) {
+  EventLoop loop;
+  int peer;
+  auto conn = MakeConnPair(&loop, &peer);
+  ASSERT_NE(conn, nullptr);
+  ASSERT_TRUE(conn->EnableRingBuffer(64 * 1024));
+  conn->EnableCompression(10000);
+  conn->DoWrite();
+  std::vector<char> buf(1 << 17);
+  ASSERT_EQ(read(peer, buf.data(), buf.size()), MESSAGE_HEAD_LEN + 8);
+  char nonce[8];
+  StoreLE<uint64_t>(nonce, 12345);
+  std::string offer = MakeMsg(COMPRESS_NEGOTIATE_ID, std::string(nonce, 8));
+  ASSERT_EQ(write(peer, offer.data(), offer.size()), offer.size());
+  conn->DoRead();
+  ASSERT_TRUE(conn->PeerCompression());
+
+  // 环中剩余的空间够原样发送，不够压缩预留的最大长度
+  std::mt19937 rng(7);
+  std::string body(60000, 0);
+  for (auto& c : body) {
+    c = static_cast<char>(rng());
+  }
+  int room = 60100;
+  std::string filler(64 * 1024 - room - MESSAGE_HEAD_LEN, 'f');
+  ASSERT_EQ(conn->SendMessage(filler.data(), filler.size(), 2), 0);
+  ASSERT_GT(MESSAGE_HEAD_LEN + COMPRESS_HEAD_LEN + LzCodec::Bound(body.size()),
+            room);
+  ASSERT_EQ(conn->SendMessage(body.data(), body.size(), 1), 0);
+  conn->DoWrite();
+  size_t total = 2 * MESSAGE_HEAD_LEN + filler.size() + body.size();
+  size_t n = 0;
+  while (n < total) {
+    ssize_t ret = read(peer, buf.data() + n, buf.size() - n);
+    ASSERT_GT(ret, 0);
+    n += ret;
+    conn->DoWrite();
+  }
+  const char* msg = buf.data() + MESSAGE_HEAD_LEN + filler.size();
+  EXPECT_EQ(DecodeHead(msg).msg_len_, body.size());
+  EXPECT_EQ(std::string(msg + MESSAGE_HEAD_LEN, body.size()), body);
+
+  conn->CleanConn();
+  close(peer);
+}
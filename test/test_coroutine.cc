@@ -0,0 +1,119 @@
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <string>
+#include <thread>
+#include "gtest/gtest.h"
+#include "lars_reactor/coroutine.h"
+#include "lars_reactor/rpc_server.h"
+#include "lars_reactor/shm_channel.h"
+
+// 在一对进程内的共享内存通道上测试协程
+class CoroutineTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    int fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    server_ = ShmChannel::Create(&loop_, &server_router_, 64 * 1024);
+    ASSERT_NE(server_, nullptr);
+    ASSERT_EQ(server_->SendFds(fds[0]), 0);
+    close(fds[0]);
+    client_ = ShmChannel::RecvFds(fds[1], &loop_, &client_router_);
+    ASSERT_NE(client_, nullptr);
+  }
+
+  EventLoop loop_;
+  MsgRouter server_router_;
+  MsgRouter client_router_;
+  std::unique_ptr<ShmChannel> server_;
+  std::unique_ptr<ShmChannel> client_;
+};
+
+// 读两条消息后回复它们的拼接
+Task Concat(CoMailbox* mailbox, std::string* out) {
+  CoMessage first = co_await AsyncReadMessage(mailbox);
+  CoMessage second = co_await AsyncReadMessage(mailbox);
+  *out = first.data_ + second.data_;
+  co_await AsyncSend(second.conn_, out->data(), static_cast<int>(out->size()), 2);
+}
+
+// 测试等待消息和排队的消息
+TEST_F(CoroutineTest, ReadMessageTest) {
+  CoMailbox mailbox(&server_router_, 1);
+  CoMailbox replies(&client_router_, 2);
+  std::string out;
+  client_->SendMessage("ab", 2, 1);
+  server_->DoRead();
+  EXPECT_EQ(mailbox.GetQueuedNum(), 1);
+
+  // 第一条消息已经排队，第二条消息到达时恢复协程
+  Concat(&mailbox, &out);
+  EXPECT_EQ(mailbox.GetQueuedNum(), 0);
+  EXPECT_TRUE(out.empty());
+  client_->SendMessage("cd", 2, 1);
+  server_->DoRead();
+  EXPECT_EQ(out, "abcd");
+
+  client_->DoRead();
+  EXPECT_EQ(replies.GetQueuedNum(), 1);
+}
+
+// 收到请求，调用上游，再回复
+Task Proxy(EventLoop* loop, RpcClient* upstream, std::string* out) {
+  co_await SleepFor(loop, 1);
+  RpcResult result = co_await AsyncCall(upstream, 1, "q", 1, 100);
+  *out = std::to_string(result.status_) + ":" + result.data_;
+  loop->Stop();
+}
+
+// 测试在事件循环中睡眠和等待上游响应
+TEST_F(CoroutineTest, CallTest) {
+  RpcServer rpc_server(&loop_, &server_router_);
+  rpc_server.Register(1, [](const char* data, int len, const RpcContext& ctx) {
+    ctx.Reply("answer", 6);
+  });
+  RpcClient rpc_client(&loop_, client_.get(), &client_router_);
+  std::string out;
+  Proxy(&loop_, &rpc_client, &out);
+  loop_.EventProcess();
+  EXPECT_EQ(out, "0:answer");
+}
+
+// 读一条消息，睡眠之后再回复，记录发送结果
+Task ReplyLater(EventLoop* loop, CoMailbox* mailbox, int* ret) {
+  CoMessage message = co_await AsyncReadMessage(mailbox);
+  co_await SleepFor(loop, 1);
+  *ret = co_await AsyncSend(message.conn_, "late", 4, 2);
+  loop->Stop();
+}
+
+// 测试协程挂起期间连接被释放，恢复后发送失败而不是访问已释放的连接
+TEST_F(CoroutineTest, ConnClosedTest) {
+  CoMailbox mailbox(&server_router_, 1);
+  int ret = 0;
+  ReplyLater(&loop_, &mailbox, &ret);
+  client_->SendMessage("ab", 2, 1);
+  server_->DoRead();
+  server_.reset();
+  loop_.EventProcess();
+  EXPECT_EQ(ret, -1);
+}
+
+// 测试协程帧复用
+TEST(FramePoolTest, ReuseTest) {
+  void* first = FramePool::Alloc(200);
+  FramePool::Free(first, 200);
+  void* second = FramePool::Alloc(250);
+  EXPECT_EQ(first, second);
+  FramePool::Free(second, 250);
+}
+
+// 测试信箱析构后msg_id可以重新注册，重复注册时退出进程
+TEST_F(CoroutineTest, MailboxRegisterTest) {
+  {
+    CoMailbox mailbox(&server_router_, 1);
+  }
+  CoMailbox mailbox(&server_router_, 1);
+  EXPECT_EXIT(CoMailbox(&server_router_, 1), ::testing::ExitedWithCode(1),
+              "already taken");
+}
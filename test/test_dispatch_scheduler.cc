@@ -0,0 +1,193 @@
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+#include "gtest/gtest.h"
+#include "lars_reactor/dispatch_scheduler.h"
+#include "lars_reactor/rate_limiter.h"
+#include "test_helper.h"
+
+// 在一个事件循环上建立若干连接，记录消息的分发顺序
+class DispatchSchedulerTest : public ::testing::Test {
+ protected:
+  DispatchSchedulerTest() : scheduler_(&loop_) {}
+
+  void SetUp() override {
+    for (int msg_id = 1; msg_id <= 4; ++msg_id) {
+      router_.Register(msg_id, [this](const char* data, int len, int msg_id,
+                                      void* args, NetConnection* conn) {
+        order_.push_back(std::to_string(msg_id) + ":" + std::string(data, len));
+      });
+    }
+  }
+
+  void TearDown() override {
+    for (auto& conn : conns_) {
+      conn->CleanConn();
+    }
+    for (int fd : peers_) {
+      close(fd);
+    }
+  }
+
+  // 新建一个连接，返回对端fd
+  TcpConn* NewConn(int* peer) {
+    auto conn = MakeConnPair(&loop_, peer);
+    EXPECT_NE(conn, nullptr);
+    conn->SetRouter(&router_);
+    conn->SetScheduler(&scheduler_);
+    conns_.push_back(conn);
+    peers_.push_back(*peer);
+    return conn.get();
+  }
+
+  // 对端发送count个msg_id消息，消息体为序号
+  static void Send(int peer, int msg_id, int count) {
+    std::string msgs;
+    for (int i = 0; i < count; ++i) {
+      msgs += MakeMsg(msg_id, std::to_string(i));
+    }
+    ASSERT_EQ(write(peer, msgs.data(), msgs.size()), msgs.size());
+  }
+
+  EventLoop loop_;
+  DispatchScheduler scheduler_;
+  MsgRouter router_;
+  std::vector<std::shared_ptr<TcpConn>> conns_;
+  std::vector<int> peers_;
+  std::vector<std::string> order_;
+};
+
+// 测试控制面消息排在先到的大块数据之前分发
+TEST_F(DispatchSchedulerTest, PriorityTest) {
+  scheduler_.SetMsgClass(1, PRIORITY_CONTROL);
+  int bulk_peer, control_peer;
+  TcpConn* bulk = NewConn(&bulk_peer);
+  TcpConn* control = NewConn(&control_peer);
+  Send(bulk_peer, 2, 10);
+  Send(control_peer, 1, 1);
+  bulk->DoRead();
+  control->DoRead();
+  EXPECT_TRUE(order_.empty());
+
+  // 本轮事件处理完之后分发
+  loop_.RunAfter(20, [this]() { loop_.Stop(); });
+  loop_.EventProcess();
+  ASSERT_EQ(order_.size(), 11);
+  EXPECT_EQ(order_[0], "1:0");
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_EQ(order_[i + 1], "2:" + std::to_string(i));
+  }
+}
+
+// 测试按权重轮流分发各个类别
+TEST_F(DispatchSchedulerTest, WeightTest) {
+  scheduler_.SetWeight(PRIORITY_DEFAULT, 2);
+  scheduler_.SetWeight(PRIORITY_BULK, 1);
+  int bulk_peer, normal_peer;
+  TcpConn* bulk = NewConn(&bulk_peer);
+  TcpConn* normal = NewConn(&normal_peer);
+  bulk->SetPriority(PRIORITY_BULK);
+  Send(bulk_peer, 3, 4);
+  Send(normal_peer, 4, 4);
+  bulk->DoRead();
+  normal->DoRead();
+  scheduler_.Drain();
+  std::vector<std::string> expect = {"4:0", "4:1", "3:0", "4:2",
+                                     "4:3", "3:1", "3:2", "3:3"};
+  EXPECT_EQ(order_, expect);
+}
+
+// 测试每个连接每轮最多解析budget帧
+TEST_F(DispatchSchedulerTest, BudgetTest) {
+  scheduler_.SetConnBudget(3);
+  int peer;
+  TcpConn* conn = NewConn(&peer);
+  Send(peer, 2, 7);
+  conn->DoRead();
+  scheduler_.Drain();
+  EXPECT_EQ(order_.size(), 3);
+  scheduler_.Drain();
+  EXPECT_EQ(order_.size(), 6);
+  scheduler_.Drain();
+  ASSERT_EQ(order_.size(), 7);
+  for (int i = 0; i < 7; ++i) {
+    EXPECT_EQ(order_[i], "2:" + std::to_string(i));
+  }
+
+  // 分发完之后可以继续读
+  Send(peer, 2, 1);
+  conn->DoRead();
+  scheduler_.Drain();
+  ASSERT_EQ(order_.size(), 8);
+  EXPECT_EQ(order_[7], "2:0");
+}
+
+// 测试排队的帧后面有被拒绝的帧时，跳过的长度计入排队，分发完之后一起移除
+TEST_F(DispatchSchedulerTest, RejectQueuedTest) {
+  RateLimiter reject(RATE_REJECT);
+  reject.SetMsgLimit(2, 1, 1);
+  int peer;
+  TcpConn* conn = NewConn(&peer);
+  conn->SetRateLimiter(&reject);
+  Send(peer, 1, 1);
+  Send(peer, 2, 2);
+  Send(peer, 3, 1);
+  conn->DoRead();
+  EXPECT_TRUE(order_.empty());
+  EXPECT_EQ(reject.GetRejected(), 1);
+  scheduler_.Drain();
+  std::vector<std::string> expect = {"1:0", "2:0", "3:0"};
+  EXPECT_EQ(order_, expect);
+
+  // 被拒绝的帧在ibuf头部时直接移除，后面的帧正常排队分发
+  Send(peer, 2, 1);
+  Send(peer, 4, 1);
+  conn->DoRead();
+  scheduler_.Drain();
+  ASSERT_EQ(order_.size(), 4);
+  EXPECT_EQ(order_[3], "4:0");
+  EXPECT_EQ(reject.GetRejected(), 2);
+
+  // ibuf中没有残留被拒绝的帧，后续消息从正确的位置解析
+  Send(peer, 4, 1);
+  conn->DoRead();
+  scheduler_.Drain();
+  ASSERT_EQ(order_.size(), 5);
+  EXPECT_EQ(order_[4], "4:0");
+  EXPECT_NE(conn->GetFd(), -1);
+
+  conn->DoWrite();
+  char buf[64];
+  char reject_body[4];
+  StoreLE<uint32_t>(reject_body, 2);
+  std::string expect_reply =
+      MakeMsg(RATE_REJECT_ID, std::string(reject_body, 4));
+  expect_reply += expect_reply;
+  ASSERT_EQ(read(peer, buf, sizeof(buf)), expect_reply.size());
+  EXPECT_EQ(std::string(buf, expect_reply.size()), expect_reply);
+}
+
+// 测试排队的帧从准入到分发完都计入在途，排满之后暂停读
+TEST_F(DispatchSchedulerTest, InflightTest) {
+  RateLimiter pause(RATE_PAUSE);
+  pause.SetMaxInflight(2);
+  int peer;
+  TcpConn* conn = NewConn(&peer);
+  conn->SetRateLimiter(&pause);
+  Send(peer, 2, 3);
+  conn->DoRead();
+  EXPECT_TRUE(order_.empty());
+  EXPECT_EQ(pause.GetInflight(), 2);
+  EXPECT_EQ(pause.GetPaused(), 1);
+  scheduler_.Drain();
+  EXPECT_EQ(order_.size(), 2);
+  EXPECT_EQ(pause.GetInflight(), 0);
+
+  // 在途名额归还后恢复读，剩下的帧继续分发
+  loop_.RunAfter(20, [this]() { loop_.Stop(); });
+  loop_.EventProcess();
+  ASSERT_EQ(order_.size(), 3);
+  EXPECT_EQ(order_[2], "2:2");
+  EXPECT_EQ(pause.GetInflight(), 0);
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <sys/socket.h>
+
+#include <memory>
+#include <string>
+
+#include "lars_reactor/schema.h"
+#include "lars_reactor/slab_pool.h"
+#include "lars_reactor/tcp_conn.h"
+
+// 按线上格式编码的一帧消息，msg_len为消息头中的长度字段(可以带标志位)
+inline std::string MakeFrame(int msg_id, int msg_len, const std::string& body) {
+  std::string frame(MESSAGE_HEAD_LEN, 0);
+  EncodeHead(&frame[0], msg_id, msg_len);
+  return frame + body;
+}
+
+inline std::string MakeMsg(int msg_id, const std::string& body) {
+  return MakeFrame(msg_id, static_cast<int>(body.size()), body);
+}
+
+// 和TcpServer一样从slab分配连接对象，不使用TcpServer
+inline std::shared_ptr<TcpConn> MakeConn(int fd, EventLoop* loop) {
+  return std::allocate_shared<TcpConn>(SlabAllocator<TcpConn>(), fd, loop,
+                                       nullptr);
+}
+
+// 建立一对socket，一端交给TcpConn，另一端作为对端由调用方关闭，失败返回nullptr
+inline std::shared_ptr<TcpConn> MakeConnPair(EventLoop* loop, int* peer) {
+  int fds[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == -1) {
+    return nullptr;
+  }
+  *peer = fds[1];
+  return MakeConn(fds[0], loop);
+}
@@ -0,0 +1,122 @@
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <dirent.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include "gtest/gtest.h"
+#include "lars_reactor/hot_restart.h"
+
+static uint16_t GetPort(int fd) {
+  struct sockaddr_in addr {};
+  socklen_t len = sizeof(addr);
+  getsockname(fd, reinterpret_cast<struct sockaddr*>(&addr), &len);
+  return ntohs(addr.sin_port);
+}
+
+// 当前进程打开的fd个数
+static int CountFds() {
+  int num = 0;
+  DIR* dir = opendir("/proc/self/fd");
+  while (readdir(dir) != nullptr) {
+    ++num;
+  }
+  closedir(dir);
+  return num;
+}
+
+// 测试没有旧进程时冷启动
+TEST(HotRestartTest, ColdStartTest) {
+  std::vector<int> fds;
+  EXPECT_EQ(HotRestart::Inherit("/tmp/lars_test_no_such.sock", &fds), -1);
+  EXPECT_TRUE(fds.empty());
+}
+
+// 测试新进程继承监听fd，旧进程停止accept并在连接排空后退出事件循环
+TEST(HotRestartTest, HandoffTest) {
+  const std::string path = "/tmp/lars_test_hot_restart.sock";
+  EventLoop loop;
+  TcpServer server(&loop, "127.0.0.1", 0);
+  uint16_t port = GetPort(server.GetListenFd());
+  HotRestart restart(&loop, path);
+  restart.AddServer(&server);
+  ASSERT_EQ(restart.Listen(), 0);
+  std::thread old_process([&loop]() { loop.EventProcess(); });
+
+  std::vector<int> fds;
+  ASSERT_EQ(HotRestart::Inherit(path, &fds), 0);
+  ASSERT_EQ(fds.size(), 1);
+  EXPECT_EQ(GetPort(fds[0]), port);
+
+  // 旧进程没有连接，排空检查后退出
+  old_process.join();
+  EXPECT_TRUE(restart.IsDraining());
+  EXPECT_EQ(server.GetListenFd(), -1);
+
+  // 交接后到达的连接由继承的监听fd接收
+  int client = socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in addr {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  inet_aton("127.0.0.1", &addr.sin_addr);
+  ASSERT_EQ(connect(client, reinterpret_cast<struct sockaddr*>(&addr),
+                    sizeof(addr)),
+            0);
+  int connfd = accept(fds[0], nullptr, nullptr);
+  EXPECT_NE(connfd, -1);
+  close(connfd);
+  close(client);
+  close(fds[0]);
+}
+
+// 测试旧进程发送的fd个数与声明的不一致时交接失败，收到的fd被关闭
+TEST(HotRestartTest, BadHandoffTest) {
+  const std::string path = "/tmp/lars_test_bad_restart.sock";
+  int sockfd = socket(AF_UNIX, SOCK_STREAM, 0);
+  struct sockaddr_un addr {};
+  addr.sun_family = AF_UNIX;
+  strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+  unlink(path.c_str());
+  ASSERT_EQ(bind(sockfd, reinterpret_cast<struct sockaddr*>(&addr),
+                 sizeof(addr)),
+            0);
+  ASSERT_EQ(listen(sockfd, 1), 0);
+  int before = CountFds();
+  std::thread old_process([sockfd]() {
+    int connfd = accept(sockfd, nullptr, nullptr);
+    // 声明2个fd，实际只发送1个
+    int count = 2;
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    char control[CMSG_SPACE(sizeof(int))];
+    memset(control, 0, sizeof(control));
+    struct iovec iov {};
+    iov.iov_base = &count;
+    iov.iov_len = sizeof(count);
+    struct msghdr msg {};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &fd, sizeof(fd));
+    sendmsg(connfd, &msg, 0);
+    close(fd);
+    close(connfd);
+  });
+
+  std::vector<int> fds;
+  EXPECT_EQ(HotRestart::Inherit(path, &fds), -2);
+  EXPECT_TRUE(fds.empty());
+  old_process.join();
+  EXPECT_EQ(CountFds(), before);
+  close(sockfd);
+  unlink(path.c_str());
+}
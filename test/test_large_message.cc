@@ -0,0 +1,158 @@
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+#include "gtest/gtest.h"
+#include "test_helper.h"
+
+// 开启大消息模式的连接，对端非阻塞写入
+class LargeMessageTest : public ::testing::Test {
+ protected:
+  void TearDown() override {
+    for (auto& conn : conns_) {
+      conn->CleanConn();
+    }
+    for (int fd : peers_) {
+      close(fd);
+    }
+    TcpConn::SetLargeGlobalLimit(LARGE_MESSAGE_GLOBAL_LIMIT);
+  }
+
+  TcpConn* NewConn(int* peer, int max_len = LARGE_MESSAGE_DEFAULT_LIMIT) {
+    auto conn = MakeConnPair(&loop_, peer);
+    EXPECT_NE(conn, nullptr);
+    fcntl(*peer, F_SETFL, fcntl(*peer, F_GETFL) | O_NONBLOCK);
+    conn->SetRouter(&router_);
+    conn->EnableLargeMessage(max_len);
+    conns_.push_back(conn);
+    peers_.push_back(*peer);
+    return conn.get();
+  }
+
+  static std::string Body(int len) {
+    std::string body(len, 0);
+    for (int i = 0; i < len; ++i) {
+      body[i] = static_cast<char>(i * 7 + i / 4096);
+    }
+    return body;
+  }
+
+  // 写入data，socket缓冲区满时让conn读走，直到全部读完或连接关闭
+  static void Feed(TcpConn* conn, int peer, const std::string& data) {
+    size_t sent = 0;
+    int pending = 0;
+    while (conn->GetFd() != -1 && (sent < data.size() || pending > 0)) {
+      ssize_t n = write(peer, data.data() + sent, data.size() - sent);
+      if (n > 0) {
+        sent += n;
+      }
+      conn->DoRead();
+      if (conn->GetFd() == -1 ||
+          ioctl(conn->GetFd(), FIONREAD, &pending) == -1) {
+        break;
+      }
+    }
+  }
+
+  EventLoop loop_;
+  MsgRouter router_;
+  std::vector<std::shared_ptr<TcpConn>> conns_;
+  std::vector<int> peers_;
+};
+
+// 测试分片模式逐片交给业务，之后的普通消息照常解析
+TEST_F(LargeMessageTest, ChunkTest) {
+  std::string received;
+  int total = 0;
+  router_.RegisterChunk(5, [&](const char* data, int len, int offset, int all,
+                               int msg_id, void* args, NetConnection* conn) {
+    EXPECT_EQ(offset, static_cast<int>(received.size()));
+    received.append(data, len);
+    total = all;
+  });
+  std::string small;
+  router_.Register(6, [&](const char* data, int len, int msg_id, void* args,
+                          NetConnection* conn) { small.assign(data, len); });
+  int peer;
+  TcpConn* conn = NewConn(&peer);
+  std::string body = Body(300000);
+  Feed(conn, peer, MakeMsg(5, body) + MakeMsg(6, "after"));
+  conn->DoRead();
+  EXPECT_EQ(total, body.size());
+  EXPECT_EQ(received, body);
+  EXPECT_EQ(small, "after");
+}
+
+// 测试组装模式把消息体组装到IoBuffer链表中
+TEST_F(LargeMessageTest, ChainTest) {
+  std::string received;
+  router_.RegisterChain(5, [&](const std::shared_ptr<IoBuffer>& chain,
+                               int total, int msg_id, void* args,
+                               NetConnection* conn) {
+    for (auto buf = chain; buf != nullptr; buf = buf->GetNext()) {
+      received.append(buf->GetData() + buf->GetHead(), buf->GetLength());
+    }
+    EXPECT_EQ(total, static_cast<int>(received.size()));
+    EXPECT_EQ(TcpConn::GetLargeInUse(), total);
+  });
+  int peer;
+  TcpConn* conn = NewConn(&peer);
+  std::string body = Body(LARGE_MESSAGE_CHUNK * 2 + 12345);
+  Feed(conn, peer, MakeMsg(5, body));
+  EXPECT_EQ(received, body);
+  EXPECT_EQ(TcpConn::GetLargeInUse(), 0);
+  EXPECT_NE(conn->GetFd(), -1);
+}
+
+// 测试超过连接上限或者没有注册的大消息关闭连接
+TEST_F(LargeMessageTest, LimitTest) {
+  router_.RegisterChain(5, [](const std::shared_ptr<IoBuffer>& chain,
+                              int total, int msg_id, void* args,
+                              NetConnection* conn) { FAIL(); });
+  int peer;
+  TcpConn* conn = NewConn(&peer, 100000);
+  Feed(conn, peer, MakeMsg(5, Body(100001)));
+  EXPECT_EQ(conn->GetFd(), -1);
+
+  conn = NewConn(&peer);
+  Feed(conn, peer, MakeMsg(9, Body(MESSAGE_LENGTH_LIMIT + 1)));
+  EXPECT_EQ(conn->GetFd(), -1);
+  EXPECT_EQ(TcpConn::GetLargeInUse(), 0);
+}
+
+// 测试分片模式的消息长度不能用到压缩标志位
+TEST_F(LargeMessageTest, FlagBitTest) {
+  router_.RegisterChunk(5, [](const char* data, int len, int offset, int all,
+                              int msg_id, void* args, NetConnection* conn) {
+    FAIL();
+  });
+  int peer;
+  TcpConn* conn = NewConn(&peer);
+  Feed(conn, peer, MakeFrame(5, MSG_FLAG_COMPRESSED, "chunk"));
+  EXPECT_EQ(conn->GetFd(), -1);
+}
+
+// 测试所有连接组装中的大消息合计超过全局上限时关闭新的连接
+TEST_F(LargeMessageTest, GlobalLimitTest) {
+  int done = 0;
+  router_.RegisterChain(5, [&done](const std::shared_ptr<IoBuffer>& chain,
+                                   int total, int msg_id, void* args,
+                                   NetConnection* conn) { ++done; });
+  TcpConn::SetLargeGlobalLimit(150000);
+  int first_peer, second_peer;
+  TcpConn* first = NewConn(&first_peer);
+  TcpConn* second = NewConn(&second_peer);
+  std::string frame = MakeMsg(5, Body(100000));
+  // 第一个连接只发送一半，组装中占用全局额度
+  Feed(first, first_peer, frame.substr(0, 50000));
+  EXPECT_EQ(TcpConn::GetLargeInUse(), 100000);
+  Feed(second, second_peer, frame);
+  EXPECT_EQ(second->GetFd(), -1);
+
+  Feed(first, first_peer, frame.substr(50000));
+  EXPECT_EQ(done, 1);
+  EXPECT_EQ(TcpConn::GetLargeInUse(), 0);
+  EXPECT_NE(first->GetFd(), -1);
+}
@@ -0,0 +1,98 @@
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <string>
+#include "gtest/gtest.h"
+#include "lars_dns/dns_proto.h"
+#include "lars_lb_agent/lb_agent.h"
+
+// 取一个没有监听的本地端口
+static uint16_t ClosedPort() {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in addr {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+  socklen_t addr_len = sizeof(addr);
+  getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &addr_len);
+  close(fd);
+  return ntohs(addr.sin_port);
+}
+
+// 测试周期定时器和取消
+TEST(TimerQueueTest, RunEveryTest) {
+  EventLoop loop;
+  int count = 0;
+  int timer = loop.RunEvery(5, [&count]() { ++count; });
+  loop.RunAfter(28, [&loop, timer]() { loop.CancelTimer(timer); });
+  loop.RunAfter(60, [&loop]() { loop.Stop(); });
+  loop.EventProcess();
+  EXPECT_GE(count, 4);
+  EXPECT_LE(count, 6);
+}
+
+// 测试服务端不可用时连接不阻塞事件循环，失败后退避
+TEST(TcpClientTest, BackoffTest) {
+  EventLoop loop;
+  TcpClient client(&loop, "127.0.0.1", ClosedPort());
+  int ret = client.Connect();
+  ASSERT_NE(ret, 0);
+  if (ret == 1) {
+    EXPECT_TRUE(client.IsConnecting());
+    // 连接中的消息先缓存
+    EXPECT_EQ(client.SendMessage("ping", 4, 1), 0);
+    loop.RunEvery(1, [&client, &loop]() {
+      if (!client.IsConnecting()) {
+        loop.Stop();
+      }
+    });
+    loop.EventProcess();
+  }
+  EXPECT_FALSE(client.IsConnecting());
+  EXPECT_FALSE(client.IsConnected());
+  // 退避期间不再发起连接
+  EXPECT_EQ(client.Connect(), -1);
+  EXPECT_FALSE(client.IsConnecting());
+  EXPECT_EQ(client.SendMessage("ping", 4, 1), -1);
+}
+
+// 用本地的路由服务测试第一次获取路由返回不存在，拉取到之后返回主机
+TEST(LbAgentTest, FetchRouteTest) {
+  EventLoop loop;
+  TcpServer dns(&loop, "127.0.0.1", 0);
+  dns.AddMsgRouter(
+      ID_GET_ROUTE_REQUEST, [](const char* data, int len, int msg_id,
+                               void* args, NetConnection* conn) {
+        GetRouteRequest req{};
+        ASSERT_EQ(len, static_cast<int>(sizeof(req)));
+        memcpy(&req, data, sizeof(req));
+        GetRouteResponse rsp{req.modid_, req.cmdid_, 2};
+        HostInfo hosts[2] = {{0x7f000001, 8001}, {0x7f000001, 8002}};
+        std::string msg(reinterpret_cast<char*>(&rsp), sizeof(rsp));
+        msg.append(reinterpret_cast<char*>(hosts), sizeof(hosts));
+        conn->SendMessage(msg.data(), static_cast<int>(msg.size()),
+                          ID_GET_ROUTE_RESPONSE);
+      });
+  struct sockaddr_in addr {};
+  socklen_t addr_len = sizeof(addr);
+  getsockname(dns.GetListenFd(), reinterpret_cast<sockaddr*>(&addr),
+              &addr_len);
+
+  LbAgent agent(&loop, "127.0.0.1", ntohs(addr.sin_port));
+  HostInfo host{};
+  EXPECT_EQ(agent.GetHost(1, 1, &host), RET_NOEXIST);
+  loop.RunEvery(1, [&agent, &loop]() {
+    HostInfo host{};
+    if (agent.GetHost(1, 1, &host) == RET_SUCC) {
+      loop.Stop();
+    }
+  });
+  // 防止拉取失败时测试卡住
+  loop.RunAfter(3000, [&loop]() { loop.Stop(); });
+  loop.EventProcess();
+  ASSERT_EQ(agent.GetHost(1, 1, &host), RET_SUCC);
+  EXPECT_EQ(host.ip_, 0x7f000001u);
+  EXPECT_TRUE(host.port_ == 8001 || host.port_ == 8002);
+}
@@ -0,0 +1,106 @@
+#include <set>
+#include <vector>
+#include "gtest/gtest.h"
+#include "lars_lb_agent/load_balance.h"
+
+#define MS (1000000UL)
+
+// 测试idle主机轮询
+TEST(LoadBalanceTest, RoundRobinTest) {
+  LbConfig config;
+  LoadBalance lb(&config);
+  HostInfo host{};
+  EXPECT_EQ(lb.GetHost(0, &host), RET_NOEXIST);
+
+  lb.Update({{1, 80}, {2, 80}, {3, 80}}, 0);
+  std::set<uint32_t> ips;
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_EQ(lb.GetHost(0, &host), RET_SUCC);
+    ips.insert(host.ip_);
+  }
+  EXPECT_EQ(ips.size(), 3);
+}
+
+// 测试失败率过高的主机进入overload，连续成功后恢复
+TEST(LoadBalanceTest, OverloadRecoverTest) {
+  LbConfig config;
+  config.min_err_ = 3;
+  config.recover_succ_ = 2;
+  LoadBalance lb(&config);
+  lb.Update({{1, 80}, {2, 80}}, 0);
+
+  HostInfo bad{1, 80};
+  for (int i = 0; i < 3; ++i) {
+    lb.Report(bad, false, i * MS);
+  }
+  EXPECT_EQ(lb.OverloadNum(), 1);
+  EXPECT_EQ(lb.IdleNum(), 1);
+
+  // 除了探测之外只会选到正常主机
+  HostInfo host{};
+  for (int i = 1; i < config.probe_num_; ++i) {
+    EXPECT_EQ(lb.GetHost(10 * MS, &host), RET_SUCC);
+    EXPECT_EQ(host.ip_, 2);
+  }
+  // 第probe_num_次探测过载主机
+  EXPECT_EQ(lb.GetHost(10 * MS, &host), RET_SUCC);
+  EXPECT_EQ(host.ip_, 1);
+
+  lb.Report(bad, true, 11 * MS);
+  lb.Report(bad, true, 12 * MS);
+  EXPECT_EQ(lb.OverloadNum(), 0);
+  EXPECT_EQ(lb.IdleNum(), 2);
+}
+
+// 测试probe_num_为0时不探测过载主机，idle为空时仍然从过载主机中选
+TEST(LoadBalanceTest, NoProbeTest) {
+  LbConfig config;
+  config.min_err_ = 1;
+  config.probe_num_ = 0;
+  LoadBalance lb(&config);
+  lb.Update({{1, 80}, {2, 80}}, 0);
+  lb.Report({1, 80}, false, 0);
+  EXPECT_EQ(lb.OverloadNum(), 1);
+
+  HostInfo host{};
+  for (int i = 0; i < 20; ++i) {
+    EXPECT_EQ(lb.GetHost(MS, &host), RET_SUCC);
+    EXPECT_EQ(host.ip_, 2);
+  }
+  lb.Report({2, 80}, false, MS);
+  EXPECT_EQ(lb.GetHost(2 * MS, &host), RET_OVERLOAD);
+}
+
+// 测试过载超时后恢复
+TEST(LoadBalanceTest, OverloadTimeoutTest) {
+  LbConfig config;
+  config.min_err_ = 1;
+  config.overload_timeout_ms_ = 100;
+  LoadBalance lb(&config);
+  lb.Update({{1, 80}}, 0);
+  lb.Report({1, 80}, false, 0);
+  ASSERT_EQ(lb.OverloadNum(), 1);
+
+  HostInfo host{};
+  EXPECT_EQ(lb.GetHost(50 * MS, &host), RET_OVERLOAD);
+  EXPECT_EQ(lb.GetHost(100 * MS, &host), RET_SUCC);
+  EXPECT_EQ(lb.IdleNum(), 1);
+}
+
+// 测试更新路由时保留已有主机的统计，删除不存在的主机
+TEST(LoadBalanceTest, UpdateTest) {
+  LbConfig config;
+  config.min_err_ = 1;
+  LoadBalance lb(&config);
+  lb.Update({{1, 80}, {2, 80}}, 0);
+  lb.Report({1, 80}, false, 0);
+  ASSERT_EQ(lb.OverloadNum(), 1);
+
+  lb.Update({{1, 80}, {3, 80}}, MS);
+  EXPECT_EQ(lb.OverloadNum(), 1);
+  EXPECT_EQ(lb.IdleNum(), 1);
+
+  lb.Update({}, 2 * MS);
+  HostInfo host{};
+  EXPECT_EQ(lb.GetHost(2 * MS, &host), RET_NOEXIST);
+}
@@ -0,0 +1,161 @@
+#include <unistd.h>
+
+#include <string>
+#include "gtest/gtest.h"
+#include "lars_reactor/buffer_pool.h"
+#include "lars_reactor/msg_router.h"
+#include "lars_reactor/profiler.h"
+#include "test_helper.h"
+
+// 占用cpu的回调
+static void Spin(int n) {
+  volatile uint64_t sum = 0;
+  for (int i = 0; i < n; ++i) {
+    sum = sum + i;
+  }
+}
+
+// 测试按1/rate采样并统计时间
+TEST(ProfilerTest, SampleTest) {
+  HandlerProfiler profiler(4);
+  MsgRouter router;
+  router.SetProfiler(&profiler);
+  router.Register(1, [](const char* data, int len, int msg_id, void* args,
+                        NetConnection* conn) { Spin(1000000); });
+  router.Register(2, [](const char* data, int len, int msg_id, void* args,
+                        NetConnection* conn) {});
+  for (int i = 0; i < 8; ++i) {
+    router.Call(1, 0, nullptr, nullptr);
+  }
+  HandlerStats stats;
+  ASSERT_TRUE(profiler.GetStats(1, &stats));
+  EXPECT_EQ(stats.samples_, 2);
+  EXPECT_GT(stats.cpu_ns_, 0);
+  EXPECT_GE(stats.wall_ns_, stats.max_wall_ns_);
+  EXPECT_EQ(stats.TotalAllocs(), 0);
+  EXPECT_FALSE(profiler.GetStats(2, &stats));
+
+  // 关闭后不再采样
+  profiler.SetRate(0);
+  for (int i = 0; i < 8; ++i) {
+    router.Call(2, 0, nullptr, nullptr);
+  }
+  EXPECT_FALSE(profiler.GetStats(2, &stats));
+  profiler.Reset();
+  EXPECT_FALSE(profiler.GetStats(1, &stats));
+}
+
+// 测试回调期间按规格统计BufferPool分配，报告按指定方式排序
+TEST(ProfilerTest, AllocTest) {
+  HandlerProfiler profiler(1);
+  MsgRouter router;
+  router.SetProfiler(&profiler);
+  router.Register(1, [](const char* data, int len, int msg_id, void* args,
+                        NetConnection* conn) { Spin(1000000); });
+  router.Register(2, [](const char* data, int len, int msg_id, void* args,
+                        NetConnection* conn) {
+    auto small1 = BufferPool::instance().AllocBuffer(100);
+    auto small2 = BufferPool::instance().AllocBuffer();
+    auto large = BufferPool::instance().AllocBuffer(m64K);
+    BufferPool::instance().revert(small1);
+    BufferPool::instance().revert(small2);
+    BufferPool::instance().revert(large);
+  });
+  // 回调之外的分配不计数
+  BufferPool::instance().revert(BufferPool::instance().AllocBuffer());
+  router.Call(1, 0, nullptr, nullptr);
+  router.Call(2, 0, nullptr, nullptr);
+
+  HandlerStats stats;
+  ASSERT_TRUE(profiler.GetStats(2, &stats));
+  EXPECT_EQ(stats.samples_, 1);
+  EXPECT_EQ(stats.allocs_[HandlerProfiler::SizeClass(m4K)], 2);
+  EXPECT_EQ(stats.allocs_[HandlerProfiler::SizeClass(m64K)], 1);
+  EXPECT_EQ(stats.TotalAllocs(), 3);
+
+  auto report = profiler.Report(PROFILE_SORT_CPU);
+  ASSERT_EQ(report.size(), 2);
+  EXPECT_EQ(report[0].first, 1);
+  report = profiler.Report(PROFILE_SORT_ALLOCS);
+  EXPECT_EQ(report[0].first, 2);
+  std::string dump = profiler.Dump(PROFILE_SORT_ALLOCS);
+  EXPECT_NE(dump.find("msg_id"), std::string::npos);
+  EXPECT_NE(dump.find("4K:2 64K:1"), std::string::npos);
+  EXPECT_LT(dump.find("\n2 "), dump.find("\n1 "));
+}
+
+// 测试通过PROFILE_DUMP_ID请求报告
+TEST(ProfilerTest, DumpRouterTest) {
+  EventLoop loop;
+  HandlerProfiler profiler(1);
+  MsgRouter router;
+  router.SetProfiler(&profiler);
+  ASSERT_EQ(profiler.AddDumpRouter(&router), 0);
+  int peer;
+  auto conn = MakeConnPair(&loop, &peer);
+  ASSERT_NE(conn, nullptr);
+  conn->SetRouter(&router);
+
+  std::string request = MakeMsg(PROFILE_DUMP_ID, "");
+  ASSERT_EQ(write(peer, request.data(), request.size()), request.size());
+  conn->DoRead();
+  conn->DoWrite();
+  char buf[4096];
+  int n = read(peer, buf, sizeof(buf));
+  ASSERT_GT(n, MESSAGE_HEAD_LEN);
+  MsgHead reply = DecodeHead(buf);
+  EXPECT_EQ(reply.msg_id_, PROFILE_DUMP_ID);
+  EXPECT_EQ(reply.msg_len_, n - MESSAGE_HEAD_LEN);
+  std::string body(buf + MESSAGE_HEAD_LEN, n - MESSAGE_HEAD_LEN);
+  EXPECT_EQ(body.find("msg_id"), 0);
+
+  // 报告请求本身也被采样
+  HandlerStats stats;
+  EXPECT_TRUE(profiler.GetStats(PROFILE_DUMP_ID, &stats));
+
+  conn->CleanConn();
+  close(peer);
+}
+
+// 测试报告超过MESSAGE_LENGTH_LIMIT时在行尾截断
+TEST(ProfilerTest, DumpLimitTest) {
+  EventLoop loop;
+  HandlerProfiler profiler(1);
+  MsgRouter router;
+  router.SetProfiler(&profiler);
+  ASSERT_EQ(profiler.AddDumpRouter(&router), 0);
+  for (int msg_id = 1; msg_id <= 2000; ++msg_id) {
+    router.Register(msg_id, [](const char* data, int len, int msg_id,
+                               void* args, NetConnection* conn) {});
+    router.Call(msg_id, 0, nullptr, nullptr);
+  }
+  ASSERT_GT(profiler.Dump().size(), MESSAGE_LENGTH_LIMIT);
+  int peer;
+  auto conn = MakeConnPair(&loop, &peer);
+  ASSERT_NE(conn, nullptr);
+  conn->SetRouter(&router);
+
+  std::string request = MakeMsg(PROFILE_DUMP_ID, "");
+  ASSERT_EQ(write(peer, request.data(), request.size()), request.size());
+  conn->DoRead();
+  std::string reply;
+  char buf[4096];
+  while (reply.size() < MESSAGE_HEAD_LEN ||
+         reply.size() < static_cast<size_t>(MESSAGE_HEAD_LEN +
+                                            DecodeHead(reply.data()).msg_len_)) {
+    conn->DoWrite();
+    ssize_t n = read(peer, buf, sizeof(buf));
+    ASSERT_GT(n, 0);
+    reply.append(buf, n);
+  }
+  MsgHead head = DecodeHead(reply.data());
+  EXPECT_EQ(head.msg_id_, PROFILE_DUMP_ID);
+  EXPECT_LE(head.msg_len_, MESSAGE_LENGTH_LIMIT);
+  EXPECT_GT(head.msg_len_, MESSAGE_LENGTH_LIMIT / 2);
+  EXPECT_EQ(reply.size(), MESSAGE_HEAD_LEN + head.msg_len_);
+  EXPECT_EQ(reply.find("msg_id", MESSAGE_HEAD_LEN), MESSAGE_HEAD_LEN);
+  EXPECT_EQ(reply.back(), '\n');
+
+  conn->CleanConn();
+  close(peer);
+}
@@ -0,0 +1,168 @@
+#include <unistd.h>
+
+#include <string>
+#include "gtest/gtest.h"
+#include "lars_reactor/rate_limiter.h"
+#include "test_helper.h"
+
+#define MS (1000 * 1000UL)
+
+// 测试连接和msg_id的令牌桶
+TEST(RateLimiterTest, BucketTest) {
+  RateLimiter limiter;
+  limiter.SetConnLimit(10, 2);
+  limiter.SetMsgLimit(7, 1, 1);
+  uint64_t now = 1000 * MS;
+  // 连接桶可以突发2个
+  EXPECT_EQ(limiter.Admit(3, 1, now), 0);
+  EXPECT_EQ(limiter.Admit(3, 1, now), 0);
+  EXPECT_EQ(limiter.Admit(3, 1, now), 100 * MS);
+  // 每个连接单独计算
+  EXPECT_EQ(limiter.Admit(4, 1, now), 0);
+  // 100ms补充一个令牌
+  EXPECT_EQ(limiter.Admit(3, 1, now + 100 * MS), 0);
+  EXPECT_EQ(limiter.Admit(3, 1, now + 150 * MS), 50 * MS);
+
+  // msg_id的桶所有连接共享，被拒绝时不消耗连接的令牌
+  EXPECT_EQ(limiter.Admit(5, 7, now), 0);
+  EXPECT_EQ(limiter.Admit(6, 7, now), 1000 * MS);
+  EXPECT_EQ(limiter.Admit(6, 1, now), 0);
+  EXPECT_EQ(limiter.Admit(6, 1, now), 0);
+  limiter.SetMsgLimit(7, 0, 0);
+  EXPECT_EQ(limiter.Admit(5, 7, now), 0);
+
+  // 新连接复用fd时重置
+  limiter.ResetConn(3);
+  EXPECT_EQ(limiter.Admit(3, 1, now + 150 * MS), 0);
+}
+
+// 测试在途消息数上限
+TEST(RateLimiterTest, InflightTest) {
+  RateLimiter limiter;
+  limiter.SetMaxInflight(1);
+  EXPECT_EQ(limiter.Admit(3, 1, 0), 0);
+  limiter.Hold();
+  EXPECT_EQ(limiter.Admit(3, 1, 0), RATE_INFLIGHT_RETRY_NS);
+  limiter.Release();
+  EXPECT_EQ(limiter.Admit(3, 1, 0), 0);
+}
+
+// 测试超过限流的消息被拒绝或暂停读
+TEST(RateLimiterTest, ConnTest) {
+  EventLoop loop;
+  RateLimiter reject(RATE_REJECT);
+  reject.SetConnLimit(1, 1);
+  int peer;
+  auto conn = MakeConnPair(&loop, &peer);
+  ASSERT_NE(conn, nullptr);
+  conn->SetRateLimiter(&reject);
+
+  std::string msgs = MakeMsg(1, "a") + MakeMsg(2, "b") + MakeMsg(3, "c");
+  ASSERT_EQ(write(peer, msgs.data(), msgs.size()), msgs.size());
+  conn->DoRead();
+  conn->DoWrite();
+  char buf[256];
+  std::string expect = MakeMsg(1, "a");
+  char reject_body[4];
+  StoreLE<uint32_t>(reject_body, 2);
+  expect += MakeMsg(RATE_REJECT_ID, std::string(reject_body, 4));
+  StoreLE<uint32_t>(reject_body, 3);
+  expect += MakeMsg(RATE_REJECT_ID, std::string(reject_body, 4));
+  ASSERT_EQ(read(peer, buf, sizeof(buf)), expect.size());
+  EXPECT_EQ(std::string(buf, expect.size()), expect);
+  EXPECT_EQ(reject.GetRejected(), 2);
+
+  // 暂停读，令牌补充后继续处理留在ibuf中的消息
+  RateLimiter pause(RATE_PAUSE);
+  pause.SetConnLimit(100, 1);
+  conn->SetRateLimiter(&pause);
+  msgs = MakeMsg(1, "a") + MakeMsg(2, "b");
+  ASSERT_EQ(write(peer, msgs.data(), msgs.size()), msgs.size());
+  conn->DoRead();
+  EXPECT_EQ(loop.GetData(conn->GetFd())->mask_, EPOLLOUT);
+  EXPECT_EQ(pause.GetPaused(), 1);
+  conn->DoWrite();
+  EXPECT_EQ(loop.GetData(conn->GetFd()), nullptr);
+  ASSERT_EQ(read(peer, buf, sizeof(buf)), MakeMsg(1, "a").size());
+
+  loop.RunAfter(50, [&loop]() { loop.Stop(); });
+  loop.EventProcess();
+  ASSERT_NE(loop.GetData(conn->GetFd()), nullptr);
+  EXPECT_EQ(loop.GetData(conn->GetFd())->mask_, EPOLLIN);
+  ASSERT_EQ(read(peer, buf, sizeof(buf)), MakeMsg(2, "b").size());
+  EXPECT_EQ(std::string(buf, MESSAGE_HEAD_LEN + 1), MakeMsg(2, "b"));
+
+  conn->CleanConn();
+  close(peer);
+}
+
+// 测试对端不读拒绝应答时改为暂停读，obuf不会一直增长
+TEST(RateLimiterTest, RejectBacklogTest) {
+  EventLoop loop;
+  RateLimiter reject(RATE_REJECT);
+  reject.SetConnLimit(1, 1);
+  int peer;
+  auto conn = MakeConnPair(&loop, &peer);
+  ASSERT_NE(conn, nullptr);
+  conn->SetRateLimiter(&reject);
+
+  std::string msgs;
+  for (int i = 0; i < 2000; ++i) {
+    msgs += MakeMsg(1, "a");
+  }
+  ASSERT_EQ(write(peer, msgs.data(), msgs.size()), msgs.size());
+  conn->DoRead();
+  // 第一个消息回显9字节，之后每个拒绝应答12字节，达到RATE_REJECT_BACKLOG后暂停
+  EXPECT_EQ(reject.GetRejected(),
+            (RATE_REJECT_BACKLOG - 9 + 11) / 12);
+  EXPECT_EQ(reject.GetPaused(), 1);
+  EXPECT_EQ(loop.GetData(conn->GetFd())->mask_, EPOLLOUT);
+
+  conn->CleanConn();
+  close(peer);
+}
+
+// 测试大消息也做准入检查，被拒绝的消息体被丢弃
+TEST(RateLimiterTest, LargeRejectTest) {
+  EventLoop loop;
+  MsgRouter router;
+  int larges = 0;
+  std::string small;
+  router.RegisterChain(5, [&larges](const std::shared_ptr<IoBuffer>& chain,
+                                    int total, int msg_id, void* args,
+                                    NetConnection* conn) { ++larges; });
+  router.Register(1, [&small](const char* data, int len, int msg_id,
+                              void* args, NetConnection* conn) {
+    small.assign(data, len);
+  });
+  RateLimiter reject(RATE_REJECT);
+  reject.SetMsgLimit(5, 1, 1);
+  int peer;
+  auto conn = MakeConnPair(&loop, &peer);
+  ASSERT_NE(conn, nullptr);
+  conn->SetRouter(&router);
+  conn->EnableLargeMessage();
+  conn->SetRateLimiter(&reject);
+
+  std::string body(MESSAGE_LENGTH_LIMIT + 100, 'x');
+  std::string msgs = MakeMsg(5, body) + MakeMsg(5, body) + MakeMsg(1, "z");
+  ASSERT_EQ(write(peer, msgs.data(), msgs.size()), msgs.size());
+  for (int i = 0; i < 16 && small.empty(); ++i) {
+    conn->DoRead();
+  }
+  EXPECT_EQ(larges, 1);
+  EXPECT_EQ(small, "z");
+  EXPECT_EQ(reject.GetRejected(), 1);
+  EXPECT_EQ(TcpConn::GetLargeInUse(), 0);
+
+  conn->DoWrite();
+  char buf[64];
+  char reject_body[4];
+  StoreLE<uint32_t>(reject_body, 5);
+  std::string expect = MakeMsg(RATE_REJECT_ID, std::string(reject_body, 4));
+  ASSERT_EQ(read(peer, buf, sizeof(buf)), expect.size());
+  EXPECT_EQ(std::string(buf, expect.size()), expect);
+
+  conn->CleanConn();
+  close(peer);
+}
@@ -0,0 +1,146 @@
+#include <sys/resource.h>
+
+#include <atomic>
+#include <csignal>
+#include <fstream>
+#include <set>
+#include <thread>
+#include <vector>
+#include "gtest/gtest.h"
+#include "lars_reporter/reporter.h"
+
+// 测试队列满和空
+TEST(BoundedQueueTest, FullEmptyTest) {
+  BoundedQueue<int> queue(3);
+  EXPECT_EQ(queue.Capacity(), 4);
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_TRUE(queue.Push(i));
+  }
+  EXPECT_FALSE(queue.Push(4));
+  int value;
+  for (int i = 0; i < 4; ++i) {
+    ASSERT_TRUE(queue.Pop(&value));
+    EXPECT_EQ(value, i);
+  }
+  EXPECT_FALSE(queue.Pop(&value));
+}
+
+// 测试多生产者多消费者下不丢不重
+TEST(BoundedQueueTest, MultiThreadTest) {
+  BoundedQueue<int> queue(1024);
+  const int producers = 4;
+  const int per_producer = 20000;
+  std::atomic<int> consumed(0);
+  std::vector<std::vector<int>> results(2);
+  std::vector<std::thread> threads;
+  for (int c = 0; c < 2; ++c) {
+    threads.emplace_back([&, c]() {
+      int value;
+      while (consumed < producers * per_producer) {
+        if (queue.Pop(&value)) {
+          results[c].push_back(value);
+          ++consumed;
+        }
+      }
+    });
+  }
+  for (int p = 0; p < producers; ++p) {
+    threads.emplace_back([&, p]() {
+      for (int i = 0; i < per_producer; ++i) {
+        while (!queue.Push(p * per_producer + i)) {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  std::set<int> values;
+  for (const auto& r : results) {
+    values.insert(r.begin(), r.end());
+  }
+  EXPECT_EQ(values.size(), producers * per_producer);
+}
+
+// 测试提交的记录全部按批次写入日志
+TEST(ReporterTest, WriteReadTest) {
+  ReporterConfig config;
+  config.writer_num_ = 1;
+  config.batch_size_ = 100;
+  config.sync_ = false;
+  std::string path = config.log_dir_ + "/report.0.log";
+  remove(path.c_str());
+  {
+    Reporter reporter(config);
+    ASSERT_EQ(reporter.Start(), 0);
+    for (int i = 0; i < 1050; ++i) {
+      ReportRecord record{};
+      record.modid_ = i;
+      while (!reporter.Submit(record)) {
+        std::this_thread::yield();
+      }
+    }
+    reporter.Stop();
+    EXPECT_EQ(reporter.GetStats().written_, 1050);
+    EXPECT_GE(reporter.GetStats().batches_, 11);
+  }
+  std::vector<ReportRecord> records;
+  EXPECT_EQ(ReportLog::Read(path, &records), 1050);
+  std::set<int> modids;
+  for (const auto& record : records) {
+    modids.insert(record.modid_);
+  }
+  EXPECT_EQ(modids.size(), 1050);
+  remove(path.c_str());
+}
+
+// 测试部分写入的批次被截断，之后的批次仍然可以读出
+TEST(ReportLogTest, PartialWriteTest) {
+  std::string path = "./report.partial.log";
+  remove(path.c_str());
+  std::vector<ReportRecord> batch(10);
+  for (int i = 0; i < 10; ++i) {
+    batch[i].modid_ = i;
+  }
+  ReportLog log;
+  ASSERT_EQ(log.Open(path), 0);
+  ASSERT_EQ(log.Append(batch.data(), 10, false), 0);
+
+  // 限制文件大小让下一个批次只写入一部分
+  struct rlimit old_limit {};
+  getrlimit(RLIMIT_FSIZE, &old_limit);
+  signal(SIGXFSZ, SIG_IGN);
+  size_t batch_len = sizeof(ReportBatchHeader) + 10 * sizeof(ReportRecord);
+  struct rlimit limit = old_limit;
+  limit.rlim_cur = batch_len + batch_len / 2;
+  ASSERT_EQ(setrlimit(RLIMIT_FSIZE, &limit), 0);
+  EXPECT_EQ(log.Append(batch.data(), 10, false), -1);
+  ASSERT_EQ(setrlimit(RLIMIT_FSIZE, &old_limit), 0);
+  EXPECT_EQ(log.GetDropped(), 1);
+
+  ASSERT_EQ(log.Append(batch.data(), 10, false), 0);
+  log.Close();
+  std::vector<ReportRecord> records;
+  EXPECT_EQ(ReportLog::Read(path, &records), 20);
+  remove(path.c_str());
+}
+
+// 测试批次头中损坏的记录数不会按它分配内存
+TEST(ReportLogTest, BadCountTest) {
+  std::string path = "./report.bad.log";
+  remove(path.c_str());
+  ReportRecord record{};
+  ReportLog log;
+  ASSERT_EQ(log.Open(path), 0);
+  ASSERT_EQ(log.Append(&record, 1, false), 0);
+  log.Close();
+  {
+    std::ofstream out(path, std::ios::binary | std::ios::app);
+    ReportBatchHeader header{REPORT_BATCH_MAGIC, 0xffffffffU, 0};
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  }
+  std::vector<ReportRecord> records;
+  EXPECT_EQ(ReportLog::Read(path, &records), 1);
+  remove(path.c_str());
+}
@@ -0,0 +1,80 @@
+#include <string>
+#include "gtest/gtest.h"
+#include "lars_reactor/reactor_buffer.h"
+
+// 测试容量按页大小向上取整
+TEST(RingBufferTest, CapacityTest) {
+  RingBuffer ring(1000);
+  ASSERT_TRUE(ring.Valid());
+  EXPECT_EQ(ring.GetCapacity() % 4096, 0);
+  EXPECT_EQ(ring.GetFree(), ring.GetCapacity());
+}
+
+// 测试跨越环尾的数据在地址上仍然连续
+TEST(RingBufferTest, WrapAroundTest) {
+  RingBuffer ring(4096);
+  ASSERT_TRUE(ring.Valid());
+  int cap = ring.GetCapacity();
+
+  // 先写入再处理掉大部分数据，让head靠近环尾
+  ring.Push(cap - 10);
+  ring.Pop(cap - 20);
+  EXPECT_EQ(ring.GetLength(), 10);
+
+  // 写入跨越环尾的数据
+  std::string msg(100, 'x');
+  msg[0] = 'a';
+  msg[99] = 'z';
+  memcpy(ring.Tail(), msg.data(), msg.size());
+  ring.Push(static_cast<int>(msg.size()));
+
+  ring.Pop(10);
+  EXPECT_EQ(ring.GetLength(), 100);
+  EXPECT_EQ(std::string(ring.Data(), 100), msg);
+
+  ring.Pop(100);
+  EXPECT_EQ(ring.GetLength(), 0);
+}
+
+// 测试InputBuffer/OutputBuffer的环形缓冲区模式
+TEST(RingBufferTest, ReactorBufferTest) {
+  int fds[2];
+  ASSERT_EQ(pipe(fds), 0);
+
+  OutputBuffer obuf;
+  InputBuffer ibuf;
+  ASSERT_TRUE(obuf.EnableRing(4096));
+  ASSERT_TRUE(ibuf.EnableRing(4096));
+
+  // 反复收发，使读写位置多次绕过环尾
+  std::string msg(1500, 'm');
+  for (int i = 0; i < 10; ++i) {
+    msg[0] = static_cast<char>('0' + i);
+    ASSERT_EQ(obuf.SentData(msg.data(), static_cast<int>(msg.size())), 0);
+    while (obuf.Length() > 0) {
+      ASSERT_GT(obuf.WriteFd(fds[1]), 0);
+    }
+    while (ibuf.Length() < static_cast<int>(msg.size())) {
+      ASSERT_GT(ibuf.ReadData(fds[0]), 0);
+    }
+    EXPECT_EQ(std::string(ibuf.Data(), msg.size()), msg);
+    ibuf.Pop(static_cast<int>(msg.size()));
+    ibuf.Adjust();
+  }
+  close(fds[0]);
+  close(fds[1]);
+}
+
+// 测试只能在缓冲区为空时切换模式
+TEST(RingBufferTest, DisableRingTest) {
+  OutputBuffer obuf;
+  ASSERT_TRUE(obuf.EnableRing(4096));
+  ASSERT_EQ(obuf.SentData("abc", 3), 0);
+  EXPECT_FALSE(obuf.DisableRing());
+  EXPECT_TRUE(obuf.IsRing());
+  obuf.Pop(3);
+  EXPECT_TRUE(obuf.DisableRing());
+  EXPECT_FALSE(obuf.IsRing());
+  ASSERT_EQ(obuf.SentData("abc", 3), 0);
+  EXPECT_EQ(obuf.Length(), 3);
+}
@@ -0,0 +1,195 @@
+#include <atomic>
+#include <fstream>
+#include <thread>
+#include <vector>
+#include "gtest/gtest.h"
+#include "lars_dns/route_loader.h"
+#include "lars_dns/route_table.h"
+
+// 测试快照替换后查询到新路由
+TEST(RouteTableTest, UpdateQueryTest) {
+  RouteTable table;
+  int reader = table.RegisterReader();
+  ASSERT_NE(reader, -1);
+
+  std::vector<HostInfo> hosts;
+  EXPECT_FALSE(table.Query(reader, 1, 1, &hosts));
+
+  std::unique_ptr<RouteSnapshot> snapshot(new RouteSnapshot);
+  snapshot->routes_[RouteKey(1, 1)] = {{1, 80}, {2, 81}};
+  snapshot->version_ = 1;
+  table.Update(std::move(snapshot));
+
+  ASSERT_TRUE(table.Query(reader, 1, 1, &hosts));
+  EXPECT_EQ(hosts.size(), 2);
+  EXPECT_EQ(hosts[1].port_, 81);
+  EXPECT_EQ(table.GetVersion(reader), 1);
+}
+
+// 测试持续更新时多个读者看到的快照始终完整
+TEST(RouteTableTest, ConcurrentReadUpdateTest) {
+  RouteTable table;
+  std::atomic<bool> stop(false);
+  std::atomic<int> errors(0);
+
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 4; ++i) {
+    readers.emplace_back([&]() {
+      int reader = table.RegisterReader();
+      std::vector<HostInfo> hosts;
+      while (!stop) {
+        // 每份快照中两个路由的主机个数一致
+        bool a = table.Query(reader, 1, 1, &hosts);
+        size_t n = hosts.size();
+        if (a && n != hosts.back().ip_) {
+          ++errors;
+        }
+      }
+    });
+  }
+  for (uint32_t v = 1; v <= 200; ++v) {
+    std::unique_ptr<RouteSnapshot> snapshot(new RouteSnapshot);
+    snapshot->routes_[RouteKey(1, 1)].assign(v, {v, 80});
+    snapshot->version_ = v;
+    table.Update(std::move(snapshot));
+  }
+  stop = true;
+  for (auto& t : readers) {
+    t.join();
+  }
+  EXPECT_EQ(errors, 0);
+}
+
+// 测试路由文件的解析
+TEST(RouteLoaderTest, ParseTest) {
+  const char* path = "test_route_loader.conf";
+  {
+    std::ofstream out(path);
+    out << "# modid cmdid ip port\n"
+        << "1 1 127.0.0.1 7777\n"
+        << "1 1 127.0.0.2 7778\n"
+        << "2 3 10.0.0.1 80\n"
+        << "bad line\n";
+  }
+  RouteTable table;
+  RouteLoader loader(&table, path);
+  ASSERT_EQ(loader.Load(), 0);
+  int reader = table.RegisterReader();
+  std::vector<HostInfo> hosts;
+  ASSERT_TRUE(table.Query(reader, 1, 1, &hosts));
+  EXPECT_EQ(hosts.size(), 2);
+  ASSERT_TRUE(table.Query(reader, 2, 3, &hosts));
+  EXPECT_EQ(hosts[0].port_, 80);
+  remove(path);
+}
+
+// 测试二进制快照的写入、映射和查询
+TEST(RouteFileTest, WriteOpenTest) {
+  const char* path = "test_route_file.snap";
+  RouteSnapshot snapshot;
+  snapshot.version_ = 7;
+  for (int i = 0; i < 1000; ++i) {
+    snapshot.routes_[RouteKey(i, i * 2)] = {{static_cast<uint32_t>(i), 80},
+                                            {static_cast<uint32_t>(i), 81}};
+  }
+  ASSERT_EQ(RouteFile::Write(path, snapshot), 0);
+  ASSERT_TRUE(RouteFile::IsRouteFile(path));
+
+  auto file = RouteFile::Open(path);
+  ASSERT_NE(file, nullptr);
+  EXPECT_EQ(file->GetVersion(), 7);
+  EXPECT_EQ(file->GetEntryNum(), 1000);
+
+  std::vector<HostInfo> hosts;
+  ASSERT_TRUE(file->Find(RouteKey(500, 1000), &hosts));
+  ASSERT_EQ(hosts.size(), 2);
+  EXPECT_EQ(hosts[0].ip_, 500);
+  EXPECT_EQ(hosts[1].port_, 81);
+  EXPECT_FALSE(file->Find(RouteKey(500, 1), &hosts));
+
+  // 通过RouteLoader加载二进制快照，替换到路由表中
+  RouteTable table;
+  RouteLoader loader(&table, path);
+  ASSERT_EQ(loader.Load(), 0);
+  int reader = table.RegisterReader();
+  ASSERT_TRUE(table.Query(reader, 999, 1998, &hosts));
+  EXPECT_EQ(hosts[0].ip_, 999);
+  EXPECT_EQ(table.GetVersion(reader), 7);
+  remove(path);
+}
+
+// 测试校验和不一致的快照被拒绝
+TEST(RouteFileTest, ChecksumTest) {
+  const char* path = "test_route_file_bad.snap";
+  RouteSnapshot snapshot;
+  snapshot.routes_[RouteKey(1, 1)] = {{1, 80}};
+  ASSERT_EQ(RouteFile::Write(path, snapshot), 0);
+  {
+    // 篡改最后一个字节
+    std::fstream f(path, std::ios::in | std::ios::out | std::ios::binary);
+    f.seekp(-1, std::ios::end);
+    f.put('x');
+  }
+  EXPECT_EQ(RouteFile::Open(path), nullptr);
+  EXPECT_NE(RouteFile::Open(path, false), nullptr);
+  remove(path);
+}
+
+// 覆盖快照文件中offset处的数据
+template <typename T>
+static void Patch(const char* path, size_t offset, T value) {
+  std::fstream f(path, std::ios::in | std::ios::out | std::ios::binary);
+  f.seekp(offset);
+  f.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+// 测试不校验校验和时仍然拒绝会越界的快照
+TEST(RouteFileTest, ValidateTest) {
+  const char* path = "test_route_file_invalid.snap";
+  RouteSnapshot snapshot;
+  snapshot.routes_[RouteKey(1, 1)] = {{1, 80}};
+  snapshot.routes_[RouteKey(2, 2)] = {{2, 80}, {3, 80}};
+  size_t entries = sizeof(RouteFileHeader);
+
+  // 主机下标超出主机数组
+  ASSERT_EQ(RouteFile::Write(path, snapshot), 0);
+  Patch<uint32_t>(path, entries + sizeof(RouteFileEntry) + 8, 2);
+  EXPECT_EQ(RouteFile::Open(path, false), nullptr);
+
+  // key没有升序排列
+  ASSERT_EQ(RouteFile::Write(path, snapshot), 0);
+  Patch<uint64_t>(path, entries + sizeof(RouteFileEntry), 0);
+  EXPECT_EQ(RouteFile::Open(path, false), nullptr);
+
+  // 个数相乘会溢出的文件头
+  ASSERT_EQ(RouteFile::Write(path, snapshot), 0);
+  Patch<uint64_t>(path, offsetof(RouteFileHeader, entry_num_),
+                  (1ULL << 60) + 2);
+  EXPECT_EQ(RouteFile::Open(path, false), nullptr);
+
+  ASSERT_EQ(RouteFile::Write(path, snapshot), 0);
+  EXPECT_NE(RouteFile::Open(path, false), nullptr);
+  remove(path);
+}
+
+// 测试文本路由文件转换为二进制快照时写入指定的版本号
+TEST(RouteLoaderTest, DumpVersionTest) {
+  const char* path = "test_route_dump.conf";
+  const char* snap = "test_route_dump.snap";
+  {
+    std::ofstream out(path);
+    out << "1 1 127.0.0.1 7777\n";
+  }
+  ASSERT_EQ(RouteLoader::Dump(path, snap, 42), 0);
+  auto file = RouteFile::Open(snap);
+  ASSERT_NE(file, nullptr);
+  EXPECT_EQ(file->GetVersion(), 42);
+  EXPECT_EQ(file->GetEntryNum(), 1);
+
+  RouteTable table;
+  RouteLoader loader(&table, snap);
+  ASSERT_EQ(loader.Load(), 0);
+  EXPECT_EQ(table.GetVersion(table.RegisterReader()), 42);
+  remove(path);
+  remove(snap);
+}
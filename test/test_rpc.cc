@@ -0,0 +1,149 @@
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include "gtest/gtest.h"
+#include "lars_reactor/rpc_client.h"
+#include "lars_reactor/rpc_server.h"
+#include "lars_reactor/shm_channel.h"
+
+// 在一对进程内的共享内存通道上测试rpc
+class RpcTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    int fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    server_ = ShmChannel::Create(&loop_, &server_router_, 64 * 1024);
+    ASSERT_NE(server_, nullptr);
+    ASSERT_EQ(server_->SendFds(fds[0]), 0);
+    close(fds[0]);
+    client_ = ShmChannel::RecvFds(fds[1], &loop_, &client_router_);
+    ASSERT_NE(client_, nullptr);
+    rpc_server_.reset(new RpcServer(&loop_, &server_router_));
+    rpc_client_.reset(new RpcClient(&loop_, client_.get(), &client_router_));
+    // 处理回调先保存请求，由测试决定回复顺序
+    rpc_server_->Register(1, [this](const char* data, int len,
+                                    const RpcContext& ctx) {
+      requests_.emplace_back(std::string(data, len), ctx);
+    });
+  }
+
+  // 发起一次调用，结果追加到results_
+  uint64_t Call(const std::string& req, uint32_t timeout_ms) {
+    return rpc_client_->Call(
+        1, req.data(), static_cast<int>(req.size()), timeout_ms,
+        [this](int status, const char* data, int len) {
+          results_.emplace_back(status, std::string(data, len));
+        });
+  }
+
+  EventLoop loop_;
+  MsgRouter server_router_;
+  MsgRouter client_router_;
+  std::unique_ptr<ShmChannel> server_;
+  std::unique_ptr<ShmChannel> client_;
+  std::unique_ptr<RpcServer> rpc_server_;
+  std::unique_ptr<RpcClient> rpc_client_;
+  std::vector<std::pair<std::string, RpcContext>> requests_;
+  std::vector<std::pair<int, std::string>> results_;
+};
+
+// 测试同一连接上的并发请求乱序返回
+TEST_F(RpcTest, OutOfOrderTest) {
+  for (int i = 0; i < 100; ++i) {
+    ASSERT_NE(Call(std::to_string(i), 0), 0);
+  }
+  EXPECT_EQ(rpc_client_->GetPendingNum(), 100);
+  server_->DoRead();
+  ASSERT_EQ(requests_.size(), 100);
+  // 倒序回复
+  for (auto itr = requests_.rbegin(); itr != requests_.rend(); ++itr) {
+    std::string resp = "re:" + itr->first;
+    ASSERT_EQ(itr->second.Reply(resp.data(), static_cast<int>(resp.size())), 0);
+  }
+  client_->DoRead();
+  ASSERT_EQ(results_.size(), 100);
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_EQ(results_[i].first, RPC_OK);
+    EXPECT_EQ(results_[i].second, "re:" + std::to_string(99 - i));
+  }
+  EXPECT_EQ(rpc_client_->GetPendingNum(), 0);
+}
+
+// 测试客户端超时，超时之后到达的响应被丢弃
+TEST_F(RpcTest, ClientTimeoutTest) {
+  ASSERT_NE(Call("slow", 20), 0);
+  ASSERT_NE(Call("fast", 0), 0);
+  server_->DoRead();
+  ASSERT_EQ(requests_.size(), 2);
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(30));
+  rpc_client_->OnTick();
+  ASSERT_EQ(results_.size(), 1);
+  EXPECT_EQ(results_[0].first, RPC_TIMEOUT);
+  EXPECT_EQ(rpc_client_->GetPendingNum(), 1);
+
+  // 超时的槽位被复用，旧的响应不能匹配到新的调用
+  ASSERT_NE(Call("next", 0), 0);
+  requests_[0].second.Reply("late", 4);
+  client_->DoRead();
+  EXPECT_EQ(results_.size(), 1);
+
+  rpc_client_->FailAll();
+  ASSERT_EQ(results_.size(), 3);
+  EXPECT_EQ(results_[1].first, RPC_CLOSED);
+  EXPECT_EQ(results_[2].first, RPC_CLOSED);
+  EXPECT_EQ(rpc_client_->GetPendingNum(), 0);
+}
+
+// 测试服务端丢弃处理前已经超时的请求
+TEST_F(RpcTest, ServerExpireTest) {
+  ASSERT_NE(Call("a", 5), 0);
+  ASSERT_NE(Call("b", 1000), 0);
+  // 事件循环时间停留在构造时，模拟请求在本轮事件中等待了很久
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  server_->DoRead();
+  ASSERT_EQ(requests_.size(), 1);
+  EXPECT_EQ(requests_[0].first, "b");
+  EXPECT_NE(requests_[0].second.GetDeadlineNs(), 0);
+  EXPECT_EQ(rpc_server_->GetExpiredNum(), 1);
+}
+
+// 测试保存的上下文在连接关闭和销毁之后回复失败
+TEST_F(RpcTest, ReplyAfterCloseTest) {
+  ASSERT_NE(Call("a", 0), 0);
+  ASSERT_NE(Call("b", 0), 0);
+  server_->DoRead();
+  ASSERT_EQ(requests_.size(), 2);
+  EXPECT_EQ(requests_[0].second.GetConn(), server_.get());
+
+  server_->Close();
+  EXPECT_EQ(requests_[0].second.GetConn(), nullptr);
+  EXPECT_EQ(requests_[0].second.Reply("late", 4), -1);
+  server_.reset();
+  EXPECT_EQ(requests_[1].second.Reply("late", 4), -1);
+}
+
+// 测试连接关闭时结束全部未完成的调用，之后的调用失败
+TEST_F(RpcTest, CloseFailAllTest) {
+  ASSERT_NE(Call("a", 100), 0);
+  ASSERT_NE(Call("b", 0), 0);
+  client_->Close();
+  ASSERT_EQ(results_.size(), 2);
+  EXPECT_EQ(results_[0].first, RPC_CLOSED);
+  EXPECT_EQ(results_[1].first, RPC_CLOSED);
+  EXPECT_EQ(rpc_client_->GetPendingNum(), 0);
+  EXPECT_EQ(Call("c", 0), 0);
+}
+
+// 测试同一路由上的第二个客户端注册失败，析构后取消注册
+TEST_F(RpcTest, RegisterTest) {
+  RpcClient second(&loop_, client_.get(), &client_router_);
+  EXPECT_EQ(second.Call(1, "a", 1, 0, nullptr), 0);
+  rpc_client_.reset();
+  RpcClient third(&loop_, client_.get(), &client_router_);
+  EXPECT_NE(third.Call(1, "a", 1, 0, nullptr), 0);
+}
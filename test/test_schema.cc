@@ -0,0 +1,95 @@
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <string>
+#include "gtest/gtest.h"
+#include "lars_reactor/schema.h"
+#include "lars_reactor/tcp_conn.h"
+
+using HostSchema = Schema<Field<uint32_t>, Field<uint16_t>>;
+enum { kIp, kPort };
+using RouteSchema = Schema<Field<int32_t>, Field<int64_t>, Bytes<4>>;
+enum { kModid, kVersion, kTag };
+
+static_assert(HostSchema::kSize == 6, "packed size");
+static_assert(RouteSchema::kSize == 16, "packed size");
+static_assert(RouteSchema::Offset<kVersion>() == 4, "offset");
+static_assert(RouteSchema::Offset<kTag>() == 12, "offset");
+
+// 测试线上格式为小端序
+TEST(SchemaTest, LittleEndianTest) {
+  char buf[HostSchema::kSize];
+  MsgBuilder<HostSchema>(buf).Set<kIp>(0x01020304).Set<kPort>(0x0506);
+  const unsigned char expect[] = {4, 3, 2, 1, 6, 5};
+  EXPECT_EQ(memcmp(buf, expect, sizeof(expect)), 0);
+
+  MsgView<HostSchema> view(buf, sizeof(buf));
+  ASSERT_TRUE(view.Valid());
+  EXPECT_EQ(view.Get<kIp>(), 0x01020304u);
+  EXPECT_EQ(view.Get<kPort>(), 0x0506);
+}
+
+// 测试定长部分加变长数组尾部
+TEST(SchemaTest, ArrayTest) {
+  std::string buf(RouteSchema::kSize + 3 * HostSchema::kSize, '\0');
+  MsgBuilder<RouteSchema> builder(&buf[0]);
+  builder.Set<kModid>(-7).Set<kVersion>(1LL << 40).Set<kTag>("abcd");
+  for (int i = 0; i < 3; ++i) {
+    MsgBuilder<HostSchema>(builder.Tail() + i * HostSchema::kSize)
+        .Set<kIp>(100 + i)
+        .Set<kPort>(8000 + i);
+  }
+
+  MsgView<RouteSchema> view(buf.data(), static_cast<int>(buf.size()));
+  EXPECT_EQ(view.Get<kModid>(), -7);
+  EXPECT_EQ(view.Get<kVersion>(), 1LL << 40);
+  // 字节字段直接指向缓冲区
+  EXPECT_EQ(view.Get<kTag>(), buf.data() + 12);
+  ArrayView<HostSchema> hosts(view.Tail(), view.TailLength());
+  ASSERT_EQ(hosts.Size(), 3);
+  EXPECT_EQ(hosts[2].Get<kIp>(), 102u);
+  EXPECT_EQ(hosts[2].Get<kPort>(), 8002);
+
+  EXPECT_FALSE(MsgView<RouteSchema>(buf.data(), 10).Valid());
+}
+
+// 测试typed回调和直接编码到输出缓冲区
+TEST(SchemaTest, ConnectionTest) {
+  int fds[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  EventLoop loop;
+  MsgRouter router;
+  TcpConn conn(fds[0], &loop);
+  conn.SetRouter(&router);
+  int calls = 0;
+  RegisterView<HostSchema>(
+      &router, 1, [&](const MsgView<HostSchema>& view, NetConnection* c) {
+        ++calls;
+        SendView<HostSchema>(c, 2, [&](MsgBuilder<HostSchema>& builder) {
+          builder.Set<kIp>(view.Get<kIp>() + 1).Set<kPort>(view.Get<kPort>());
+        });
+      });
+
+  // 一条合法消息，一条长度不足的消息
+  std::string msg(MESSAGE_HEAD_LEN + HostSchema::kSize, '\0');
+  EncodeHead(&msg[0], 1, HostSchema::kSize);
+  MsgBuilder<HostSchema>(&msg[MESSAGE_HEAD_LEN]).Set<kIp>(41).Set<kPort>(80);
+  std::string short_msg(MESSAGE_HEAD_LEN + 2, '\0');
+  EncodeHead(&short_msg[0], 1, 2);
+  msg += short_msg;
+  ASSERT_EQ(write(fds[1], msg.data(), msg.size()), msg.size());
+  conn.DoRead();
+  EXPECT_EQ(calls, 1);
+  conn.DoWrite();
+
+  char buf[64];
+  ASSERT_EQ(read(fds[1], buf, sizeof(buf)), MESSAGE_HEAD_LEN + HostSchema::kSize);
+  MsgHead head = DecodeHead(buf);
+  EXPECT_EQ(head.msg_id_, 2);
+  EXPECT_EQ(head.msg_len_, HostSchema::kSize);
+  MsgView<HostSchema> reply(buf + MESSAGE_HEAD_LEN, head.msg_len_);
+  EXPECT_EQ(reply.Get<kIp>(), 42u);
+  EXPECT_EQ(reply.Get<kPort>(), 80);
+  conn.CleanConn();
+  close(fds[1]);
+}
@@ -0,0 +1,244 @@
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <string>
+#include <vector>
+#include "gtest/gtest.h"
+#include "lars_reactor/message.h"
+#include "lars_reactor/shm_channel.h"
+
+//测试使用的环大小，页大小的整数倍且不小于SHM_RING_MIN_SIZE
+#define TEST_RING_SIZE 65536
+
+// 服务端创建通道，通过socketpair把fd交给客户端
+class ShmChannelTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    server_router_.Register(1, [this](const char* data, int len, int msg_id,
+                                      void* args, NetConnection* conn) {
+      server_msgs_.emplace_back(data, len);
+      // 原样回复给客户端
+      conn->SendMessage(data, len, 2);
+    });
+    client_router_.Register(2, [this](const char* data, int len, int msg_id,
+                                      void* args, NetConnection* conn) {
+      client_msgs_.emplace_back(data, len);
+    });
+    int fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    server_ = ShmChannel::Create(&loop_, &server_router_, TEST_RING_SIZE);
+    ASSERT_NE(server_, nullptr);
+    ASSERT_EQ(server_->SendFds(fds[0]), 0);
+    close(fds[0]);
+    client_ = ShmChannel::RecvFds(fds[1], &loop_, &client_router_);
+    ASSERT_NE(client_, nullptr);
+  }
+
+  EventLoop loop_;
+  MsgRouter server_router_;
+  MsgRouter client_router_;
+  std::unique_ptr<ShmChannel> server_;
+  std::unique_ptr<ShmChannel> client_;
+  std::vector<std::string> server_msgs_;
+  std::vector<std::string> client_msgs_;
+};
+
+// 测试双向收发
+TEST_F(ShmChannelTest, RoundTripTest) {
+  ASSERT_EQ(client_->SendMessage("hello", 5, 1), 0);
+  server_->DoRead();
+  ASSERT_EQ(server_msgs_.size(), 1);
+  EXPECT_EQ(server_msgs_[0], "hello");
+  client_->DoRead();
+  ASSERT_EQ(client_msgs_.size(), 1);
+  EXPECT_EQ(client_msgs_[0], "hello");
+}
+
+// 测试消费者未休眠时连续发送只敲一次doorbell
+TEST_F(ShmChannelTest, DoorbellSuppressTest) {
+  for (int i = 0; i < 10; ++i) {
+    ASSERT_EQ(client_->SendMessage("ping", 4, 1), 0);
+  }
+  EXPECT_EQ(client_->GetDoorbellNum(), 1);
+  server_->DoRead();
+  EXPECT_EQ(server_msgs_.size(), 10);
+
+  // 消费者处理完后重新进入等待，下一条消息需要doorbell
+  ASSERT_EQ(client_->SendMessage("ping", 4, 1), 0);
+  EXPECT_EQ(client_->GetDoorbellNum(), 2);
+}
+
+// 测试环满和跨越环尾
+TEST_F(ShmChannelTest, WrapAroundTest) {
+  std::string msg(1000, 'x');
+  int sent = 0;
+  while (client_->SendMessage(msg.data(), msg.size(), 1) == 0) {
+    ++sent;
+  }
+  EXPECT_EQ(sent, TEST_RING_SIZE / (1000 + MESSAGE_HEAD_LEN));
+  server_->DoRead();
+  EXPECT_EQ(server_msgs_.size(), sent);
+
+  // head已经接近环尾，再写入的消息会跨越环尾
+  msg[0] = 'a';
+  msg[999] = 'z';
+  ASSERT_EQ(client_->SendMessage(msg.data(), msg.size(), 1), 0);
+  ASSERT_EQ(client_->SendMessage(msg.data(), msg.size(), 1), 0);
+  server_->DoRead();
+  ASSERT_EQ(server_msgs_.size(), sent + 2);
+  EXPECT_EQ(server_msgs_.back(), msg);
+}
+
+// 测试没有注册回调的消息被计数
+TEST_F(ShmChannelTest, UnroutedTest) {
+  ASSERT_EQ(client_->SendMessage("ping", 4, 3), 0);
+  ASSERT_EQ(client_->SendMessage("ping", 4, 1), 0);
+  server_->DoRead();
+  EXPECT_EQ(server_->GetUnroutedNum(), 1);
+  EXPECT_EQ(server_msgs_.size(), 1);
+}
+
+// 扮演不可信的客户端，从unix socket接收通道的fd并映射控制头页和客户端到服务端的环
+static void* MapPeer(int unix_fd, int fds[3], int* ring_size) {
+  char control[CMSG_SPACE(3 * sizeof(int))];
+  struct iovec iov {};
+  iov.iov_base = ring_size;
+  iov.iov_len = sizeof(*ring_size);
+  struct msghdr msg {};
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+  if (recvmsg(unix_fd, &msg, 0) != sizeof(*ring_size)) {
+    return MAP_FAILED;
+  }
+  memcpy(fds, CMSG_DATA(CMSG_FIRSTHDR(&msg)), 3 * sizeof(int));
+  return mmap(nullptr, 4096 + *ring_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+              fds[0], 0);
+}
+
+// 扮演不可信的服务端，发送memfd和两个eventfd，环大小由调用方任意指定
+static void SendRawFds(int unix_fd, int memfd, int ring_size) {
+  int fds[3] = {memfd, eventfd(0, 0), eventfd(0, 0)};
+  char control[CMSG_SPACE(sizeof(fds))];
+  memset(control, 0, sizeof(control));
+  struct iovec iov {};
+  iov.iov_base = &ring_size;
+  iov.iov_len = sizeof(ring_size);
+  struct msghdr msg {};
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+  struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+  memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+  EXPECT_EQ(sendmsg(unix_fd, &msg, 0), sizeof(ring_size));
+  close(fds[1]);
+  close(fds[2]);
+}
+
+// 测试共享内存中的消息长度被改坏时关闭通道
+TEST(ShmChannelBadDataTest, BadLengthTest) {
+  EventLoop loop;
+  MsgRouter router;
+  int calls = 0;
+  router.Register(1, [&calls](const char* data, int len, int msg_id,
+                              void* args, NetConnection* conn) { ++calls; });
+  int sv[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sv), 0);
+  auto server = ShmChannel::Create(&loop, &router, TEST_RING_SIZE);
+  ASSERT_NE(server, nullptr);
+  ASSERT_EQ(server->SendFds(sv[0]), 0);
+
+  // 直接改写客户端到服务端的环
+  int fds[3];
+  int ring_size = 0;
+  void* addr = MapPeer(sv[1], fds, &ring_size);
+  ASSERT_NE(addr, MAP_FAILED);
+  auto header = static_cast<ShmRingHeader*>(addr);
+  char* data = static_cast<char*>(addr) + 4096;
+
+  MsgHead head{1, 4};
+  memcpy(data, &head, MESSAGE_HEAD_LEN);
+  memcpy(data + MESSAGE_HEAD_LEN, "ping", 4);
+  // 第二条消息声明的长度超过环中已有的数据
+  head.msg_len_ = 1000;
+  memcpy(data + MESSAGE_HEAD_LEN + 4, &head, MESSAGE_HEAD_LEN);
+  header->tail_.store(2 * MESSAGE_HEAD_LEN + 4);
+  server->DoRead();
+  EXPECT_EQ(calls, 1);
+  EXPECT_TRUE(server->IsClosed());
+  EXPECT_EQ(server->SendMessage("ping", 4, 1), -1);
+
+  munmap(addr, 4096 + ring_size);
+  for (int fd : fds) {
+    close(fd);
+  }
+  close(sv[0]);
+  close(sv[1]);
+}
+
+// 测试对端把发送环的消费者位置改到生产者之后时关闭通道
+TEST(ShmChannelBadDataTest, BadHeadTest) {
+  EventLoop loop;
+  MsgRouter router;
+  int sv[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sv), 0);
+  auto server = ShmChannel::Create(&loop, &router, TEST_RING_SIZE);
+  ASSERT_NE(server, nullptr);
+  ASSERT_EQ(server->SendFds(sv[0]), 0);
+
+  int fds[3];
+  int ring_size = 0;
+  void* addr = MapPeer(sv[1], fds, &ring_size);
+  ASSERT_NE(addr, MAP_FAILED);
+  // 服务端到客户端环的控制头在控制头页的后一半，由客户端消费
+  auto s2c = reinterpret_cast<ShmRingHeader*>(static_cast<char*>(addr) + 2048);
+  ASSERT_EQ(server->SendMessage("ping", 4, 1), 0);
+  s2c->head_.store(MESSAGE_HEAD_LEN + 4 + 1);
+  EXPECT_EQ(server->SendMessage("ping", 4, 1), -1);
+  EXPECT_TRUE(server->IsClosed());
+
+  munmap(addr, 4096 + ring_size);
+  for (int fd : fds) {
+    close(fd);
+  }
+  close(sv[0]);
+  close(sv[1]);
+}
+
+// 测试创建时拒绝放不下一条最长消息的环
+TEST(ShmChannelBadDataTest, RingSizeTest) {
+  EventLoop loop;
+  MsgRouter router;
+  EXPECT_EQ(ShmChannel::Create(&loop, &router, 4096), nullptr);
+  EXPECT_EQ(ShmChannel::Create(&loop, &router, SHM_RING_MIN_SIZE - 1),
+            nullptr);
+  EXPECT_NE(ShmChannel::Create(&loop, &router, SHM_RING_MIN_SIZE), nullptr);
+}
+
+// 测试客户端拒绝和memfd大小不匹配的环大小
+TEST(ShmChannelBadDataTest, RecvRingSizeTest) {
+  EventLoop loop;
+  MsgRouter router;
+  int memfd = memfd_create("test_shm_channel", MFD_CLOEXEC);
+  ASSERT_NE(memfd, -1);
+  ASSERT_EQ(ftruncate(memfd, 4096 + 2 * TEST_RING_SIZE), 0);
+  // 负数、不是页大小整数倍、超过memfd大小的环都拒绝，匹配的环正常映射
+  for (int ring_size : {-4096, 0, TEST_RING_SIZE + 1, 2 * TEST_RING_SIZE,
+                        TEST_RING_SIZE}) {
+    int sv[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sv), 0);
+    SendRawFds(sv[0], memfd, ring_size);
+    auto client = ShmChannel::RecvFds(sv[1], &loop, &router);
+    EXPECT_EQ(client != nullptr, ring_size == TEST_RING_SIZE) << ring_size;
+    close(sv[0]);
+  }
+  close(memfd);
+}
@@ -0,0 +1,208 @@
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+#include "gtest/gtest.h"
+#include "lars_reactor/msg_router.h"
+#include "lars_reactor/schema.h"
+#include "lars_reactor/slab_pool.h"
+#include "lars_reactor/tcp_conn.h"
+
+// 测试slab对象复用
+TEST(SlabPoolTest, ReuseTest) {
+  void* first = SlabPool::Alloc(100);
+  void* second = SlabPool::Alloc(100);
+  EXPECT_EQ(static_cast<char*>(second) - static_cast<char*>(first), 112);
+  SlabPool::Free(first, 100);
+  EXPECT_EQ(SlabPool::Alloc(97), first);
+  SlabPool::Free(first, 97);
+  SlabPool::Free(second, 100);
+}
+
+// 测试连接对象从slab分配，收发之后只保留读事件，不再持有buffer和ConnExtra
+TEST(TcpConnTest, IdleConnTest) {
+  int fds[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  EventLoop loop;
+  auto conn = std::allocate_shared<TcpConn>(SlabAllocator<TcpConn>(), fds[0],
+                                            &loop, nullptr);
+  ASSERT_NE(loop.GetData(fds[0]), nullptr);
+  EXPECT_EQ(loop.GetData(fds[0])->mask_, EPOLLIN);
+  EXPECT_FALSE(conn->HasBuffer());
+  EXPECT_FALSE(conn->HasExtra());
+
+  // 没有路由的消息回显
+  MsgHead head{1, 4};
+  std::string msg(reinterpret_cast<char*>(&head), MESSAGE_HEAD_LEN);
+  msg += "ping";
+  ASSERT_EQ(write(fds[1], msg.data(), msg.size()), msg.size());
+  conn->DoRead();
+  EXPECT_EQ(loop.GetData(fds[0])->mask_, EPOLLIN | EPOLLOUT);
+  EXPECT_TRUE(conn->HasBuffer());
+  conn->DoWrite();
+  EXPECT_EQ(loop.GetData(fds[0])->mask_, EPOLLIN);
+  EXPECT_FALSE(conn->HasBuffer());
+  EXPECT_FALSE(conn->HasExtra());
+
+  char buf[64];
+  ASSERT_EQ(read(fds[1], buf, sizeof(buf)), msg.size());
+  EXPECT_EQ(std::string(buf, msg.size()), msg);
+
+  // 文件发送完成后ConnExtra随之释放
+  int pipe_fds[2];
+  ASSERT_EQ(pipe(pipe_fds), 0);
+  ASSERT_EQ(write(pipe_fds[1], "pong", 4), 4);
+  ASSERT_EQ(conn->SendFile(pipe_fds[0], 0, 4, 2), 0);
+  EXPECT_TRUE(conn->HasExtra());
+  conn->DoWrite();
+  EXPECT_FALSE(conn->HasBuffer());
+  EXPECT_FALSE(conn->HasExtra());
+  ASSERT_EQ(read(fds[1], buf, sizeof(buf)), MESSAGE_HEAD_LEN + 4);
+  close(pipe_fds[0]);
+  close(pipe_fds[1]);
+
+  conn->CleanConn();
+  EXPECT_EQ(loop.GetData(fds[0]), nullptr);
+  close(fds[1]);
+}
+
+// 测试obuf不能切换时ibuf也保持普通缓冲区
+TEST(TcpConnTest, EnableRingRollbackTest) {
+  int fds[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  EventLoop loop;
+  auto conn = std::allocate_shared<TcpConn>(SlabAllocator<TcpConn>(), fds[0],
+                                            &loop, nullptr);
+  ASSERT_EQ(conn->SendMessage("ping", 4, 1), 0);
+  EXPECT_FALSE(conn->EnableRingBuffer(4096));
+  EXPECT_FALSE(conn->IsRingBuffer());
+
+  conn->DoWrite();
+  EXPECT_TRUE(conn->EnableRingBuffer(4096));
+  EXPECT_TRUE(conn->IsRingBuffer());
+  conn->CleanConn();
+  close(fds[1]);
+}
+
+// 测试普通文件通过sendfile发送
+TEST(TcpConnTest, SendFileTest) {
+  int fds[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  EventLoop loop;
+  auto conn = std::allocate_shared<TcpConn>(SlabAllocator<TcpConn>(), fds[0],
+                                            &loop, nullptr);
+  char path[] = "/tmp/lars_send_file_XXXXXX";
+  int file = mkstemp(path);
+  ASSERT_NE(file, -1);
+  unlink(path);
+  std::string content = "0123456789abcdefghij";
+  ASSERT_EQ(write(file, content.data(), content.size()), content.size());
+
+  ASSERT_EQ(conn->SendFile(file, 3, 10, 7), 0);
+  close(file);
+  EXPECT_EQ(loop.GetData(fds[0])->mask_, EPOLLIN | EPOLLOUT);
+  conn->DoWrite();
+  EXPECT_EQ(loop.GetData(fds[0])->mask_, EPOLLIN);
+  char buf[64];
+  ASSERT_EQ(read(fds[1], buf, sizeof(buf)), MESSAGE_HEAD_LEN + 10);
+  MsgHead head = DecodeHead(buf);
+  EXPECT_EQ(head.msg_id_, 7);
+  EXPECT_EQ(head.msg_len_, 10);
+  EXPECT_EQ(std::string(buf + MESSAGE_HEAD_LEN, 10), content.substr(3, 10));
+
+  // 没有开启大消息模式时不能发送超长的消息
+  EXPECT_EQ(conn->SendFile(fds[1], 0, MESSAGE_LENGTH_LIMIT + 1, 7), -1);
+  conn->CleanConn();
+  close(fds[1]);
+}
+
+// 测试管道数据源暂时没有数据时停止关注可写，可读后继续splice
+TEST(TcpConnTest, SpliceWaitTest) {
+  int fds[2], source[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  ASSERT_EQ(pipe(source), 0);
+  EventLoop loop;
+  auto conn = std::allocate_shared<TcpConn>(SlabAllocator<TcpConn>(), fds[0],
+                                            &loop, nullptr);
+  ASSERT_EQ(write(source[1], "hello", 5), 5);
+  ASSERT_EQ(conn->SendFile(source[0], 0, 10, 8), 0);
+  conn->DoWrite();
+  EXPECT_EQ(loop.GetData(fds[0])->mask_, EPOLLIN);
+  char buf[64];
+  ASSERT_EQ(read(fds[1], buf, sizeof(buf)), MESSAGE_HEAD_LEN + 5);
+  EXPECT_EQ(std::string(buf + MESSAGE_HEAD_LEN, 5), "hello");
+
+  ASSERT_EQ(write(source[1], "world", 5), 5);
+  loop.RunAfter(20, [&loop]() { loop.Stop(); });
+  loop.EventProcess();
+  EXPECT_EQ(loop.GetData(fds[0])->mask_, EPOLLIN);
+  ASSERT_EQ(read(fds[1], buf, sizeof(buf)), 5);
+  EXPECT_EQ(std::string(buf, 5), "world");
+
+  conn->CleanConn();
+  close(source[0]);
+  close(source[1]);
+  close(fds[1]);
+}
+
+// 测试连接的弱引用在连接关闭后失效并执行关闭回调
+TEST(TcpConnTest, HandleTest) {
+  int fds[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  EventLoop loop;
+  auto conn = std::allocate_shared<TcpConn>(SlabAllocator<TcpConn>(), fds[0],
+                                            &loop, nullptr);
+  std::shared_ptr<ConnHandle> handle = conn->GetHandle();
+  ASSERT_NE(handle, nullptr);
+  EXPECT_EQ(handle->Get(), conn.get());
+  EXPECT_EQ(conn->GetHandle(), handle);
+  bool closed = false;
+  handle->AddCloseCallback([&closed]() { closed = true; });
+  conn->CleanConn();
+  EXPECT_TRUE(closed);
+  EXPECT_EQ(handle->Get(), nullptr);
+  EXPECT_EQ(conn->GetHandle()->Get(), nullptr);
+  close(fds[1]);
+}
+
+// 测试空消息体的帧：移除消息头后ibuf已经归还buffer，移除0字节的消息体不能出错
+TEST(TcpConnTest, EmptyBodyTest) {
+  int fds[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  EventLoop loop;
+  MsgRouter router;
+  std::vector<std::string> received;
+  router.Register(1, [&received](const char* data, int len, int msg_id,
+                                 void* args, NetConnection* conn) {
+    received.emplace_back(data, len);
+  });
+  auto conn = std::allocate_shared<TcpConn>(SlabAllocator<TcpConn>(), fds[0],
+                                            &loop, nullptr);
+  conn->SetRouter(&router);
+
+  // ibuf中只有一个空消息体的帧
+  char head[MESSAGE_HEAD_LEN];
+  EncodeHead(head, 1, 0);
+  ASSERT_EQ(write(fds[1], head, MESSAGE_HEAD_LEN), MESSAGE_HEAD_LEN);
+  conn->DoRead();
+  ASSERT_EQ(received.size(), 1);
+  EXPECT_EQ(received[0], "");
+  EXPECT_NE(conn->GetFd(), -1);
+  EXPECT_FALSE(conn->HasBuffer());
+
+  // 空消息体的帧后面还有帧
+  std::string msgs(head, MESSAGE_HEAD_LEN);
+  msgs.append(head, MESSAGE_HEAD_LEN);
+  EncodeHead(head, 1, 4);
+  msgs.append(head, MESSAGE_HEAD_LEN);
+  msgs += "ping";
+  ASSERT_EQ(write(fds[1], msgs.data(), msgs.size()), msgs.size());
+  conn->DoRead();
+  ASSERT_EQ(received.size(), 4);
+  EXPECT_EQ(received[3], "ping");
+  EXPECT_FALSE(conn->HasBuffer());
+
+  conn->CleanConn();
+  close(fds[1]);
+}
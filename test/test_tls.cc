@@ -0,0 +1,258 @@
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/x509.h>
+#include <openssl/x509v3.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+#include "gtest/gtest.h"
+#include "lars_reactor/schema.h"
+#include "lars_reactor/tcp_client.h"
+#include "lars_reactor/tcp_conn.h"
+#include "lars_reactor/tcp_server.h"
+
+// 生成一张内存中的自签名证书，san不为空时加上subjectAltName扩展
+static void MakeSelfSigned(std::string* cert_pem, std::string* key_pem,
+                           const char* san = nullptr) {
+  EVP_PKEY* key = EVP_EC_gen("P-256");
+  X509* cert = X509_new();
+  ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+  X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+  X509_gmtime_adj(X509_getm_notAfter(cert), 3600);
+  X509_set_pubkey(cert, key);
+  X509_NAME* name = X509_get_subject_name(cert);
+  X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC,
+                             reinterpret_cast<const unsigned char*>("lars"),
+                             -1, -1, 0);
+  X509_set_issuer_name(cert, name);
+  if (san != nullptr) {
+    X509V3_CTX ctx;
+    X509V3_set_ctx_nodb(&ctx);
+    X509V3_set_ctx(&ctx, cert, cert, nullptr, nullptr, 0);
+    X509_EXTENSION* ext =
+        X509V3_EXT_conf_nid(nullptr, &ctx, NID_subject_alt_name, san);
+    X509_add_ext(cert, ext, -1);
+    X509_EXTENSION_free(ext);
+  }
+  X509_sign(cert, key, EVP_sha256());
+
+  BIO* bio = BIO_new(BIO_s_mem());
+  PEM_write_bio_X509(bio, cert);
+  char* data;
+  long len = BIO_get_mem_data(bio, &data);
+  cert_pem->assign(data, len);
+  BIO_free(bio);
+  bio = BIO_new(BIO_s_mem());
+  PEM_write_bio_PrivateKey(bio, key, nullptr, nullptr, 0, nullptr, nullptr);
+  len = BIO_get_mem_data(bio, &data);
+  key_pem->assign(data, len);
+  BIO_free(bio);
+  X509_free(cert);
+  EVP_PKEY_free(key);
+}
+
+// 在回环地址上建立一对tls连接
+class TlsTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    std::string cert_pem, key_pem;
+    MakeSelfSigned(&cert_pem, &key_pem);
+    server_ctx_ = TlsContext::CreateServerFromPem(cert_pem, key_pem);
+    ASSERT_NE(server_ctx_, nullptr);
+    client_ctx_ = TlsContext::CreateInsecureClient();
+    ASSERT_NE(client_ctx_, nullptr);
+
+    server_.reset(new TcpServer(&loop_, "127.0.0.1", 0));
+    server_->SetTls(server_ctx_.get());
+    struct sockaddr_in addr {};
+    socklen_t addr_len = sizeof(addr);
+    getsockname(server_->GetListenFd(), reinterpret_cast<sockaddr*>(&addr),
+                &addr_len);
+    client_.reset(new TcpClient(&loop_, "127.0.0.1", ntohs(addr.sin_port)));
+    client_->SetTls(client_ctx_.get());
+    client_->AddMsgRouter(1, [this](const char* data, int len, int msg_id,
+                                    void* args, NetConnection* conn) {
+      reply_.assign(data, len);
+      loop_.Stop();
+    });
+    // 防止握手失败时测试卡住
+    loop_.RunAfter(3000, [this]() { loop_.Stop(); });
+  }
+
+  EventLoop loop_;
+  std::unique_ptr<TlsContext> server_ctx_;
+  std::unique_ptr<TlsContext> client_ctx_;
+  std::unique_ptr<TcpServer> server_;
+  std::unique_ptr<TcpClient> client_;
+  std::string reply_;
+};
+
+// 测试握手期间发送的多个tls记录长度的消息在握手完成后回显
+TEST_F(TlsTest, EchoTest) {
+  // 连接和握手完成之前发送的消息先缓存
+  ASSERT_NE(client_->Connect(), -1);
+
+  std::string msg(3 * TLS_RECORD_SIZE + 100, 'x');
+  for (size_t i = 0; i < msg.size(); ++i) {
+    msg[i] = static_cast<char>('a' + i % 26);
+  }
+  ASSERT_EQ(client_->SendMessage(msg.data(), static_cast<int>(msg.size()), 1),
+            0);
+  loop_.EventProcess();
+  const TlsSession* tls = client_->GetConn()->GetTls();
+  ASSERT_NE(tls, nullptr);
+  EXPECT_TRUE(tls->Established());
+  EXPECT_EQ(reply_, msg);
+}
+
+// 测试用户态tls不能直接sendfile
+TEST_F(TlsTest, SendFileTest) {
+  ASSERT_NE(client_->Connect(), -1);
+  ASSERT_EQ(client_->SendMessage("ping", 4, 1), 0);
+  loop_.EventProcess();
+  ASSERT_EQ(reply_, "ping");
+  const TlsSession* tls = client_->GetConn()->GetTls();
+  int fd = open("/proc/self/exe", O_RDONLY);
+  ASSERT_NE(fd, -1);
+  int ret = client_->GetConn()->SendFile(fd, 0, 16, 2);
+  EXPECT_EQ(ret, tls->KernelSend() ? 0 : -1);
+  close(fd);
+}
+
+// 测试握手失败时关闭连接
+TEST_F(TlsTest, HandshakeFailTest) {
+  // 客户端要求校验证书，自签名证书校验失败
+  std::string cert_pem, key_pem;
+  MakeSelfSigned(&cert_pem, &key_pem);
+  char path[] = "/tmp/lars_tls_caXXXXXX";
+  int fd = mkstemp(path);
+  ASSERT_NE(fd, -1);
+  ASSERT_EQ(write(fd, cert_pem.data(), cert_pem.size()), cert_pem.size());
+  close(fd);
+  client_ctx_ = TlsContext::CreateClient(path);
+  unlink(path);
+  ASSERT_NE(client_ctx_, nullptr);
+  client_->SetTls(client_ctx_.get());
+
+  ASSERT_NE(client_->Connect(), -1);
+  client_->SendMessage("ping", 4, 1);
+  loop_.RunEvery(10, [this]() {
+    if (!client_->IsConnected()) {
+      loop_.Stop();
+    }
+  });
+  loop_.EventProcess();
+  EXPECT_FALSE(client_->IsConnected());
+  EXPECT_TRUE(reply_.empty());
+}
+
+// 服务端使用带subjectAltName的证书，客户端信任这张证书
+static void UsePeerCert(TcpServer* server,
+                        std::unique_ptr<TlsContext>* server_ctx,
+                        std::unique_ptr<TlsContext>* client_ctx) {
+  std::string cert_pem, key_pem;
+  MakeSelfSigned(&cert_pem, &key_pem, "IP:127.0.0.1");
+  *server_ctx = TlsContext::CreateServerFromPem(cert_pem, key_pem);
+  ASSERT_NE(*server_ctx, nullptr);
+  server->SetTls(server_ctx->get());
+  char path[] = "/tmp/lars_tls_caXXXXXX";
+  int fd = mkstemp(path);
+  ASSERT_NE(fd, -1);
+  ASSERT_EQ(write(fd, cert_pem.data(), cert_pem.size()), cert_pem.size());
+  close(fd);
+  *client_ctx = TlsContext::CreateClient(path);
+  unlink(path);
+  ASSERT_NE(*client_ctx, nullptr);
+}
+
+// 测试校验证书时默认检查证书中的ip和连接的ip一致
+TEST_F(TlsTest, PeerNameTest) {
+  UsePeerCert(server_.get(), &server_ctx_, &client_ctx_);
+  client_->SetTls(client_ctx_.get());
+  ASSERT_NE(client_->Connect(), -1);
+  ASSERT_EQ(client_->SendMessage("ping", 4, 1), 0);
+  loop_.EventProcess();
+  EXPECT_EQ(reply_, "ping");
+}
+
+// 测试期望的服务端名字和证书不一致时握手失败
+TEST_F(TlsTest, PeerNameMismatchTest) {
+  UsePeerCert(server_.get(), &server_ctx_, &client_ctx_);
+  client_->SetTls(client_ctx_.get(), "lars.example.com");
+  ASSERT_NE(client_->Connect(), -1);
+  client_->SendMessage("ping", 4, 1);
+  loop_.RunEvery(10, [this]() {
+    if (!client_->IsConnected()) {
+      loop_.Stop();
+    }
+  });
+  loop_.EventProcess();
+  EXPECT_FALSE(client_->IsConnected());
+  EXPECT_TRUE(reply_.empty());
+}
+
+// 测试大消息的最后一个记录中带着下一条消息时，openssl中剩余的数据也被处理
+TEST_F(TlsTest, LargeChainPendingTest) {
+  server_->SetLargeMessage(4 * 1024 * 1024);
+  int large_len = 0;
+  server_->GetRouter().RegisterChain(
+      5, [&large_len](const std::shared_ptr<IoBuffer>& chain, int total,
+                      int msg_id, void* args, NetConnection* conn) {
+        large_len = total;
+      });
+  std::string small;
+  server_->AddMsgRouter(6, [this, &small](const char* data, int len,
+                                          int msg_id, void* args,
+                                          NetConnection* conn) {
+    small.assign(data, len);
+    loop_.Stop();
+  });
+
+  // 大消息和后面的小消息一次写入，最后一个tls记录同时包含两者
+  std::string body(MESSAGE_LENGTH_LIMIT + TLS_RECORD_SIZE + 100, 'x');
+  std::string data(MESSAGE_HEAD_LEN, 0);
+  EncodeHead(&data[0], 5, static_cast<int>(body.size()));
+  data += body;
+  std::string head(MESSAGE_HEAD_LEN, 0);
+  EncodeHead(&head[0], 6, 4);
+  data += head + "tail";
+
+  struct sockaddr_in addr {};
+  socklen_t addr_len = sizeof(addr);
+  getsockname(server_->GetListenFd(), reinterpret_cast<sockaddr*>(&addr),
+              &addr_len);
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  ASSERT_EQ(connect(fd, reinterpret_cast<sockaddr*>(&addr), addr_len), 0);
+  // 阻塞的客户端在另一个线程中握手和写入
+  std::thread writer([this, fd, &data]() {
+    TlsSession tls(client_ctx_.get(), fd, false);
+    while (tls.Handshake() == 0) {
+    }
+    // 先写两个记录让服务端进入组装模式，剩下的从socket直接读到链表中
+    size_t sent = 0;
+    size_t part = TLS_RECORD_SIZE;
+    while (sent < data.size()) {
+      int ret = tls.Write(data.data() + sent,
+                          static_cast<int>(std::min(part, data.size() - sent)));
+      if (ret <= 0) {
+        break;
+      }
+      sent += ret;
+      if (sent == 2 * TLS_RECORD_SIZE) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        part = data.size();
+      }
+    }
+  });
+  loop_.EventProcess();
+  writer.join();
+  close(fd);
+  EXPECT_EQ(large_len, static_cast<int>(body.size()));
+  EXPECT_EQ(small, "tail");
+}
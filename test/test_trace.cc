@@ -0,0 +1,100 @@
+#include <unistd.h>
+
+#include <csignal>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include "gtest/gtest.h"
+#include "lars_reactor/event_loop.h"
+#include "lars_reactor/msg_router.h"
+#include "lars_reactor/net_connection.h"
+#include "lars_reactor/trace.h"
+
+static std::string ReadFile(const std::string& path) {
+  std::ifstream in(path);
+  std::stringstream ss;
+  ss << in.rdbuf();
+  return ss.str();
+}
+
+static int CountOf(const std::string& text, const std::string& word) {
+  int count = 0;
+  for (size_t pos = text.find(word); pos != std::string::npos;
+       pos = text.find(word, pos + word.size())) {
+    ++count;
+  }
+  return count;
+}
+
+// 记录回复的连接
+class ReplyConn : public NetConnection {
+ public:
+  int SendMessage(const char* data, int msg_len, int msg_id) override {
+    reply_.assign(data, msg_len);
+    return 0;
+  }
+  std::string reply_;
+};
+
+// 测试多个线程的span导出为trace json
+TEST(TraceTest, DumpTest) {
+  auto record = []() {
+    for (int i = 0; i < 100; ++i) {
+      TraceSpan span("dump_test", i);
+    }
+  };
+  std::thread first(record);
+  std::thread second(record);
+  first.join();
+  second.join();
+
+  std::string path = "/tmp/lars_trace_test_" + std::to_string(getpid());
+  ASSERT_GE(Tracer::Dump(path), 200);
+  std::string json = ReadFile(path);
+  unlink(path.c_str());
+  EXPECT_EQ(json.compare(0, 16, "{\"traceEvents\":["), 0);
+  EXPECT_EQ(json.substr(json.size() - 2), "}\n");
+  EXPECT_EQ(CountOf(json, "\"name\":\"dump_test\""), 200);
+  EXPECT_EQ(CountOf(json, "\"arg\":99}"), 2);
+}
+
+// 测试缓冲区写满后只保留最新的记录
+TEST(TraceTest, OverflowTest) {
+  std::thread([]() {
+    for (int i = 0; i < TRACE_BUFFER_SIZE + 10; ++i) {
+      Tracer::Record(i < 10 ? "overflow_old" : "overflow_new", i, 0, 0);
+    }
+  }).join();
+  std::string path = "/tmp/lars_trace_test_" + std::to_string(getpid());
+  ASSERT_NE(Tracer::Dump(path), -1);
+  std::string json = ReadFile(path);
+  unlink(path.c_str());
+  EXPECT_EQ(CountOf(json, "\"name\":\"overflow_old\""), 0);
+  // 写满后最旧的一个槽位可能正被写线程覆盖，导出时不包含它
+  EXPECT_EQ(CountOf(json, "\"name\":\"overflow_new\""),
+            TRACE_BUFFER_SIZE - 1);
+}
+
+// 测试信号和管理请求触发导出
+TEST(TraceTest, DumpRequestTest) {
+  std::string path = "/tmp/lars_trace_test_" + std::to_string(getpid());
+  Tracer::SetDumpPath(path);
+  { TraceSpan span("request_test"); }
+
+  MsgRouter router;
+  ASSERT_EQ(Tracer::AddDumpRouter(&router), 0);
+  ReplyConn conn;
+  ASSERT_TRUE(router.Call(TRACE_DUMP_ID, 0, nullptr, &conn));
+  EXPECT_EQ(conn.reply_, path);
+  EXPECT_EQ(CountOf(ReadFile(path), "\"name\":\"request_test\""), 1);
+  unlink(path.c_str());
+
+  EventLoop loop;
+  ASSERT_TRUE(Tracer::DumpOnSignal(&loop, SIGUSR2));
+  raise(SIGUSR2);
+  loop.RunAfter(100, [&loop]() { loop.Stop(); });
+  loop.EventProcess();
+  EXPECT_EQ(CountOf(ReadFile(path), "\"name\":\"request_test\""), 1);
+  unlink(path.c_str());
+}